@@ -0,0 +1,1150 @@
+/* mp3_decode.h - public domain MPEG audio Layer III decoder
+                  no warranty implied; use at your own risk
+
+   Decodes MPEG-1, MPEG-2 and MPEG-2.5 Layer III frames to interleaved float
+   PCM in [-1, 1]. Layers I and II and free format streams are not supported.
+
+   Do this:
+      #define MP3_DECODE_IMPLEMENTATION
+   before you include this file in *one* C file to create the implementation.
+
+   Usage:
+      mp3d dec;
+      mp3d_init(&dec);
+
+      float pcm[MP3D_MAX_SAMPLES_PER_FRAME];
+      mp3d_frame_info info;
+      int samples = mp3d_decode_frame(&dec, data, len, pcm, &info);
+
+   mp3d_decode_frame decodes the first frame found in data and returns the
+   samples per channel it wrote to pcm. Drop info.frame_bytes from the front
+   of data before the next call, junk before the frame included. No samples
+   and no bytes to drop means the frame isn't all there yet: call again with
+   more data, or stop at the end of the stream. Keep at least
+   MP3D_MAX_FRAME_BYTES buffered so frames are checked against the next one.
+
+   Frames only depend on the ones before them through the decoder, so a
+   stream is decoded by feeding it through in order. Encoders usually put a
+   silent Xing or Info frame first, see mp3d_read_xing.
+
+   The decoder holds about 30 KB of state and tables and allocates nothing.
+*/
+
+#ifndef MP3_DECODE_H
+#define MP3_DECODE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 320 kbps at 32 kHz, or 160 kbps at 8 kHz.
+#define MP3D_MAX_FRAME_BYTES 1441
+#define MP3D_MAX_SAMPLES_PER_FRAME (1152 * 2)
+
+typedef struct mp3d_frame_info {
+	int frame_bytes;
+	int channels;
+	int sample_rate;
+	int bitrate_kbps;
+	// Per channel, 1152 for MPEG-1 and 576 otherwise.
+	int samples;
+} mp3d_frame_info;
+
+// From the Xing or Info frame. delay and padding are the samples the encoder
+// added at the start and end, from a LAME tag, or 0 without one.
+typedef struct mp3d_xing {
+	unsigned frames;
+	int delay;
+	int padding;
+} mp3d_xing;
+
+// Samples a decoder lags behind the encoder, to skip on top of mp3d_xing's
+// delay.
+#define MP3D_DECODER_DELAY 529
+
+// Main data of earlier frames, the current frame's and padding for the bit
+// reader.
+#define MP3D_MAIN_DATA_SIZE 2048
+
+typedef struct mp3d {
+	float overlap[2][576];
+	float synth[2][1024];
+	int synth_pos;
+	unsigned char main_data[MP3D_MAIN_DATA_SIZE];
+	int main_data_len;
+
+	// Tables, filled by mp3d_init.
+	unsigned huff_codes[1378];
+	float imdct_long[36][18];
+	float imdct_short[12][6];
+	float window_long[4][36];
+	float window_short[12];
+	float synth_cos[64][32];
+	float synth_window[512];
+} mp3d;
+
+void mp3d_init(mp3d *dec);
+// Returns the offset of the first frame header in data, or -1. The frame
+// itself may run past len.
+int mp3d_find_frame(const unsigned char *data, int len, mp3d_frame_info *info);
+// Returns 1 and fills xing if the frame is a Xing or Info frame, which holds
+// no audio and shouldn't be played.
+int mp3d_read_xing(const unsigned char *frame, const mp3d_frame_info *info, mp3d_xing *xing);
+int mp3d_decode_frame(mp3d *dec, const unsigned char *data, int len, float *pcm, mp3d_frame_info *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MP3_DECODE_H
+
+#ifdef MP3_DECODE_IMPLEMENTATION
+
+#include <math.h>
+#include <string.h>
+
+#define MP3D_PI 3.14159265358979323846
+
+static const unsigned short mp3d_bitrates[2][15] = {
+	{ 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },
+	{ 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+};
+
+static const unsigned short mp3d_sample_rates[3] = { 44100, 48000, 32000 };
+
+// Big value Huffman tables 1-3, 5-13, 15, 16 and 24 back to back, each entry
+// in increasing code order. Codes follow from the lengths alone.
+static const unsigned char mp3d_huff_lens[1378] = {
+	3, 3, 2, 1, 6, 6, 5, 5, 5, 3, 3, 3, 1, 6, 6, 5, 5, 5, 3, 2, 2, 2, 8, 8,
+	7, 6, 7, 7, 7, 7, 6, 6, 6, 6, 3, 3, 3, 1, 7, 7, 6, 6, 6, 5, 5, 5, 5, 4,
+	4, 4, 3, 2, 3, 3, 10, 10, 10, 10, 9, 9, 9, 9, 8, 8, 9, 9, 8, 9, 9, 8, 8, 7,
+	7, 7, 8, 8, 8, 8, 7, 7, 7, 7, 6, 5, 6, 6, 4, 3, 3, 1, 11, 11, 10, 9, 10, 10,
+	9, 9, 9, 8, 8, 9, 9, 9, 9, 8, 8, 8, 7, 8, 8, 8, 8, 8, 8, 8, 8, 6, 6, 6,
+	4, 4, 2, 3, 3, 2, 9, 9, 8, 8, 9, 9, 8, 8, 8, 8, 7, 7, 7, 8, 8, 7, 7, 7,
+	7, 6, 6, 6, 6, 5, 5, 6, 6, 5, 5, 4, 4, 4, 3, 3, 3, 3, 11, 11, 11, 11, 11, 11,
+	10, 10, 10, 10, 10, 10, 10, 11, 11, 10, 9, 9, 10, 10, 9, 9, 10, 10, 9, 10, 10, 8, 8, 9,
+	9, 10, 10, 9, 9, 10, 10, 8, 8, 8, 9, 9, 9, 9, 9, 9, 8, 8, 8, 8, 8, 8, 7, 7,
+	7, 7, 6, 6, 6, 6, 4, 3, 3, 1, 10, 10, 10, 10, 10, 10, 10, 11, 11, 10, 10, 9, 9, 9,
+	10, 10, 10, 10, 8, 8, 9, 9, 7, 8, 8, 8, 8, 8, 9, 9, 9, 9, 8, 7, 8, 8, 7, 7,
+	8, 8, 8, 9, 9, 8, 8, 8, 8, 8, 8, 7, 7, 6, 6, 7, 7, 6, 5, 4, 5, 5, 3, 3,
+	3, 2, 10, 10, 9, 9, 9, 9, 9, 9, 9, 8, 8, 9, 9, 8, 8, 8, 8, 8, 8, 9, 9, 8,
+	8, 8, 8, 8, 9, 9, 7, 7, 7, 8, 8, 8, 8, 8, 8, 7, 7, 7, 7, 8, 8, 7, 7, 7,
+	6, 6, 6, 6, 7, 7, 6, 5, 5, 5, 4, 4, 5, 5, 4, 3, 3, 3, 19, 19, 18, 17, 16, 16,
+	16, 16, 16, 16, 16, 16, 16, 16, 17, 17, 15, 15, 16, 16, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+	16, 16, 15, 16, 16, 14, 14, 15, 15, 15, 15, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 15, 15,
+	14, 13, 14, 14, 13, 13, 14, 14, 13, 14, 14, 13, 14, 14, 13, 14, 14, 13, 13, 14, 14, 12, 12, 12,
+	13, 13, 13, 13, 13, 13, 12, 13, 13, 12, 12, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 12,
+	12, 13, 13, 12, 12, 12, 12, 13, 13, 13, 13, 12, 13, 13, 12, 11, 12, 12, 12, 12, 12, 12, 12, 12,
+	11, 11, 11, 11, 12, 12, 11, 11, 12, 12, 11, 12, 12, 12, 12, 11, 11, 12, 12, 11, 12, 12, 11, 12,
+	12, 11, 12, 12, 10, 10, 10, 11, 11, 11, 11, 11, 11, 11, 11, 10, 10, 10, 10, 11, 11, 10, 11, 11,
+	10, 11, 11, 11, 11, 10, 10, 11, 11, 10, 10, 11, 11, 11, 11, 11, 11, 9, 9, 10, 10, 10, 10, 10,
+	11, 11, 9, 9, 9, 10, 10, 9, 9, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 8, 9, 9, 9, 9,
+	9, 9, 10, 10, 9, 9, 9, 8, 8, 9, 9, 9, 9, 9, 9, 8, 7, 8, 8, 8, 8, 7, 7, 7,
+	7, 7, 6, 6, 6, 6, 4, 4, 3, 1, 13, 13, 13, 13, 12, 13, 13, 13, 13, 13, 13, 12, 13, 13,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 13,
+	13, 11, 11, 12, 12, 12, 12, 11, 11, 11, 11, 11, 11, 12, 12, 11, 11, 11, 11, 11, 11, 11, 11, 12,
+	12, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11,
+	11, 11, 12, 12, 11, 11, 11, 11, 11, 11, 10, 11, 11, 11, 11, 11, 11, 10, 10, 11, 11, 10, 10, 10,
+	10, 11, 11, 10, 10, 10, 10, 10, 10, 10, 11, 11, 10, 10, 10, 10, 10, 11, 11, 9, 10, 10, 10, 10,
+	10, 10, 10, 10, 10, 10, 10, 10, 9, 10, 10, 10, 10, 9, 10, 10, 9, 10, 10, 10, 10, 10, 10, 10,
+	10, 9, 9, 9, 9, 9, 9, 9, 10, 10, 9, 9, 9, 9, 9, 9, 10, 10, 9, 9, 9, 9, 9, 9,
+	8, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 8, 8, 8, 8, 9, 9, 9, 9, 9, 9, 9, 9, 8,
+	8, 8, 8, 8, 8, 9, 9, 8, 8, 8, 8, 8, 8, 8, 9, 9, 8, 7, 8, 8, 7, 7, 7, 7,
+	8, 8, 7, 7, 7, 7, 7, 6, 7, 7, 6, 6, 7, 7, 6, 6, 6, 5, 5, 5, 5, 5, 3, 4,
+	4, 3, 11, 11, 11, 11, 11, 11, 11, 11, 10, 11, 11, 11, 11, 10, 10, 10, 10, 10, 8, 10, 10, 9,
+	9, 9, 9, 10, 16, 17, 17, 15, 15, 16, 16, 14, 15, 15, 14, 14, 15, 15, 14, 14, 15, 15, 15, 15,
+	14, 15, 15, 14, 13, 8, 9, 9, 8, 8, 13, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 13, 13, 14,
+	14, 14, 14, 13, 14, 14, 13, 13, 13, 14, 14, 14, 14, 13, 13, 14, 14, 13, 14, 14, 12, 13, 13, 13,
+	13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 12, 13, 13, 13, 13, 13, 13, 12, 13, 13, 12, 12, 13,
+	13, 11, 12, 12, 12, 12, 12, 12, 12, 13, 13, 11, 12, 12, 12, 12, 11, 12, 12, 12, 12, 12, 12, 12,
+	12, 11, 12, 12, 11, 11, 11, 11, 12, 12, 12, 12, 12, 12, 12, 12, 11, 12, 12, 11, 12, 12, 11, 12,
+	12, 11, 12, 12, 11, 10, 10, 11, 11, 11, 11, 11, 11, 10, 10, 11, 11, 10, 10, 11, 11, 11, 11, 11,
+	11, 11, 11, 10, 11, 11, 10, 10, 10, 11, 11, 10, 10, 11, 11, 10, 10, 11, 11, 10, 9, 9, 10, 10,
+	10, 10, 10, 10, 9, 9, 9, 10, 10, 9, 10, 10, 9, 9, 8, 9, 9, 9, 9, 9, 9, 9, 9, 8,
+	8, 9, 9, 8, 8, 7, 7, 8, 8, 7, 6, 6, 6, 6, 4, 4, 3, 1, 8, 8, 8, 8, 8, 8,
+	8, 8, 7, 8, 8, 7, 7, 8, 8, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 8, 8, 9,
+	11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11,
+	11, 11, 11, 11, 4, 11, 11, 11, 11, 12, 12, 11, 10, 11, 11, 10, 10, 10, 10, 11, 11, 10, 10, 10,
+	10, 11, 11, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10,
+	10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 11, 11, 10, 10, 10, 10,
+	10, 10, 10, 10, 10, 10, 10, 10, 10, 11, 11, 10, 11, 11, 10, 9, 10, 10, 10, 10, 11, 11, 10, 9,
+	9, 10, 10, 9, 10, 10, 10, 10, 9, 9, 10, 10, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,
+	9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,
+	10, 10, 9, 9, 9, 10, 10, 8, 9, 9, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 9,
+	9, 8, 8, 8, 8, 8, 8, 9, 9, 7, 8, 8, 7, 7, 7, 7, 7, 8, 8, 7, 7, 6, 6, 7,
+	7, 6, 5, 5, 6, 6, 4, 4, 4, 4,
+};
+
+// x << 4 | y for each entry above.
+static const unsigned char mp3d_huff_symbols[1378] = {
+	0x11, 0x01, 0x10, 0x00, 0x22, 0x02, 0x12, 0x21, 0x20, 0x11, 0x01, 0x10, 0x00, 0x22, 0x02, 0x12,
+	0x21, 0x20, 0x10, 0x11, 0x01, 0x00, 0x33, 0x23, 0x32, 0x31, 0x13, 0x03, 0x30, 0x22, 0x12, 0x21,
+	0x02, 0x20, 0x11, 0x01, 0x10, 0x00, 0x33, 0x03, 0x23, 0x32, 0x30, 0x13, 0x31, 0x22, 0x02, 0x12,
+	0x21, 0x20, 0x01, 0x11, 0x10, 0x00, 0x55, 0x45, 0x54, 0x53, 0x35, 0x44, 0x25, 0x52, 0x15, 0x51,
+	0x05, 0x34, 0x50, 0x43, 0x33, 0x24, 0x42, 0x14, 0x41, 0x40, 0x04, 0x23, 0x32, 0x03, 0x13, 0x31,
+	0x30, 0x22, 0x12, 0x21, 0x02, 0x20, 0x11, 0x01, 0x10, 0x00, 0x55, 0x54, 0x45, 0x53, 0x35, 0x44,
+	0x25, 0x52, 0x05, 0x15, 0x51, 0x34, 0x43, 0x50, 0x33, 0x24, 0x42, 0x14, 0x41, 0x04, 0x40, 0x23,
+	0x32, 0x13, 0x31, 0x03, 0x30, 0x22, 0x02, 0x20, 0x12, 0x21, 0x11, 0x01, 0x10, 0x00, 0x55, 0x45,
+	0x35, 0x53, 0x54, 0x05, 0x44, 0x25, 0x52, 0x15, 0x51, 0x34, 0x43, 0x50, 0x04, 0x24, 0x42, 0x33,
+	0x40, 0x14, 0x41, 0x23, 0x32, 0x13, 0x31, 0x03, 0x30, 0x22, 0x02, 0x12, 0x21, 0x20, 0x11, 0x01,
+	0x10, 0x00, 0x77, 0x67, 0x76, 0x57, 0x75, 0x66, 0x47, 0x74, 0x56, 0x65, 0x37, 0x73, 0x46, 0x55,
+	0x54, 0x63, 0x27, 0x72, 0x64, 0x07, 0x70, 0x62, 0x45, 0x35, 0x06, 0x53, 0x44, 0x17, 0x71, 0x36,
+	0x26, 0x25, 0x52, 0x15, 0x51, 0x34, 0x43, 0x16, 0x61, 0x60, 0x05, 0x50, 0x24, 0x42, 0x33, 0x04,
+	0x14, 0x41, 0x40, 0x23, 0x32, 0x03, 0x13, 0x31, 0x30, 0x22, 0x12, 0x21, 0x02, 0x20, 0x11, 0x01,
+	0x10, 0x00, 0x77, 0x67, 0x76, 0x75, 0x66, 0x47, 0x74, 0x57, 0x55, 0x56, 0x65, 0x37, 0x73, 0x46,
+	0x45, 0x54, 0x35, 0x53, 0x27, 0x72, 0x64, 0x07, 0x71, 0x17, 0x70, 0x36, 0x63, 0x60, 0x44, 0x25,
+	0x52, 0x05, 0x15, 0x62, 0x26, 0x06, 0x16, 0x61, 0x51, 0x34, 0x50, 0x43, 0x33, 0x24, 0x42, 0x14,
+	0x41, 0x04, 0x40, 0x23, 0x32, 0x13, 0x31, 0x03, 0x30, 0x22, 0x21, 0x12, 0x02, 0x20, 0x11, 0x01,
+	0x10, 0x00, 0x77, 0x67, 0x76, 0x57, 0x75, 0x66, 0x47, 0x74, 0x65, 0x56, 0x37, 0x73, 0x55, 0x27,
+	0x72, 0x46, 0x64, 0x17, 0x71, 0x07, 0x70, 0x36, 0x63, 0x45, 0x54, 0x44, 0x06, 0x05, 0x26, 0x62,
+	0x61, 0x16, 0x60, 0x35, 0x53, 0x25, 0x52, 0x15, 0x51, 0x34, 0x43, 0x50, 0x04, 0x24, 0x42, 0x14,
+	0x33, 0x41, 0x23, 0x32, 0x40, 0x03, 0x30, 0x13, 0x31, 0x22, 0x12, 0x21, 0x02, 0x20, 0x00, 0x11,
+	0x01, 0x10, 0xfe, 0xfc, 0xfd, 0xed, 0xff, 0xef, 0xdf, 0xee, 0xcf, 0xde, 0xbf, 0xfb, 0xce, 0xdc,
+	0xaf, 0xe9, 0xec, 0xdd, 0xfa, 0xcd, 0xbe, 0xeb, 0x9f, 0xf9, 0xea, 0xbd, 0xdb, 0x8f, 0xf8, 0xcc,
+	0xae, 0x9e, 0x8e, 0x7f, 0x7e, 0xf7, 0xda, 0xad, 0xbc, 0xcb, 0xf6, 0x6f, 0xe8, 0x5f, 0x9d, 0xd9,
+	0xf5, 0xe7, 0xac, 0xbb, 0x4f, 0xf4, 0xca, 0xe6, 0xf3, 0x3f, 0x8d, 0xd8, 0x2f, 0xf2, 0x6e, 0x9c,
+	0x0f, 0xc9, 0x5e, 0xab, 0x7d, 0xd7, 0x4e, 0xc8, 0xd6, 0x3e, 0xb9, 0x9b, 0xaa, 0x1f, 0xf1, 0xf0,
+	0xba, 0xe5, 0xe4, 0x8c, 0x6d, 0xe3, 0xe2, 0x2e, 0x0e, 0x1e, 0xe1, 0xe0, 0x5d, 0xd5, 0x7c, 0xc7,
+	0x4d, 0x8b, 0xb8, 0xd4, 0x9a, 0xa9, 0x6c, 0xc6, 0x3d, 0xd3, 0x7b, 0x2d, 0xd2, 0x1d, 0xb7, 0x5c,
+	0xc5, 0x99, 0x7a, 0xc3, 0xa7, 0x97, 0x4b, 0xd1, 0x0d, 0xd0, 0x8a, 0xa8, 0x4c, 0xc4, 0x6b, 0xb6,
+	0x3c, 0x2c, 0xc2, 0x5b, 0xb5, 0x89, 0x1c, 0xc1, 0x98, 0x0c, 0xc0, 0xb4, 0x6a, 0xa6, 0x79, 0x3b,
+	0xb3, 0x88, 0x5a, 0x2b, 0xa5, 0x69, 0xa4, 0x78, 0x87, 0x94, 0x77, 0x76, 0xb2, 0x1b, 0xb1, 0x0b,
+	0xb0, 0x96, 0x4a, 0x3a, 0xa3, 0x59, 0x95, 0x2a, 0xa2, 0x1a, 0xa1, 0x0a, 0x68, 0xa0, 0x86, 0x49,
+	0x93, 0x39, 0x58, 0x85, 0x67, 0x29, 0x92, 0x57, 0x75, 0x38, 0x83, 0x66, 0x47, 0x74, 0x56, 0x65,
+	0x73, 0x19, 0x91, 0x09, 0x90, 0x48, 0x84, 0x72, 0x46, 0x64, 0x28, 0x82, 0x18, 0x37, 0x27, 0x17,
+	0x71, 0x55, 0x07, 0x70, 0x36, 0x63, 0x45, 0x54, 0x26, 0x62, 0x35, 0x81, 0x08, 0x80, 0x16, 0x61,
+	0x06, 0x60, 0x53, 0x44, 0x25, 0x52, 0x05, 0x15, 0x51, 0x34, 0x43, 0x50, 0x24, 0x42, 0x33, 0x14,
+	0x41, 0x04, 0x40, 0x23, 0x32, 0x13, 0x31, 0x03, 0x30, 0x22, 0x12, 0x21, 0x02, 0x20, 0x11, 0x01,
+	0x10, 0x00, 0xff, 0xef, 0xfe, 0xdf, 0xee, 0xfd, 0xcf, 0xfc, 0xde, 0xed, 0xbf, 0xfb, 0xce, 0xec,
+	0xdd, 0xaf, 0xfa, 0xbe, 0xeb, 0xcd, 0xdc, 0x9f, 0xf9, 0xea, 0xbd, 0xdb, 0x8f, 0xf8, 0xcc, 0x9e,
+	0xe9, 0x7f, 0xf7, 0xad, 0xda, 0xbc, 0x6f, 0xae, 0x0f, 0xcb, 0xf6, 0x8e, 0xe8, 0x5f, 0x9d, 0xf5,
+	0x7e, 0xe7, 0xac, 0xca, 0xbb, 0xd9, 0x8d, 0x4f, 0xf4, 0x3f, 0xf3, 0xd8, 0xe6, 0x2f, 0xf2, 0x6e,
+	0xf0, 0x1f, 0xf1, 0x9c, 0xc9, 0x5e, 0xab, 0xba, 0xe5, 0x7d, 0xd7, 0x4e, 0xe4, 0x8c, 0xc8, 0x3e,
+	0x6d, 0xd6, 0xe3, 0x9b, 0xb9, 0x2e, 0xaa, 0xe2, 0x1e, 0xe1, 0x0e, 0xe0, 0x5d, 0xd5, 0x7c, 0xc7,
+	0x4d, 0x8b, 0xd4, 0xb8, 0x9a, 0xa9, 0x6c, 0xc6, 0x3d, 0xd3, 0xd2, 0x2d, 0x0d, 0x1d, 0x7b, 0xb7,
+	0xd1, 0x5c, 0xd0, 0xc5, 0x8a, 0xa8, 0x4c, 0xc4, 0x6b, 0xb6, 0x99, 0x0c, 0x3c, 0xc3, 0x7a, 0xa7,
+	0xa6, 0xc0, 0x0b, 0xc2, 0x2c, 0x5b, 0xb5, 0x1c, 0x89, 0x98, 0xc1, 0x4b, 0xb4, 0x6a, 0x3b, 0x79,
+	0xb3, 0x97, 0x88, 0x2b, 0x5a, 0xb2, 0xa5, 0x1b, 0xb1, 0xb0, 0x69, 0x96, 0x4a, 0xa4, 0x78, 0x87,
+	0x3a, 0xa3, 0x59, 0x95, 0x2a, 0xa2, 0x1a, 0xa1, 0x0a, 0xa0, 0x68, 0x86, 0x49, 0x94, 0x39, 0x93,
+	0x77, 0x09, 0x58, 0x85, 0x29, 0x67, 0x76, 0x92, 0x91, 0x19, 0x90, 0x48, 0x84, 0x57, 0x75, 0x38,
+	0x83, 0x66, 0x47, 0x28, 0x82, 0x18, 0x81, 0x74, 0x08, 0x80, 0x56, 0x65, 0x37, 0x73, 0x46, 0x27,
+	0x72, 0x64, 0x17, 0x55, 0x71, 0x07, 0x70, 0x36, 0x63, 0x45, 0x54, 0x26, 0x62, 0x16, 0x06, 0x60,
+	0x35, 0x61, 0x53, 0x44, 0x25, 0x52, 0x15, 0x51, 0x05, 0x50, 0x34, 0x43, 0x24, 0x42, 0x33, 0x41,
+	0x14, 0x04, 0x23, 0x32, 0x40, 0x03, 0x13, 0x31, 0x30, 0x22, 0x12, 0x21, 0x02, 0x20, 0x11, 0x01,
+	0x10, 0x00, 0xef, 0xfe, 0xdf, 0xfd, 0xcf, 0xfc, 0xbf, 0xfb, 0xaf, 0xfa, 0x9f, 0xf9, 0xf8, 0x8f,
+	0x7f, 0xf7, 0x6f, 0xf6, 0xff, 0x5f, 0xf5, 0x4f, 0xf4, 0xf3, 0xf0, 0x3f, 0xce, 0xec, 0xdd, 0xde,
+	0xe9, 0xea, 0xd9, 0xee, 0xed, 0xeb, 0xbe, 0xcd, 0xdc, 0xdb, 0xae, 0xcc, 0xad, 0xda, 0x7e, 0xac,
+	0xca, 0xc9, 0x7d, 0x5e, 0xbd, 0xf2, 0x2f, 0x0f, 0x1f, 0xf1, 0x9e, 0xbc, 0xcb, 0x8e, 0xe8, 0x9d,
+	0xe7, 0xbb, 0x8d, 0xd8, 0x6e, 0xe6, 0x9c, 0xab, 0xba, 0xe5, 0xd7, 0x4e, 0xe4, 0x8c, 0xc8, 0x3e,
+	0x6d, 0xd6, 0x9b, 0xb9, 0xaa, 0xe1, 0xd4, 0xb8, 0xa9, 0x7b, 0xb7, 0xd0, 0xe3, 0x0e, 0xe0, 0x5d,
+	0xd5, 0x7c, 0xc7, 0x4d, 0x8b, 0x9a, 0x6c, 0xc6, 0x3d, 0x5c, 0xc5, 0x0d, 0x8a, 0xa8, 0x99, 0x4c,
+	0xb6, 0x7a, 0x3c, 0x5b, 0x89, 0x1c, 0xc0, 0x98, 0x79, 0xe2, 0x2e, 0x1e, 0xd3, 0x2d, 0xd2, 0xd1,
+	0x3b, 0x97, 0x88, 0x1d, 0xc4, 0x6b, 0xc3, 0xa7, 0x2c, 0xc2, 0xb5, 0xc1, 0x0c, 0x4b, 0xb4, 0x6a,
+	0xa6, 0xb3, 0x5a, 0xa5, 0x2b, 0xb2, 0x1b, 0xb1, 0x0b, 0xb0, 0x69, 0x96, 0x4a, 0xa4, 0x78, 0x87,
+	0xa3, 0x3a, 0x59, 0x2a, 0x95, 0x68, 0xa1, 0x86, 0x77, 0x94, 0x49, 0x57, 0x67, 0xa2, 0x1a, 0x0a,
+	0xa0, 0x39, 0x93, 0x58, 0x85, 0x29, 0x92, 0x76, 0x09, 0x19, 0x91, 0x90, 0x48, 0x84, 0x75, 0x38,
+	0x83, 0x66, 0x28, 0x82, 0x47, 0x74, 0x18, 0x81, 0x80, 0x08, 0x56, 0x37, 0x73, 0x65, 0x46, 0x27,
+	0x72, 0x64, 0x55, 0x07, 0x17, 0x71, 0x70, 0x36, 0x63, 0x45, 0x54, 0x26, 0x62, 0x16, 0x61, 0x06,
+	0x60, 0x53, 0x35, 0x44, 0x25, 0x52, 0x51, 0x15, 0x05, 0x34, 0x43, 0x50, 0x24, 0x42, 0x33, 0x14,
+	0x41, 0x04, 0x40, 0x23, 0x32, 0x13, 0x31, 0x03, 0x30, 0x22, 0x12, 0x21, 0x02, 0x20, 0x11, 0x01,
+	0x10, 0x00, 0xef, 0xfe, 0xdf, 0xfd, 0xcf, 0xfc, 0xbf, 0xfb, 0xfa, 0xaf, 0x9f, 0xf9, 0xf8, 0x8f,
+	0x7f, 0xf7, 0x6f, 0xf6, 0x5f, 0xf5, 0x4f, 0xf4, 0x3f, 0xf3, 0x2f, 0xf2, 0xf1, 0x1f, 0xf0, 0x0f,
+	0xee, 0xde, 0xed, 0xce, 0xec, 0xdd, 0xbe, 0xeb, 0xcd, 0xdc, 0xae, 0xea, 0xbd, 0xdb, 0xcc, 0x9e,
+	0xe9, 0xad, 0xda, 0xbc, 0xcb, 0x8e, 0xe8, 0x9d, 0xd9, 0x7e, 0xe7, 0xac, 0xff, 0xca, 0xbb, 0x8d,
+	0xd8, 0x0e, 0xe0, 0x0d, 0xe6, 0x6e, 0x9c, 0xc9, 0x5e, 0xba, 0xe5, 0xab, 0x7d, 0xd7, 0xe4, 0x8c,
+	0xc8, 0x4e, 0x2e, 0x3e, 0x6d, 0xd6, 0xe3, 0x9b, 0xb9, 0xaa, 0xe2, 0x1e, 0xe1, 0x5d, 0xd5, 0x7c,
+	0xc7, 0x4d, 0x8b, 0xb8, 0xd4, 0x9a, 0xa9, 0x6c, 0xc6, 0x3d, 0xd3, 0x2d, 0xd2, 0x1d, 0x7b, 0xb7,
+	0xd1, 0x5c, 0xc5, 0x8a, 0xa8, 0x99, 0x4c, 0xc4, 0x6b, 0xb6, 0xd0, 0x0c, 0x3c, 0xc3, 0x7a, 0xa7,
+	0x2c, 0xc2, 0x5b, 0xb5, 0x1c, 0x89, 0x98, 0xc1, 0x4b, 0xc0, 0x0b, 0x3b, 0xb0, 0x0a, 0x1a, 0xb4,
+	0x6a, 0xa6, 0x79, 0x97, 0xa0, 0x09, 0x90, 0xb3, 0x88, 0x2b, 0x5a, 0xb2, 0xa5, 0x1b, 0xb1, 0x69,
+	0x96, 0xa4, 0x4a, 0x78, 0x87, 0x3a, 0xa3, 0x59, 0x95, 0x2a, 0xa2, 0xa1, 0x68, 0x86, 0x77, 0x49,
+	0x94, 0x39, 0x93, 0x58, 0x85, 0x29, 0x67, 0x76, 0x92, 0x19, 0x91, 0x48, 0x84, 0x57, 0x75, 0x38,
+	0x83, 0x66, 0x28, 0x82, 0x18, 0x47, 0x74, 0x81, 0x08, 0x80, 0x56, 0x65, 0x17, 0x07, 0x70, 0x73,
+	0x37, 0x27, 0x72, 0x46, 0x64, 0x55, 0x71, 0x36, 0x63, 0x45, 0x54, 0x26, 0x62, 0x16, 0x61, 0x06,
+	0x60, 0x35, 0x53, 0x44, 0x25, 0x52, 0x15, 0x05, 0x50, 0x51, 0x34, 0x43, 0x24, 0x42, 0x33, 0x14,
+	0x41, 0x04, 0x40, 0x23, 0x32, 0x13, 0x31, 0x03, 0x30, 0x22, 0x12, 0x21, 0x02, 0x20, 0x11, 0x01,
+	0x10, 0x00,
+};
+
+// The first 257 coefficients of the synthesis window, times 65536. The rest
+// follow by symmetry.
+static const int mp3d_window_half[257] = {
+	0, -1, -1, -1, -1, -1, -1, -2, -2, -2, -2, -3,
+	-3, -4, -4, -5, -5, -6, -7, -7, -8, -9, -10, -11,
+	-13, -14, -16, -17, -19, -21, -24, -26, -29, -31, -35, -38,
+	-41, -45, -49, -53, -58, -63, -68, -73, -79, -85, -91, -97,
+	-104, -111, -117, -125, -132, -139, -147, -154, -161, -169, -176, -183,
+	-190, -196, -202, -208, 213, 218, 222, 225, 227, 228, 228, 227,
+	224, 221, 215, 208, 200, 189, 177, 163, 146, 127, 106, 83,
+	57, 29, -2, -36, -72, -111, -153, -197, -244, -294, -347, -401,
+	-459, -519, -581, -645, -711, -779, -848, -919, -991, -1064, -1137, -1210,
+	-1283, -1356, -1428, -1498, -1567, -1634, -1698, -1759, -1817, -1870, -1919, -1962,
+	-2001, -2032, -2057, -2075, -2085, -2087, -2080, -2063, 2037, 2000, 1952, 1893,
+	1822, 1739, 1644, 1535, 1414, 1280, 1131, 970, 794, 605, 402, 185,
+	-45, -288, -545, -814, -1095, -1388, -1692, -2006, -2330, -2663, -3004, -3351,
+	-3705, -4063, -4425, -4788, -5153, -5517, -5879, -6237, -6589, -6935, -7271, -7597,
+	-7910, -8209, -8491, -8755, -8998, -9219, -9416, -9585, -9727, -9838, -9916, -9959,
+	-9966, -9935, -9863, -9750, -9592, -9389, -9139, -8840, -8492, -8092, -7640, -7134,
+	6574, 5959, 5288, 4561, 3776, 2935, 2037, 1082, 70, -998, -2122, -3300,
+	-4533, -5818, -7154, -8540, -9975, -11455, -12980, -14548, -16155, -17799, -19478, -21189,
+	-22929, -24694, -26482, -28289, -30112, -31947, -33791, -35640, -37489, -39336, -41176, -43006,
+	-44821, -46617, -48390, -50137, -51853, -53534, -55178, -56778, -58333, -59838, -61289, -62684,
+	-64019, -65290, -66494, -67629, -68692, -69679, -70590, -71420, -72169, -72835, -73415, -73908,
+	-74313, -74630, -74856, -74992, 75038,
+};
+
+// Scalefactor band widths per sample rate: 44.1, 48, 32, 22.05, 24, 16,
+// 11.025, 12 and 8 kHz.
+static const unsigned char mp3d_band_long[9][22] = {
+	{ 4, 4, 4, 4, 4, 4, 6, 6, 8, 8, 10, 12, 16, 20, 24, 28, 34, 42, 50, 54, 76, 158 },
+	{ 4, 4, 4, 4, 4, 4, 6, 6, 6, 8, 10, 12, 16, 18, 22, 28, 34, 40, 46, 54, 54, 192 },
+	{ 4, 4, 4, 4, 4, 4, 6, 6, 8, 10, 12, 16, 20, 24, 30, 38, 46, 56, 68, 84, 102, 26 },
+	{ 6, 6, 6, 6, 6, 6, 8, 10, 12, 14, 16, 20, 24, 28, 32, 38, 46, 52, 60, 68, 58, 54 },
+	{ 6, 6, 6, 6, 6, 6, 8, 10, 12, 14, 16, 18, 22, 26, 32, 38, 46, 54, 62, 70, 76, 36 },
+	{ 6, 6, 6, 6, 6, 6, 8, 10, 12, 14, 16, 20, 24, 28, 32, 38, 46, 52, 60, 68, 58, 54 },
+	{ 6, 6, 6, 6, 6, 6, 8, 10, 12, 14, 16, 20, 24, 28, 32, 38, 46, 52, 60, 68, 58, 54 },
+	{ 6, 6, 6, 6, 6, 6, 8, 10, 12, 14, 16, 20, 24, 28, 32, 38, 46, 52, 60, 68, 58, 54 },
+	{ 12, 12, 12, 12, 12, 12, 16, 20, 24, 28, 32, 40, 48, 56, 64, 76, 90, 2, 2, 2, 2, 2 },
+};
+
+static const unsigned char mp3d_band_short[9][13] = {
+	{ 4, 4, 4, 4, 6, 8, 10, 12, 14, 18, 22, 30, 56 },
+	{ 4, 4, 4, 4, 6, 6, 10, 12, 14, 16, 20, 26, 66 },
+	{ 4, 4, 4, 4, 6, 8, 12, 16, 20, 26, 34, 42, 12 },
+	{ 4, 4, 4, 6, 6, 8, 10, 14, 18, 26, 32, 42, 18 },
+	{ 4, 4, 4, 6, 8, 10, 12, 14, 18, 24, 32, 44, 12 },
+	{ 4, 4, 4, 6, 8, 10, 12, 14, 18, 24, 30, 40, 18 },
+	{ 4, 4, 4, 6, 8, 10, 12, 14, 18, 24, 30, 40, 18 },
+	{ 4, 4, 4, 6, 8, 10, 12, 14, 18, 24, 30, 40, 18 },
+	{ 8, 8, 8, 12, 16, 20, 24, 28, 36, 2, 2, 2, 26 },
+};
+
+// Scalefactors per slen group for MPEG-2 and 2.5, by partition, then long,
+// short and mixed blocks.
+static const unsigned char mp3d_lsf_nsf[6][3][4] = {
+	{ { 6, 5, 5, 5 }, { 9, 9, 9, 9 }, { 6, 9, 9, 9 } },
+	{ { 6, 5, 7, 3 }, { 9, 9, 12, 6 }, { 6, 9, 12, 6 } },
+	{ { 11, 10, 0, 0 }, { 18, 18, 0, 0 }, { 15, 18, 0, 0 } },
+	{ { 7, 7, 7, 0 }, { 12, 12, 12, 0 }, { 6, 15, 12, 0 } },
+	{ { 6, 6, 6, 3 }, { 12, 9, 9, 6 }, { 6, 12, 9, 6 } },
+	{ { 8, 8, 5, 0 }, { 15, 12, 9, 0 }, { 6, 18, 9, 0 } },
+};
+
+// Where each big value table starts in the arrays above, and its size.
+static const unsigned short mp3d_huff_offsets[15] = { 0, 4, 13, 22, 38, 54, 90, 126, 162, 226, 290, 354, 610, 866, 1122 };
+static const unsigned short mp3d_huff_counts[15] = { 4, 9, 9, 16, 16, 36, 36, 36, 64, 64, 64, 256, 256, 256, 256 };
+
+// Table by table_select, -1 for table 0 and the unused 4 and 14.
+static const signed char mp3d_huff_tables[32] = {
+	-1, 0, 1, 2, -1, 3, 4, 5, 6, 7, 8, 9, 10, 11, -1, 12,
+	13, 13, 13, 13, 13, 13, 13, 13, 14, 14, 14, 14, 14, 14, 14, 14,
+};
+
+static const unsigned char mp3d_linbits[32] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 2, 3, 4, 6, 8, 10, 13, 4, 5, 6, 7, 8, 9, 11, 13,
+};
+
+// Count1 table A by vwxy.
+static const unsigned char mp3d_quad_codes[16] = { 1, 5, 4, 5, 6, 5, 4, 4, 7, 3, 6, 0, 7, 2, 3, 1 };
+static const unsigned char mp3d_quad_lens[16] = { 1, 4, 4, 5, 4, 6, 5, 6, 4, 5, 5, 6, 5, 6, 6, 6 };
+
+static const unsigned char mp3d_pretab[22] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 3, 3, 3, 2, 0 };
+
+// slen1 and slen2 by MPEG-1 scalefac_compress.
+static const unsigned char mp3d_slen[16][2] = {
+	{ 0, 0 }, { 0, 1 }, { 0, 2 }, { 0, 3 }, { 3, 0 }, { 1, 1 }, { 1, 2 }, { 1, 3 },
+	{ 2, 1 }, { 2, 2 }, { 2, 3 }, { 3, 1 }, { 3, 2 }, { 3, 3 }, { 4, 2 }, { 4, 3 },
+};
+
+static const float mp3d_alias[8] = { -0.6f, -0.535f, -0.33f, -0.185f, -0.095f, -0.041f, -0.0142f, -0.0037f };
+
+typedef struct mp3d_granule {
+	int part2_3_length;
+	int big_values;
+	int global_gain;
+	int scalefac_compress;
+	int block_type;
+	int is_mixed;
+	int table_select[3];
+	int subblock_gain[3];
+	// In samples.
+	int region1_start;
+	int region2_start;
+	int preflag;
+	int scalefac_scale;
+	int count1_table;
+	// Long bands first, then each short band's three windows.
+	unsigned char scalefactors[40];
+	int long_end;
+	int short_start;
+} mp3d_granule;
+
+typedef struct mp3d_bits {
+	const unsigned char *data;
+	int pos;
+} mp3d_bits;
+
+// n is 1 to 24, and the data must be readable for 4 bytes past pos.
+static unsigned mp3d_peek(const mp3d_bits *bits, int n) {
+	const unsigned char *p = bits->data + (bits->pos >> 3);
+	unsigned value = (unsigned)p[0] << 24 | (unsigned)p[1] << 16 | (unsigned)p[2] << 8 | p[3];
+	return value << (bits->pos & 7) >> (32 - n);
+}
+
+static unsigned mp3d_get(mp3d_bits *bits, int n) {
+	if (n == 0)
+		return 0;
+
+	unsigned value = mp3d_peek(bits, n);
+	bits->pos += n;
+	return value;
+}
+
+static int mp3d_header(const unsigned char *h, mp3d_frame_info *info) {
+	if (h[0] != 0xff || (h[1] & 0xe0) != 0xe0)
+		return 0;
+
+	int version = h[1] >> 3 & 3;
+	int layer = h[1] >> 1 & 3;
+	int bitrate_index = h[2] >> 4;
+	int rate_index = h[2] >> 2 & 3;
+
+	if (version == 1 || layer != 1 || bitrate_index == 0 || bitrate_index == 15 || rate_index == 3)
+		return 0;
+
+	int is_lsf = version != 3;
+	info->bitrate_kbps = mp3d_bitrates[is_lsf][bitrate_index];
+	info->sample_rate = mp3d_sample_rates[rate_index] >> (version == 3 ? 0 : version == 2 ? 1 : 2);
+	info->channels = h[3] >> 6 == 3 ? 1 : 2;
+	info->samples = is_lsf ? 576 : 1152;
+	info->frame_bytes = (is_lsf ? 72 : 144) * info->bitrate_kbps * 1000 / info->sample_rate + (h[2] >> 1 & 1);
+
+	return 1;
+}
+
+// Index into the band tables.
+static int mp3d_rate_index(const unsigned char *h) {
+	int rate_index = h[2] >> 2 & 3;
+	if (h[1] & 8)
+		return rate_index;
+
+	return rate_index + (h[1] & 0x10 ? 3 : 6);
+}
+
+static int mp3d_side_info_size(const unsigned char *h) {
+	int is_mono = h[3] >> 6 == 3;
+	if (h[1] & 8)
+		return is_mono ? 17 : 32;
+
+	return is_mono ? 9 : 17;
+}
+
+int mp3d_find_frame(const unsigned char *data, int len, mp3d_frame_info *info) {
+	for (int i = 0; i + 4 <= len; ++i) {
+		if (!mp3d_header(data + i, info))
+			continue;
+
+		// A false sync is unlikely to be followed by a matching header.
+		const unsigned char *next = data + i + info->frame_bytes;
+		mp3d_frame_info next_info;
+		if (i + info->frame_bytes + 4 <= len
+				&& (!mp3d_header(next, &next_info) || ((data[i + 1] ^ next[1]) & 0xfe) || ((data[i + 2] ^ next[2]) & 0x0c)))
+			continue;
+
+		return i;
+	}
+
+	return -1;
+}
+
+static unsigned mp3d_be32(const unsigned char *p) {
+	return (unsigned)p[0] << 24 | (unsigned)p[1] << 16 | (unsigned)p[2] << 8 | p[3];
+}
+
+int mp3d_read_xing(const unsigned char *frame, const mp3d_frame_info *info, mp3d_xing *xing) {
+	const unsigned char *p = frame + 4 + mp3d_side_info_size(frame);
+	const unsigned char *end = frame + info->frame_bytes;
+
+	if (p + 8 > end || (memcmp(p, "Xing", 4) != 0 && memcmp(p, "Info", 4) != 0))
+		return 0;
+
+	unsigned flags = mp3d_be32(p + 4);
+	p += 8;
+
+	*xing = (mp3d_xing){0};
+	if ((flags & 1) && p + 4 <= end) {
+		xing->frames = mp3d_be32(p);
+		p += 4;
+	}
+	p += (flags & 2 ? 4 : 0) + (flags & 4 ? 100 : 0) + (flags & 8 ? 4 : 0);
+
+	// The LAME tag, also written by libavcodec, keeps both 12 bit counts 21
+	// bytes in.
+	if (p + 24 <= end && (memcmp(p, "LAME", 4) == 0 || memcmp(p, "Lavc", 4) == 0 || memcmp(p, "Lavf", 4) == 0)) {
+		xing->delay = p[21] << 4 | p[22] >> 4;
+		xing->padding = (p[22] & 15) << 8 | p[23];
+	}
+
+	return 1;
+}
+
+void mp3d_init(mp3d *dec) {
+	memset(dec, 0, sizeof(*dec));
+
+	// Codes count up in table order, left aligned.
+	for (int t = 0; t < 15; ++t) {
+		unsigned code = 0;
+		for (int i = mp3d_huff_offsets[t]; i < mp3d_huff_offsets[t] + mp3d_huff_counts[t]; ++i) {
+			dec->huff_codes[i] = code;
+			code += 1u << (32 - mp3d_huff_lens[i]);
+		}
+	}
+
+	for (int i = 0; i < 36; ++i) {
+		for (int k = 0; k < 18; ++k) {
+			dec->imdct_long[i][k] = (float)cos(MP3D_PI / 72 * (2 * i + 1 + 18) * (2 * k + 1));
+		}
+	}
+
+	for (int i = 0; i < 12; ++i) {
+		for (int k = 0; k < 6; ++k) {
+			dec->imdct_short[i][k] = (float)cos(MP3D_PI / 24 * (2 * i + 1 + 6) * (2 * k + 1));
+		}
+		dec->window_short[i] = (float)sin(MP3D_PI / 12 * (i + 0.5));
+	}
+
+	// Normal, start, short (unused) and stop blocks.
+	for (int i = 0; i < 36; ++i) {
+		float normal = (float)sin(MP3D_PI / 36 * (i + 0.5));
+
+		dec->window_long[0][i] = normal;
+		dec->window_long[1][i] = i < 18 ? normal : i < 24 ? 1 : i < 30 ? (float)sin(MP3D_PI / 12 * (i - 18 + 0.5)) : 0;
+		dec->window_long[3][i] = i < 6 ? 0 : i < 12 ? (float)sin(MP3D_PI / 12 * (i - 6 + 0.5)) : i < 18 ? 1 : normal;
+	}
+
+	for (int i = 0; i < 64; ++i) {
+		for (int k = 0; k < 32; ++k) {
+			dec->synth_cos[i][k] = (float)cos((16 + i) * (2 * k + 1) * MP3D_PI / 64);
+		}
+	}
+
+	for (int i = 0; i < 257; ++i) {
+		float value = mp3d_window_half[i] / 65536.f;
+		dec->synth_window[i] = value;
+		if (i > 0 && i < 256)
+			dec->synth_window[512 - i] = i % 64 ? -value : value;
+	}
+}
+
+// Returns 0 for a corrupt side info.
+static int mp3d_side_info(mp3d_bits *bits, const unsigned char *h, int *main_data_begin, int scfsi[2][4], mp3d_granule gr[2][2]) {
+	int is_lsf = !(h[1] & 8);
+	int channels = h[3] >> 6 == 3 ? 1 : 2;
+	int rate_index = mp3d_rate_index(h);
+	const unsigned char *band_long = mp3d_band_long[rate_index];
+
+	*main_data_begin = mp3d_get(bits, is_lsf ? 8 : 9);
+	mp3d_get(bits, is_lsf ? channels : (channels == 1 ? 5 : 3));
+
+	if (!is_lsf) {
+		for (int ch = 0; ch < channels; ++ch) {
+			for (int band = 0; band < 4; ++band) {
+				scfsi[ch][band] = mp3d_get(bits, 1);
+			}
+		}
+	}
+
+	for (int g = 0; g < (is_lsf ? 1 : 2); ++g) {
+		for (int ch = 0; ch < channels; ++ch) {
+			mp3d_granule *granule = &gr[g][ch];
+			memset(granule, 0, sizeof(*granule));
+
+			granule->part2_3_length = mp3d_get(bits, 12);
+			granule->big_values = mp3d_get(bits, 9);
+			granule->global_gain = mp3d_get(bits, 8);
+			granule->scalefac_compress = mp3d_get(bits, is_lsf ? 9 : 4);
+
+			if (granule->big_values > 288)
+				return 0;
+
+			if (mp3d_get(bits, 1)) {
+				granule->block_type = mp3d_get(bits, 2);
+				granule->is_mixed = mp3d_get(bits, 1);
+				granule->table_select[0] = mp3d_get(bits, 5);
+				granule->table_select[1] = mp3d_get(bits, 5);
+				for (int w = 0; w < 3; ++w) {
+					granule->subblock_gain[w] = mp3d_get(bits, 3);
+				}
+
+				if (granule->block_type == 0)
+					return 0;
+
+				// Region 0 is 3 short or 8 long bands, region 1 takes the rest.
+				if (granule->block_type == 2)
+					granule->region1_start = rate_index == 8 ? 72 : 36;
+				else
+					granule->region1_start = rate_index <= 2 ? 36 : rate_index == 8 ? 108 : 54;
+				granule->region2_start = 576;
+			} else {
+				for (int r = 0; r < 3; ++r) {
+					granule->table_select[r] = mp3d_get(bits, 5);
+				}
+
+				int region0_count = mp3d_get(bits, 4);
+				int region1_count = mp3d_get(bits, 3);
+				int region2_band = region0_count + region1_count + 2 < 22 ? region0_count + region1_count + 2 : 22;
+
+				for (int band = 0; band < 22; ++band) {
+					if (band < region0_count + 1)
+						granule->region1_start += band_long[band];
+					if (band < region2_band)
+						granule->region2_start += band_long[band];
+				}
+			}
+
+			if (!is_lsf)
+				granule->preflag = mp3d_get(bits, 1);
+			granule->scalefac_scale = mp3d_get(bits, 1);
+			granule->count1_table = mp3d_get(bits, 1);
+
+			if (granule->block_type == 2) {
+				// Mixed blocks treat the first 36 samples as long bands.
+				granule->long_end = granule->is_mixed ? (rate_index <= 2 ? 8 : 6) : 0;
+				granule->short_start = granule->is_mixed ? 3 : 0;
+			} else {
+				granule->long_end = 22;
+				granule->short_start = 13;
+			}
+		}
+	}
+
+	return 1;
+}
+
+static void mp3d_scalefactors(mp3d_bits *bits, mp3d_granule *granule, const mp3d_granule *first, const int *scfsi, int is_second) {
+	int slen1 = mp3d_slen[granule->scalefac_compress][0];
+	int slen2 = mp3d_slen[granule->scalefac_compress][1];
+	unsigned char *sf = granule->scalefactors;
+
+	if (granule->block_type == 2) {
+		int count1 = granule->is_mixed ? 17 : 18;
+		for (int i = 0; i < count1; ++i) {
+			sf[i] = mp3d_get(bits, slen1);
+		}
+		for (int i = count1; i < count1 + 18; ++i) {
+			sf[i] = mp3d_get(bits, slen2);
+		}
+		return;
+	}
+
+	// Groups of bands the second granule can reuse from the first.
+	static const unsigned char groups[5] = { 0, 6, 11, 16, 21 };
+
+	for (int group = 0; group < 4; ++group) {
+		for (int band = groups[group]; band < groups[group + 1]; ++band) {
+			if (is_second && scfsi[group])
+				sf[band] = first->scalefactors[band];
+			else
+				sf[band] = mp3d_get(bits, group < 2 ? slen1 : slen2);
+		}
+	}
+}
+
+static void mp3d_scalefactors_lsf(mp3d_bits *bits, mp3d_granule *granule, int is_intensity_right) {
+	int sfc = granule->scalefac_compress;
+	int slen[4] = {0};
+	int partition;
+
+	if (is_intensity_right) {
+		sfc >>= 1;
+		if (sfc < 180) {
+			slen[0] = sfc / 36;
+			slen[1] = sfc % 36 / 6;
+			slen[2] = sfc % 6;
+			partition = 3;
+		} else if (sfc < 244) {
+			sfc -= 180;
+			slen[0] = sfc % 64 >> 4;
+			slen[1] = sfc % 16 >> 2;
+			slen[2] = sfc % 4;
+			partition = 4;
+		} else {
+			sfc -= 244;
+			slen[0] = sfc / 3;
+			slen[1] = sfc % 3;
+			partition = 5;
+		}
+	} else if (sfc < 400) {
+		slen[0] = (sfc >> 4) / 5;
+		slen[1] = (sfc >> 4) % 5;
+		slen[2] = (sfc & 15) >> 2;
+		slen[3] = sfc & 3;
+		partition = 0;
+	} else if (sfc < 500) {
+		sfc -= 400;
+		slen[0] = (sfc >> 2) / 5;
+		slen[1] = (sfc >> 2) % 5;
+		slen[2] = sfc & 3;
+		partition = 1;
+	} else {
+		sfc -= 500;
+		slen[0] = sfc / 3;
+		slen[1] = sfc % 3;
+		granule->preflag = 1;
+		partition = 2;
+	}
+
+	int block = granule->block_type != 2 ? 0 : granule->is_mixed ? 2 : 1;
+	int j = 0;
+
+	for (int k = 0; k < 4; ++k) {
+		for (int i = 0; i < mp3d_lsf_nsf[partition][block][k]; ++i) {
+			granule->scalefactors[j++] = mp3d_get(bits, slen[k]);
+		}
+	}
+}
+
+static int mp3d_huff_pair(const mp3d *dec, mp3d_bits *bits, int table) {
+	int first = mp3d_huff_offsets[table];
+	unsigned code = mp3d_peek(bits, 24) << 8;
+
+	// The last entry whose code isn't above the next bits.
+	int lo = 0;
+	int hi = mp3d_huff_counts[table] - 1;
+	while (lo < hi) {
+		int mid = (lo + hi + 1) >> 1;
+		if (dec->huff_codes[first + mid] <= code)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	bits->pos += mp3d_huff_lens[first + lo];
+	return mp3d_huff_symbols[first + lo];
+}
+
+static int mp3d_huff_value(mp3d_bits *bits, int value, int linbits) {
+	if (value == 15 && linbits)
+		value += mp3d_get(bits, linbits);
+	if (value && mp3d_get(bits, 1))
+		value = -value;
+
+	return value;
+}
+
+// Fills values and returns how many of them may be non zero.
+static int mp3d_huffman(const mp3d *dec, mp3d_bits *bits, const mp3d_granule *granule, int end, int *values) {
+	int big_end = granule->big_values * 2;
+	int region_ends[3] = { granule->region1_start, granule->region2_start, 576 };
+	int i = 0;
+
+	for (int r = 0; r < 3; ++r) {
+		int region_end = region_ends[r] < big_end ? region_ends[r] : big_end;
+		int select = granule->table_select[r];
+		int table = mp3d_huff_tables[select];
+		int linbits = mp3d_linbits[select];
+
+		for (; i < region_end; i += 2) {
+			if (table < 0 || bits->pos > end) {
+				values[i] = values[i + 1] = 0;
+				continue;
+			}
+
+			int symbol = mp3d_huff_pair(dec, bits, table);
+			values[i] = mp3d_huff_value(bits, symbol >> 4, linbits);
+			values[i + 1] = mp3d_huff_value(bits, symbol & 15, linbits);
+		}
+	}
+
+	i = big_end;
+	while (i + 4 <= 576 && bits->pos < end) {
+		int quad;
+		if (granule->count1_table) {
+			quad = 15 - mp3d_get(bits, 4);
+		} else {
+			unsigned next = mp3d_peek(bits, 6);
+			for (quad = 0; quad < 15; ++quad) {
+				if (next >> (6 - mp3d_quad_lens[quad]) == mp3d_quad_codes[quad])
+					break;
+			}
+			bits->pos += mp3d_quad_lens[quad];
+		}
+
+		int quad_values[4];
+		for (int k = 0; k < 4; ++k) {
+			quad_values[k] = mp3d_huff_value(bits, quad >> (3 - k) & 1, 0);
+		}
+
+		// The last quad may run past the granule's bits, it isn't part of it.
+		if (bits->pos > end)
+			break;
+
+		for (int k = 0; k < 4; ++k) {
+			values[i + k] = quad_values[k];
+		}
+		i += 4;
+	}
+
+	for (int k = i; k < 576; ++k) {
+		values[k] = 0;
+	}
+
+	return i;
+}
+
+static float mp3d_pow43(int value) {
+	float magnitude = (float)(value < 0 ? -value : value);
+	float result = magnitude < 2 ? magnitude : magnitude * cbrtf(magnitude);
+
+	return value < 0 ? -result : result;
+}
+
+// Scales values into xr, short bands still in bitstream order.
+static void mp3d_requantize(const mp3d_granule *granule, int rate_index, const int *values, float *xr) {
+	float multiplier = granule->scalefac_scale ? 1 : 0.5f;
+	float global = 0.25f * (granule->global_gain - 210);
+	int i = 0;
+
+	for (int band = 0; band < granule->long_end; ++band) {
+		int sf = band < 21 ? granule->scalefactors[band] : 0;
+		if (granule->preflag)
+			sf += mp3d_pretab[band];
+
+		float gain = exp2f(global - multiplier * sf);
+		for (int end = i + mp3d_band_long[rate_index][band]; i < end; ++i) {
+			xr[i] = values[i] ? mp3d_pow43(values[i]) * gain : 0;
+		}
+	}
+
+	for (int band = granule->short_start; band < 13; ++band) {
+		int width = mp3d_band_short[rate_index][band];
+
+		for (int w = 0; w < 3; ++w) {
+			int sf = band < 12 ? granule->scalefactors[granule->long_end + 3 * (band - granule->short_start) + w] : 0;
+			float gain = exp2f(global - 2.f * granule->subblock_gain[w] - multiplier * sf);
+
+			for (int end = i + width; i < end; ++i) {
+				xr[i] = values[i] ? mp3d_pow43(values[i]) * gain : 0;
+			}
+		}
+	}
+}
+
+static void mp3d_mid_side(float *left, float *right, int count) {
+	for (int i = 0; i < count; ++i) {
+		float mid = left[i];
+		float side = right[i];
+		left[i] = (mid + side) * 0.70710678f;
+		right[i] = (mid - side) * 0.70710678f;
+	}
+}
+
+static int mp3d_is_zero(const float *xr, int count) {
+	for (int i = 0; i < count; ++i) {
+		if (xr[i] != 0)
+			return 0;
+	}
+
+	return 1;
+}
+
+// Intensity stereo: returns 0 if position is an illegal one, which codes the
+// band as plain or mid side stereo.
+static int mp3d_intensity_gains(int position, int is_lsf, int scalefac_compress, float *left, float *right) {
+	if (is_lsf) {
+		float gain = exp2f(-(float)((scalefac_compress & 1) + 1) * ((position + 1) >> 1) / 4);
+		*left = position & 1 ? gain : 1;
+		*right = position & 1 ? 1 : gain;
+		return 1;
+	}
+
+	if (position >= 7)
+		return 0;
+
+	if (position == 6) {
+		*left = 1;
+		*right = 0;
+		return 1;
+	}
+
+	float ratio = (float)tan(position * MP3D_PI / 12);
+	*left = ratio / (1 + ratio);
+	*right = 1 / (1 + ratio);
+	return 1;
+}
+
+static void mp3d_intensity_band(float *left, float *right, int count, float left_gain, float right_gain) {
+	for (int i = 0; i < count; ++i) {
+		float value = left[i];
+		left[i] = value * left_gain;
+		right[i] = value * right_gain;
+	}
+}
+
+// On bitstream order. Intensity stereo covers the bands above the last non
+// zero one of the right channel, for short blocks per window. The other
+// bands are mid side coded when that is on too.
+static void mp3d_stereo(float *left, float *right, const mp3d_granule *granule, int rate_index, int mode_ext, int is_lsf) {
+	int is_mid_side = mode_ext & 2;
+
+	if (!(mode_ext & 1)) {
+		if (is_mid_side)
+			mp3d_mid_side(left, right, 576);
+		return;
+	}
+
+	int pos = 576;
+	int is_found[3] = {0};
+	float left_gain, right_gain;
+
+	if (granule->block_type == 2) {
+		for (int band = 12; band >= granule->short_start; --band) {
+			int width = mp3d_band_short[rate_index][band];
+			// The top band has no scalefactor and uses the one below.
+			int sf_band = band == 12 ? 11 : band;
+			int sf_index = granule->long_end + 3 * (sf_band - granule->short_start);
+
+			for (int w = 2; w >= 0; --w) {
+				pos -= width;
+
+				is_found[w] = is_found[w] || !mp3d_is_zero(right + pos, width);
+				if (!is_found[w] && mp3d_intensity_gains(granule->scalefactors[sf_index + w], is_lsf, granule->scalefac_compress, &left_gain, &right_gain))
+					mp3d_intensity_band(left + pos, right + pos, width, left_gain, right_gain);
+				else if (is_mid_side)
+					mp3d_mid_side(left + pos, right + pos, width);
+			}
+		}
+	}
+
+	int is_long_found = is_found[0] || is_found[1] || is_found[2];
+
+	for (int band = granule->long_end - 1; band >= 0; --band) {
+		int width = mp3d_band_long[rate_index][band];
+		pos -= width;
+
+		is_long_found = is_long_found || !mp3d_is_zero(right + pos, width);
+		if (!is_long_found && mp3d_intensity_gains(granule->scalefactors[band == 21 ? 20 : band], is_lsf, granule->scalefac_compress, &left_gain, &right_gain))
+			mp3d_intensity_band(left + pos, right + pos, width, left_gain, right_gain);
+		else if (is_mid_side)
+			mp3d_mid_side(left + pos, right + pos, width);
+	}
+}
+
+// Interleaves each short band's three windows, so every subband holds its 18
+// values as 6 lines of 3 windows.
+static void mp3d_reorder(float *xr, const mp3d_granule *granule, int rate_index) {
+	float tmp[576];
+	int pos = 0;
+
+	if (granule->block_type != 2)
+		return;
+
+	for (int band = 0; band < granule->long_end; ++band) {
+		pos += mp3d_band_long[rate_index][band];
+	}
+
+	for (int band = granule->short_start; band < 13; ++band) {
+		int width = mp3d_band_short[rate_index][band];
+
+		for (int w = 0; w < 3; ++w) {
+			for (int k = 0; k < width; ++k) {
+				tmp[3 * k + w] = xr[pos + w * width + k];
+			}
+		}
+
+		memcpy(xr + pos, tmp, sizeof(float) * 3 * width);
+		pos += 3 * width;
+	}
+}
+
+static void mp3d_antialias(float *xr, const mp3d_granule *granule) {
+	int boundaries = granule->block_type != 2 ? 31 : granule->is_mixed ? 1 : 0;
+
+	for (int sb = 1; sb <= boundaries; ++sb) {
+		for (int i = 0; i < 8; ++i) {
+			float c = mp3d_alias[i];
+			float cs = 1 / sqrtf(1 + c * c);
+			float ca = c * cs;
+			float lo = xr[18 * sb - 1 - i];
+			float hi = xr[18 * sb + i];
+
+			xr[18 * sb - 1 - i] = lo * cs - hi * ca;
+			xr[18 * sb + i] = hi * cs + lo * ca;
+		}
+	}
+}
+
+// Turns each subband's 18 frequency lines into 18 time samples in place,
+// overlapping with the previous granule.
+static void mp3d_imdct(const mp3d *dec, float *xr, float *overlap, const mp3d_granule *granule) {
+	for (int sb = 0; sb < 32; ++sb) {
+		float *in = xr + sb * 18;
+		float out[36] = {0};
+
+		if (granule->block_type == 2 && !(granule->is_mixed && sb < 2)) {
+			for (int w = 0; w < 3; ++w) {
+				for (int i = 0; i < 12; ++i) {
+					float sum = 0;
+					for (int k = 0; k < 6; ++k) {
+						sum += in[3 * k + w] * dec->imdct_short[i][k];
+					}
+					out[6 + 6 * w + i] += sum * dec->window_short[i];
+				}
+			}
+		} else {
+			const float *window = dec->window_long[granule->block_type == 2 ? 0 : granule->block_type];
+			for (int i = 0; i < 36; ++i) {
+				float sum = 0;
+				for (int k = 0; k < 18; ++k) {
+					sum += in[k] * dec->imdct_long[i][k];
+				}
+				out[i] = sum * window[i];
+			}
+		}
+
+		for (int i = 0; i < 18; ++i) {
+			in[i] = out[i] + overlap[sb * 18 + i];
+			overlap[sb * 18 + i] = out[18 + i];
+		}
+
+		// Odd subbands are mirrored in frequency, flip every other sample back.
+		if (sb & 1) {
+			for (int i = 1; i < 18; i += 2) {
+				in[i] = -in[i];
+			}
+		}
+	}
+}
+
+// The polyphase filterbank, 18 times 32 subband samples into 576 samples.
+static void mp3d_synth(mp3d *dec, const float *xr, float *v, float *pcm, int stride) {
+	int pos = dec->synth_pos;
+
+	for (int t = 0; t < 18; ++t) {
+		pos = (pos - 64) & 1023;
+
+		for (int i = 0; i < 64; ++i) {
+			float sum = 0;
+			for (int k = 0; k < 32; ++k) {
+				sum += dec->synth_cos[i][k] * xr[k * 18 + t];
+			}
+			v[pos + i] = sum;
+		}
+
+		for (int j = 0; j < 32; ++j) {
+			float sum = 0;
+			for (int i = 0; i < 8; ++i) {
+				sum += v[(pos + i * 128 + j) & 1023] * dec->synth_window[i * 64 + j];
+				sum += v[(pos + i * 128 + 96 + j) & 1023] * dec->synth_window[i * 64 + 32 + j];
+			}
+			pcm[(t * 32 + j) * stride] = sum;
+		}
+	}
+}
+
+int mp3d_decode_frame(mp3d *dec, const unsigned char *data, int len, float *pcm, mp3d_frame_info *info) {
+	int offset = mp3d_find_frame(data, len, info);
+	if (offset < 0) {
+		// Keep what could be the start of a header.
+		info->frame_bytes = len > 3 ? len - 3 : 0;
+		return 0;
+	}
+
+	if (offset + info->frame_bytes > len) {
+		info->frame_bytes = offset;
+		return 0;
+	}
+
+	const unsigned char *h = data + offset;
+	int frame_bytes = info->frame_bytes;
+	int channels = info->channels;
+	int granules = info->samples / 576;
+	int is_lsf = !(h[1] & 8);
+	int rate_index = mp3d_rate_index(h);
+	int mode_ext = h[3] >> 6 == 1 ? h[3] >> 4 & 3 : 0;
+	int side_start = 4 + (h[1] & 1 ? 0 : 2);
+	int main_start = side_start + mp3d_side_info_size(h);
+
+	info->frame_bytes = offset + frame_bytes;
+
+	// Padded for the bit reader.
+	unsigned char side[32 + 4] = {0};
+	int main_data_begin = 0;
+	int scfsi[2][4] = {{0}};
+	mp3d_granule gr[2][2];
+	int is_valid = main_start <= frame_bytes;
+
+	if (is_valid) {
+		memcpy(side, h + side_start, main_start - side_start);
+		mp3d_bits side_bits = { side, 0 };
+		is_valid = mp3d_side_info(&side_bits, h, &main_data_begin, scfsi, gr);
+	}
+
+	// Main data may start in earlier frames, so it is gathered in one buffer.
+	int reservoir = dec->main_data_len;
+	int main_len = is_valid ? frame_bytes - main_start : 0;
+	memcpy(dec->main_data + reservoir, h + main_start, main_len);
+	dec->main_data_len += main_len;
+	memset(dec->main_data + dec->main_data_len, 0, 16);
+
+	// Right after a seek or a damaged frame there isn't enough of it.
+	is_valid = is_valid && main_data_begin <= reservoir;
+
+	mp3d_bits bits = { dec->main_data + reservoir - (is_valid ? main_data_begin : 0), 0 };
+	int main_bits = (main_data_begin + main_len) * 8;
+
+	for (int g = 0; g < granules; ++g) {
+		float xr[2][576];
+		int values[576];
+
+		for (int ch = 0; ch < channels; ++ch) {
+			mp3d_granule *granule = &gr[g][ch];
+			int start = bits.pos;
+			int end = start + (is_valid ? granule->part2_3_length : 0);
+
+			if (!is_valid || end > main_bits) {
+				memset(xr[ch], 0, sizeof(xr[ch]));
+				if (is_valid)
+					granule->block_type = 0;
+				continue;
+			}
+
+			if (is_lsf)
+				mp3d_scalefactors_lsf(&bits, granule, ch == 1 && (mode_ext & 1));
+			else
+				mp3d_scalefactors(&bits, granule, &gr[0][ch], scfsi[ch], g == 1);
+
+			mp3d_huffman(dec, &bits, granule, end, values);
+			mp3d_requantize(granule, rate_index, values, xr[ch]);
+			bits.pos = end;
+		}
+
+		if (channels == 2 && is_valid)
+			mp3d_stereo(xr[0], xr[1], &gr[g][1], rate_index, mode_ext, is_lsf);
+
+		for (int ch = 0; ch < channels; ++ch) {
+			mp3d_granule *granule = &gr[g][ch];
+			if (!is_valid)
+				memset(granule, 0, sizeof(*granule));
+
+			mp3d_reorder(xr[ch], granule, rate_index);
+			mp3d_antialias(xr[ch], granule);
+			mp3d_imdct(dec, xr[ch], dec->overlap[ch], granule);
+			mp3d_synth(dec, xr[ch], dec->synth[ch], pcm + g * 576 * channels + ch, channels);
+		}
+
+		dec->synth_pos = (dec->synth_pos - 18 * 64) & 1023;
+	}
+
+	// Keep as much as the next frames can point back to.
+	int keep = is_lsf ? 255 : 511;
+	if (dec->main_data_len > keep) {
+		memmove(dec->main_data, dec->main_data + dec->main_data_len - keep, keep);
+		dec->main_data_len = keep;
+	}
+
+	return info->samples;
+}
+
+#endif // MP3_DECODE_IMPLEMENTATION
@@ -18,17 +18,23 @@ typedef struct animation_definition {
 
 typedef struct animation {
 	usize animation_definition_id;
-	f32 current_frame_time;
-	u8 current_frame_index;
 	bool does_loop;
 	bool is_active;
-	bool is_flipped;
 } Animation;
 
+// Playback position, kept by each user of an animation so the ones sharing
+// it don't share frames.
+typedef struct animation_state {
+	f32 frame_time;
+	u8 frame_index;
+	bool is_flipped;
+} Animation_State;
+
 void animation_init(void);
 usize animation_definition_create(Sprite_Sheet *sprite_sheet, f32 duration, u8 row, u8 *columns, u8 frame_count);
 usize animation_create(usize animation_definition_id, bool does_loop);
 void animation_destroy(usize id);
 Animation *animation_get(usize id);
-void animation_update(f32 dt);
-void animation_render(Animation *animation, vec2 position, vec4 color, u32 texture_slots[8]);
+// A zeroed state starts at the first frame.
+void animation_step(usize id, Animation_State *state, f32 dt);
+void animation_render(usize id, const Animation_State *state, vec2 position, vec4 color, u32 texture_slots[8]);
@@ -73,32 +73,30 @@ Animation *animation_get(usize id) {
 	return array_list_get(animation_storage, id);
 }
 
-void animation_update(f32 dt) {
-	for (usize i = 0; i < animation_storage->len; ++i) {
-		Animation *animation = array_list_get(animation_storage, i);
-		Animation_Definition *adef = array_list_get(animation_definition_storage, animation->animation_definition_id);
-		animation->current_frame_time -= dt;
-
-		if (animation->current_frame_time <= 0) {
-			animation->current_frame_index += 1;
-
-			// Loop or stay on last frame.
-			if (animation->current_frame_index == adef->frame_count) {
-				if (animation->does_loop) {
-					animation->current_frame_index = 0;
-				} else {
-					animation->current_frame_index -= 1;
-				}
+void animation_step(usize id, Animation_State *state, f32 dt) {
+	Animation *animation = array_list_get(animation_storage, id);
+	Animation_Definition *adef = array_list_get(animation_definition_storage, animation->animation_definition_id);
+	state->frame_time -= dt;
+
+	if (state->frame_time <= 0) {
+		state->frame_index += 1;
+
+		// Loop or stay on last frame.
+		if (state->frame_index == adef->frame_count) {
+			if (animation->does_loop) {
+				state->frame_index = 0;
+			} else {
+				state->frame_index -= 1;
 			}
-
-			animation->current_frame_time = adef->frames[animation->current_frame_index].duration;
 		}
+
+		state->frame_time = adef->frames[state->frame_index].duration;
 	}
 }
 
-void animation_render(Animation *animation, vec2 position, vec4 color, u32 texture_slots[8]) {
+void animation_render(usize id, const Animation_State *state, vec2 position, vec4 color, u32 texture_slots[8]) {
+    Animation *animation = array_list_get(animation_storage, id);
     Animation_Definition *adef = array_list_get(animation_definition_storage, animation->animation_definition_id);
-    Animation_Frame *aframe = &adef->frames[animation->current_frame_index];
-    render_sprite_sheet_frame(adef->sprite_sheet, aframe->row, aframe->column, position, animation->is_flipped, WHITE, texture_slots);
+    Animation_Frame *aframe = &adef->frames[state->frame_index];
+    render_sprite_sheet_frame(adef->sprite_sheet, aframe->row, aframe->column, position, state->is_flipped, WHITE, texture_slots);
 }
-
@@ -1,9 +1,88 @@
+#pragma once
+
+#include <stdbool.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_mixer.h>
+#include <linmath.h>
+
+#include "types.h"
+
+#define AUDIO_DEFAULT_CHANNELS 16
+#define MAX_AUDIO_CHANNELS 256
+#define MAX_AUDIO_SOUNDS 64
+
+#define AUDIO_DEFAULT_WAV_PATH "audio_out.wav"
+#define AUDIO_DEFAULT_MUSIC_FADE 0.5f
+#define AUDIO_DEFAULT_FULL_VOLUME_RADIUS 160
+#define AUDIO_DEFAULT_AUDIBLE_RADIUS 480
+#define AUDIO_DEFAULT_PAN_WIDTH 320
+
+#define AUDIO_PRIORITY_LOW 64
+#define AUDIO_PRIORITY_NORMAL 128
+#define AUDIO_PRIORITY_HIGH 192
 
+// Per-sound playback rules. A sound that was never given limits plays at
+// normal priority with no cap or cooldown.
+typedef struct audio_sound_limits {
+	u8 priority;
+	// At the cap, the oldest instance of the sound is restarted. 0 is no cap.
+	u8 max_instances;
+	// Plays within this many seconds of the previous one are dropped.
+	f32 cooldown;
+} Audio_Sound_Limits;
+
+typedef struct audio_stats {
+	u64 played;
+	// Dropped because of the sound's cooldown.
+	u64 throttled;
+	// Dropped because every channel held a higher priority sound.
+	u64 dropped;
+	// Channels taken over from a lower priority sound or an older instance.
+	u64 stolen;
+	// Positional plays beyond the audible radius, dropped before picking a channel.
+	u64 culled;
+} Audio_Stats;
+
+typedef struct audio_bank_sound {
+	Mix_Chunk **chunk;
+	const char *path;
+} Audio_Bank_Sound;
+
+// With the engine mixer, music is streamed by the music module and only the
+// path is kept. SDL_mixer loads the whole track up front.
+typedef struct audio_music {
+	Mix_Music *music;
+	char path[256];
+} Audio_Music;
+
+// Reads [audio]. backend is mixer (default) for the engine mixer, whose
+// output is sdl, wav (written to wav_path) or null, or sdl_mixer. The engine
+// mixer streams WAV and MP3 music and fades between tracks over music_fade
+// seconds. Its plays and stops never block, while SDL_mixer's take the audio
+// device lock, so only the engine mixer suits playing from job workers.
 void audio_init(void);
+// Pumps the engine mixer's wav and null outputs, call once per frame.
+void audio_update(void);
+// Closes the engine mixer so a wav output gets its final header.
+void audio_shutdown(void);
 void audio_sound_load(Mix_Chunk **chunk, const char *path);
-void audio_music_load(Mix_Music **music, const char *path);
-void audio_sound_play(Mix_Chunk *sound);
-void audio_music_play(Mix_Music *music);
-
+// Loads every sound from a bank pre-converted to the output format, cached
+// under .cache/sounds and rebuilt when a source changes. The chunks share one
+// buffer that lives until exit. Call after audio_init.
+void audio_bank_load(const Audio_Bank_Sound *sounds, u32 count);
+// Returns NULL on failure. Safe to call off the main thread.
+Mix_Chunk *audio_sound_decode(const char *path);
+// Swaps the replacement's samples into chunk so existing pointers stay valid,
+// then frees the old samples.
+void audio_sound_replace(Mix_Chunk *chunk, Mix_Chunk *replacement);
+void audio_sound_limits(Mix_Chunk *sound, Audio_Sound_Limits limits);
+void audio_music_load(Audio_Music *music, const char *path);
+// Returns the channel, or -1 if the play was throttled or dropped.
+i32 audio_sound_play(Mix_Chunk *sound);
+// Positional plays are attenuated and panned relative to the listener, using
+// [audio] full_volume_radius, audible_radius and pan_width in world units.
+void audio_listener_set(vec2 position);
+// Also returns -1 if the position is out of earshot.
+i32 audio_sound_play_at(Mix_Chunk *sound, vec2 position);
+void audio_music_play(Audio_Music *music);
+Audio_Stats audio_stats(void);
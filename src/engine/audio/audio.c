@@ -1,10 +1,123 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_mixer.h>
 #include "../types.h"
 #include "../util.h"
+#include "../pack.h"
+#include "../time.h"
+#include "../config.h"
+#include "../mixer.h"
+#include "../music.h"
+#include "../audio.h"
+#include "audio_internal.h"
+
+// Matches the Mix_Volume the SDL_mixer backend sets.
+#define AUDIO_SOUND_VOLUME 6
+#define AUDIO_MUSIC_VOLUME 2
+
+typedef struct audio_sound {
+	Mix_Chunk *chunk;
+	Audio_Sound_Limits limits;
+	u64 last_played_ns;
+	bool has_played;
+} Audio_Sound;
+
+// What each mixer channel was last asked to play. Whether it is still
+// playing is asked from the backend, so finished channels need no callback.
+typedef struct audio_voice {
+	Mix_Chunk *chunk;
+	u64 started_ns;
+	u8 priority;
+	// Has SDL_mixer panning or distance effects registered.
+	bool is_positional;
+} Audio_Voice;
+
+typedef struct audio_state {
+	Audio_Sound sounds[MAX_AUDIO_SOUNDS];
+	usize sound_count;
+	Audio_Voice voices[MAX_AUDIO_CHANNELS];
+	i32 channel_count;
+	Audio_Stats stats;
+	// Voices go to the engine mixer instead of SDL_mixer.
+	bool is_engine_mixer;
+	f32 music_fade;
+	vec2 listener;
+	f32 full_volume_radius;
+	f32 audible_radius;
+	f32 pan_width;
+} Audio_State;
+
+static Audio_State state;
+
+static const Audio_Sound_Limits DEFAULT_LIMITS = { .priority = AUDIO_PRIORITY_NORMAL };
+
+// Packed assets are read through an RWops over the mapped archive.
+static SDL_RWops *pack_rw(const char *path) {
+	Pack_View view = pack_find(path);
+	if (!view.is_valid) {
+		return NULL;
+	}
+
+	return SDL_RWFromConstMem(view.data, (i32)view.len);
+}
+
+static Mixer_Output mixer_output(void) {
+	const char *output = config_get_string("audio", "output", "sdl");
+
+	if (strcmp(output, "wav") == 0)
+		return MIXER_OUTPUT_WAV;
+	if (strcmp(output, "null") == 0)
+		return MIXER_OUTPUT_NULL;
+	if (strcmp(output, "sdl") != 0)
+		fprintf(stderr, "Unknown audio output %s, using sdl.\n", output);
+
+	return MIXER_OUTPUT_SDL;
+}
+
+static void open_engine_mixer(void) {
+	i32 sample_rate = config_get_int("audio", "sample_rate", MIXER_DEFAULT_SAMPLE_RATE);
+	const char *wav_path = config_get_string("audio", "wav_path", AUDIO_DEFAULT_WAV_PATH);
+
+	if (!mixer_init(mixer_output(), sample_rate > 0 ? sample_rate : MIXER_DEFAULT_SAMPLE_RATE, 0, wav_path)) {
+		ERROR_EXIT("Could not start the engine mixer\n");
+	}
+}
+
+static void read_positional_config(void) {
+	state.full_volume_radius = config_get_float("audio", "full_volume_radius", AUDIO_DEFAULT_FULL_VOLUME_RADIUS);
+	state.audible_radius = config_get_float("audio", "audible_radius", AUDIO_DEFAULT_AUDIBLE_RADIUS);
+	state.pan_width = config_get_float("audio", "pan_width", AUDIO_DEFAULT_PAN_WIDTH);
+
+	if (state.full_volume_radius < 0 || state.audible_radius <= state.full_volume_radius) {
+		fprintf(stderr, "Audio radii must satisfy 0 <= full_volume_radius < audible_radius, using defaults.\n");
+		state.full_volume_radius = AUDIO_DEFAULT_FULL_VOLUME_RADIUS;
+		state.audible_radius = AUDIO_DEFAULT_AUDIBLE_RADIUS;
+	}
+}
 
 void audio_init(void) {
 	SDL_Init(SDL_INIT_AUDIO);
+	read_positional_config();
+
+	state.is_engine_mixer = strcmp(config_get_string("audio", "backend", "mixer"), "sdl_mixer") != 0;
+
+	i32 max_channels = state.is_engine_mixer ? MAX_MIXER_VOICES : MAX_AUDIO_CHANNELS;
+	i32 channel_count = config_get_int("audio", "channels", AUDIO_DEFAULT_CHANNELS);
+	if (channel_count < 1 || channel_count > max_channels) {
+		fprintf(stderr, "Audio channels must be between 1 and %d, got %d.\n", max_channels, channel_count);
+		channel_count = AUDIO_DEFAULT_CHANNELS;
+	}
+
+	if (state.is_engine_mixer) {
+		open_engine_mixer();
+		music_init();
+		music_gain((f32)AUDIO_MUSIC_VOLUME / MIX_MAX_VOLUME);
+		state.music_fade = config_get_float("audio", "music_fade", AUDIO_DEFAULT_MUSIC_FADE);
+		state.channel_count = channel_count;
+		return;
+	}
 
 	i32 audio_rate = 44100;
 	u16 audio_format = MIX_DEFAULT_FORMAT;
@@ -15,29 +128,337 @@ void audio_init(void) {
 		ERROR_EXIT("SDL_Mixer error: OpenAudio: %s\n", Mix_GetError());
 	}
 
-    Mix_Volume(-1, 6);
-    Mix_VolumeMusic(2);
+	state.channel_count = Mix_AllocateChannels(channel_count);
+
+    Mix_Volume(-1, AUDIO_SOUND_VOLUME);
+    Mix_VolumeMusic(AUDIO_MUSIC_VOLUME);
+}
+
+Audio_Format audio_output_format(void) {
+	if (state.is_engine_mixer)
+		return (Audio_Format){ AUDIO_F32SYS, 2, mixer_sample_rate() };
+
+	i32 frequency, channels;
+	u16 format;
+	Mix_QuerySpec(&frequency, &format, &channels);
+
+	return (Audio_Format){ format, channels, frequency };
+}
+
+void audio_update(void) {
+	if (state.is_engine_mixer)
+		mixer_update();
+}
+
+void audio_shutdown(void) {
+	if (state.is_engine_mixer) {
+		music_shutdown();
+		mixer_shutdown();
+	}
+}
+
+// With the engine mixer a chunk's abuf holds interleaved f32 stereo at the
+// mixer's rate, and the chunk is ours to free.
+static Mix_Chunk *engine_chunk_decode(const char *path) {
+	Mixer_Sound sound;
+	if (!mixer_sound_load_native(&sound, path))
+		return NULL;
+
+	Mix_Chunk *chunk = malloc(sizeof(Mix_Chunk));
+	if (!chunk) {
+		mixer_sound_free(&sound);
+		ERROR_RETURN(NULL, "Not enough memory to load WAV: %s\n", path);
+	}
+
+	*chunk = (Mix_Chunk){
+		.allocated = 1,
+		.abuf = (u8*)sound.samples,
+		.alen = sound.frame_count * sizeof(f32) * 2,
+		.volume = MIX_MAX_VOLUME,
+	};
+
+	return chunk;
+}
+
+// Chunks from a sound bank don't own their samples.
+static void chunk_free(Mix_Chunk *chunk) {
+	if (state.is_engine_mixer) {
+		if (chunk->allocated)
+			free(chunk->abuf);
+		free(chunk);
+	} else {
+		Mix_FreeChunk(chunk);
+	}
+}
+
+static bool channel_playing(i32 channel) {
+	return state.is_engine_mixer ? mixer_voice_is_playing(channel) : Mix_Playing(channel);
+}
+
+static void channel_halt(i32 channel) {
+	if (state.is_engine_mixer)
+		mixer_voice_stop(channel);
+	else
+		Mix_HaltChannel(channel);
+}
+
+// SDL_mixer applies gain and pan as channel effects. They stick to the
+// channel, so they are reset when a centered, full volume sound follows.
+static void channel_effects(i32 channel, f32 gain, f32 pan) {
+	bool is_positional = gain < 1 || pan != 0;
+	if (!is_positional && !state.voices[channel].is_positional)
+		return;
+
+	u8 left = pan > 0 ? (u8)(255 * (1 - pan)) : 255;
+	u8 right = pan < 0 ? (u8)(255 * (1 + pan)) : 255;
+
+	Mix_SetPanning(channel, left, right);
+	Mix_SetDistance(channel, (u8)(255 * (1 - gain)));
+}
+
+static i32 channel_play(i32 channel, Mix_Chunk *chunk, f32 gain, f32 pan) {
+	if (!state.is_engine_mixer) {
+		channel_effects(channel, gain, pan);
+		return Mix_PlayChannel(channel, chunk, 0);
+	}
+
+	Mixer_Sound sound = {
+		.samples = (f32*)chunk->abuf,
+		.frame_count = chunk->alen / (sizeof(f32) * 2),
+		.channels = 2,
+		.sample_rate = mixer_sample_rate(),
+	};
+	Mixer_Voice_Params params = {
+		.gain = gain * AUDIO_SOUND_VOLUME / MIX_MAX_VOLUME,
+		.pan = pan,
+		.pitch = 1,
+	};
+
+	return mixer_voice_play(channel, &sound, params) ? channel : -1;
+}
+
+Mix_Chunk *audio_sound_decode(const char *path) {
+	if (state.is_engine_mixer)
+		return engine_chunk_decode(path);
+
+	SDL_RWops *rw = pack_rw(path);
+	Mix_Chunk *chunk = rw ? Mix_LoadWAV_RW(rw, 1) : Mix_LoadWAV(path);
+	if (!chunk) {
+		ERROR_RETURN(NULL, "Failed to load WAV %s: %s\n", path, Mix_GetError());
+	}
+
+	return chunk;
 }
 
 void audio_sound_load(Mix_Chunk **chunk, const char *path) {
-	*chunk = Mix_LoadWAV(path);
+	*chunk = audio_sound_decode(path);
 	if (!*chunk) {
-		ERROR_EXIT("Failed to load WAV: %s\n", Mix_GetError());
+		ERROR_EXIT("Failed to load WAV: %s\n", path);
+	}
+}
+
+void audio_sound_replace(Mix_Chunk *chunk, Mix_Chunk *replacement) {
+	// Channels read straight from the chunk's buffer, stop them before it goes away.
+	for (i32 i = 0; i < state.channel_count; ++i) {
+		if (state.voices[i].chunk == chunk && channel_playing(i)) {
+			channel_halt(i);
+		}
 	}
+
+	// The engine mixer sees halts at its next render, wait until it has let go.
+	if (state.is_engine_mixer)
+		mixer_sync();
+
+	Mix_Chunk tmp = *chunk;
+	*chunk = *replacement;
+	*replacement = tmp;
+
+	chunk_free(replacement);
 }
 
-void audio_music_load(Mix_Music **music, const char *path) {
-	*music = Mix_LoadMUS(path);
-	if (!*music) {
+static bool is_streamable_path(const char *path) {
+	usize len = strlen(path);
+	return len >= 4 && (SDL_strcasecmp(path + len - 4, ".wav") == 0 || SDL_strcasecmp(path + len - 4, ".mp3") == 0);
+}
+
+void audio_music_load(Audio_Music *music, const char *path) {
+	*music = (Audio_Music){0};
+
+	if (state.is_engine_mixer) {
+		// Only the path is kept, the music thread opens and decodes the track.
+		if (!is_streamable_path(path)) {
+			ERROR_RETURN(, "The engine mixer only streams WAV and MP3 music, %s will not play\n", path);
+		}
+		if (strlen(path) >= sizeof(music->path)) {
+			ERROR_EXIT("Music path too long: %s\n", path);
+		}
+		strcpy(music->path, path);
+		return;
+	}
+
+	SDL_RWops *rw = pack_rw(path);
+	music->music = rw ? Mix_LoadMUS_RW(rw, 1) : Mix_LoadMUS(path);
+	if (!music->music) {
 		ERROR_EXIT("Failed to load music file %s: %s\n", path, Mix_GetError());
 	}
 }
 
-void audio_sound_play(Mix_Chunk *sound) {
-	Mix_PlayChannel(-1, sound, 0);
+static Audio_Sound *sound_get(Mix_Chunk *chunk, bool is_create) {
+	for (usize i = 0; i < state.sound_count; ++i) {
+		if (state.sounds[i].chunk == chunk)
+			return &state.sounds[i];
+	}
+
+	if (!is_create)
+		return NULL;
+
+	if (state.sound_count == MAX_AUDIO_SOUNDS)
+		ERROR_RETURN(NULL, "Too many sounds with limits, max is %d\n", MAX_AUDIO_SOUNDS);
+
+	Audio_Sound *sound = &state.sounds[state.sound_count++];
+	*sound = (Audio_Sound){ .chunk = chunk, .limits = DEFAULT_LIMITS };
+
+	return sound;
+}
+
+void audio_sound_limits(Mix_Chunk *chunk, Audio_Sound_Limits limits) {
+	Audio_Sound *sound = sound_get(chunk, true);
+	if (sound)
+		sound->limits = limits;
+}
+
+// Picks a channel for a new voice: the oldest instance of the same sound if
+// it is at its cap, else a free channel, else the oldest of the lowest
+// priority voices as long as it isn't more important than the new one.
+static i32 voice_pick(Mix_Chunk *chunk, Audio_Sound_Limits *limits, bool *is_steal) {
+	i32 free_channel = -1;
+	i32 oldest_instance = -1;
+	i32 victim = -1;
+	u32 instances = 0;
+
+	for (i32 i = 0; i < state.channel_count; ++i) {
+		Audio_Voice *voice = &state.voices[i];
+
+		if (!channel_playing(i)) {
+			if (free_channel < 0)
+				free_channel = i;
+			continue;
+		}
+
+		if (voice->chunk == chunk) {
+			++instances;
+			if (oldest_instance < 0 || voice->started_ns < state.voices[oldest_instance].started_ns)
+				oldest_instance = i;
+		}
+
+		if (voice->priority <= limits->priority) {
+			Audio_Voice *current = victim >= 0 ? &state.voices[victim] : NULL;
+			if (!current || voice->priority < current->priority
+					|| (voice->priority == current->priority && voice->started_ns < current->started_ns))
+				victim = i;
+		}
+	}
+
+	*is_steal = true;
+
+	if (limits->max_instances > 0 && instances >= limits->max_instances)
+		return oldest_instance;
+
+	if (free_channel >= 0) {
+		*is_steal = false;
+		return free_channel;
+	}
+
+	return victim;
+}
+
+static i32 sound_play(Mix_Chunk *chunk, f32 gain, f32 pan) {
+	Audio_Sound *sound = sound_get(chunk, false);
+	Audio_Sound_Limits limits = sound ? sound->limits : DEFAULT_LIMITS;
+	u64 now = time_now_ns();
+
+	if (sound && sound->has_played && now - sound->last_played_ns < (u64)(limits.cooldown * 1e9)) {
+		++state.stats.throttled;
+		return -1;
+	}
+
+	bool is_steal;
+	i32 channel = voice_pick(chunk, &limits, &is_steal);
+	if (channel < 0) {
+		++state.stats.dropped;
+		return -1;
+	}
+
+	if (is_steal) {
+		channel_halt(channel);
+		++state.stats.stolen;
+	}
+
+	channel = channel_play(channel, chunk, gain, pan);
+	if (channel < 0) {
+		++state.stats.dropped;
+		return -1;
+	}
+
+	state.voices[channel] = (Audio_Voice){
+		.chunk = chunk,
+		.started_ns = now,
+		.priority = limits.priority,
+		.is_positional = gain < 1 || pan != 0,
+	};
+
+	if (sound) {
+		sound->last_played_ns = now;
+		sound->has_played = true;
+	}
+
+	++state.stats.played;
+
+	return channel;
 }
 
-void audio_music_play(Mix_Music *music) {
-	Mix_PlayMusic(music, -1);
+i32 audio_sound_play(Mix_Chunk *chunk) {
+	return sound_play(chunk, 1, 0);
+}
+
+void audio_listener_set(vec2 position) {
+	state.listener[0] = position[0];
+	state.listener[1] = position[1];
+}
+
+// Full volume within full_volume_radius, fading out with the square of the
+// distance to audible_radius. Pan follows the horizontal offset.
+i32 audio_sound_play_at(Mix_Chunk *chunk, vec2 position) {
+	f32 dx = position[0] - state.listener[0];
+	f32 dy = position[1] - state.listener[1];
+	f32 distance = sqrtf(dx * dx + dy * dy);
+
+	if (distance >= state.audible_radius) {
+		++state.stats.culled;
+		return -1;
+	}
+
+	f32 gain = 1;
+	if (distance > state.full_volume_radius) {
+		f32 t = 1 - (distance - state.full_volume_radius) / (state.audible_radius - state.full_volume_radius);
+		gain = t * t;
+	}
+
+	f32 pan = state.pan_width > 0 ? dx / state.pan_width : 0;
+	pan = pan < -1 ? -1 : pan > 1 ? 1 : pan;
+
+	return sound_play(chunk, gain, pan);
+}
+
+Audio_Stats audio_stats(void) {
+	return state.stats;
+}
+
+void audio_music_play(Audio_Music *music) {
+	if (music->music) {
+		Mix_PlayMusic(music->music, -1);
+	} else if (music->path[0]) {
+		music_play(music->path, state.music_fade);
+	}
 }
 
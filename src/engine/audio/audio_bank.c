@@ -0,0 +1,292 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+
+#include "../util.h"
+#include "../io.h"
+#include "../pack.h"
+#include "../hash.h"
+#include "../audio.h"
+#include "audio_internal.h"
+
+// Sound effects are converted once to the output format and stored back to
+// back in a single bank file, which later runs read in one go. Chunks point
+// into that buffer, so a whole set of sounds costs two allocations.
+//
+// Like the texture cache, an entry is current when the source's size and
+// mtime match, or failing the mtime, its contents hash the same. Sources in
+// the mounted pack are compared by the hash stored in their pack entry. Any
+// stale entry rebuilds the bank.
+//
+// The bank is mapped, so samples at SOUND_BANK_ALIGNMENT offsets are aligned
+// in memory too.
+
+#define SOUND_BANK_DIR ".cache"
+#define SOUND_BANK_SOUND_DIR SOUND_BANK_DIR "/sounds"
+#define SOUND_BANK_MAGIC 0x4b4e4253 // "SBNK"
+#define SOUND_BANK_VERSION 1
+#define SOUND_BANK_ALIGNMENT 64
+
+// Followed by sound_count entries, then the samples.
+typedef struct sound_bank_header {
+	u32 magic;
+	u32 version;
+	u32 format;
+	u32 channels;
+	u32 sample_rate;
+	u32 sound_count;
+	u64 size;
+} Sound_Bank_Header;
+
+typedef struct sound_bank_entry {
+	u64 path_hash;
+	u64 source_size;
+	i64 source_modified;
+	u64 source_hash;
+	// From the start of the file, aligned to SOUND_BANK_ALIGNMENT.
+	u64 offset;
+	u64 size;
+} Sound_Bank_Entry;
+
+typedef struct converted_sound {
+	u8 *data;
+	usize size;
+	Sound_Bank_Entry entry;
+} Converted_Sound;
+
+static usize align_up(usize value) {
+	return (value + SOUND_BANK_ALIGNMENT - 1) & ~(usize)(SOUND_BANK_ALIGNMENT - 1);
+}
+
+// One bank per sound list and output format.
+static void bank_path(char *buffer, usize size, const Audio_Bank_Sound *sounds, u32 count, Audio_Format *format) {
+	u64 key = hash_bytes(format, sizeof(*format));
+	for (u32 i = 0; i < count; ++i) {
+		key = key * 0x100000001b3ULL ^ hash_string(pack_path_normalize(sounds[i].path));
+	}
+
+	snprintf(buffer, size, SOUND_BANK_SOUND_DIR "/%016llx.bank", (unsigned long long)key);
+}
+
+// Sets is_touched when only the mtime is stale.
+static bool source_is_current(const char *path, Sound_Bank_Entry *entry, bool *is_touched) {
+	if (entry->path_hash != hash_string(pack_path_normalize(path)))
+		return false;
+
+	Pack_View view = pack_find(path);
+	if (view.is_valid)
+		return view.len == entry->source_size && view.hash == entry->source_hash;
+
+	File_Info info;
+	if (!io_file_info(path, &info) || info.size != entry->source_size)
+		return false;
+
+	if (info.modified == entry->source_modified)
+		return true;
+
+	File source = io_file_map(path, IO_MAP_SEQUENTIAL);
+	bool is_same = source.is_valid && hash_bytes(source.data, source.len) == entry->source_hash;
+	io_file_unmap(&source);
+
+	*is_touched = is_same;
+	return is_same;
+}
+
+static bool bank_is_valid(File *file, const char *path, const Audio_Bank_Sound *sounds, u32 count, Audio_Format *format) {
+	if (file->len < sizeof(Sound_Bank_Header))
+		return false;
+
+	Sound_Bank_Header *header = (Sound_Bank_Header*)file->data;
+	usize table_end = sizeof(Sound_Bank_Header) + sizeof(Sound_Bank_Entry) * count;
+
+	if (header->magic != SOUND_BANK_MAGIC
+			|| header->version != SOUND_BANK_VERSION
+			|| header->format != format->format
+			|| header->channels != format->channels
+			|| header->sample_rate != format->sample_rate
+			|| header->sound_count != count
+			|| header->size != file->len
+			|| file->len < table_end)
+		return false;
+
+	Sound_Bank_Entry *entries = (Sound_Bank_Entry*)(header + 1);
+
+	for (u32 i = 0; i < count; ++i) {
+		if (entries[i].offset < table_end || entries[i].offset + entries[i].size > file->len)
+			return false;
+	}
+
+	for (u32 i = 0; i < count; ++i) {
+		bool is_touched = false;
+		if (!source_is_current(sounds[i].path, &entries[i], &is_touched))
+			return false;
+
+		// Record the new mtime so later runs can skip the hash again.
+		if (is_touched) {
+			File_Info info;
+			u64 offset = sizeof(Sound_Bank_Header) + sizeof(Sound_Bank_Entry) * i + offsetof(Sound_Bank_Entry, source_modified);
+			if (io_file_info(sounds[i].path, &info))
+				io_file_patch(path, offset, &info.modified, sizeof(info.modified));
+		}
+	}
+
+	return true;
+}
+
+static bool sound_convert(const char *path, Audio_Format *format, Converted_Sound *sound) {
+	Pack_View view = pack_find(path);
+	File source = {0};
+
+	if (!view.is_valid) {
+		File_Info info;
+		source = io_file_map(path, IO_MAP_SEQUENTIAL);
+		if (!source.is_valid || !io_file_info(path, &info)) {
+			io_file_unmap(&source);
+			ERROR_RETURN(false, "Cannot read sound: %s\n", path);
+		}
+
+		view = (Pack_View){ .data = (u8*)source.data, .len = source.len, .hash = hash_bytes(source.data, source.len), .is_valid = true };
+		sound->entry.source_modified = info.modified;
+	}
+
+	sound->entry.path_hash = hash_string(pack_path_normalize(path));
+	sound->entry.source_size = view.len;
+	sound->entry.source_hash = view.hash;
+
+	SDL_AudioSpec spec;
+	u8 *wav_data;
+	u32 wav_len;
+	bool is_loaded = SDL_LoadWAV_RW(SDL_RWFromConstMem(view.data, (i32)view.len), 1, &spec, &wav_data, &wav_len) != NULL;
+	io_file_unmap(&source);
+
+	if (!is_loaded)
+		ERROR_RETURN(false, "Failed to load WAV %s: %s\n", path, SDL_GetError());
+
+	SDL_AudioCVT cvt;
+	if (SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq, format->format, format->channels, format->sample_rate) < 0) {
+		SDL_FreeWAV(wav_data);
+		ERROR_RETURN(false, "Cannot convert WAV %s: %s\n", path, SDL_GetError());
+	}
+
+	cvt.len = wav_len;
+	cvt.buf = malloc((usize)wav_len * cvt.len_mult);
+	if (!cvt.buf) {
+		SDL_FreeWAV(wav_data);
+		ERROR_RETURN(false, "Not enough memory to convert WAV: %s\n", path);
+	}
+
+	memcpy(cvt.buf, wav_data, wav_len);
+	SDL_FreeWAV(wav_data);
+
+	if (SDL_ConvertAudio(&cvt) < 0) {
+		free(cvt.buf);
+		ERROR_RETURN(false, "Cannot convert WAV %s: %s\n", path, SDL_GetError());
+	}
+
+	sound->data = cvt.buf;
+	sound->size = cvt.len_cvt;
+	sound->entry.size = cvt.len_cvt;
+
+	return true;
+}
+
+// Returns the bank as it would be read from disk, or an invalid File.
+static File bank_build(const Audio_Bank_Sound *sounds, u32 count, Audio_Format *format, const char *path) {
+	Converted_Sound *converted = calloc(count, sizeof(Converted_Sound));
+	if (!converted)
+		ERROR_RETURN((File){0}, "Not enough memory to build sound bank\n");
+
+	usize size = align_up(sizeof(Sound_Bank_Header) + sizeof(Sound_Bank_Entry) * count);
+	bool is_ok = true;
+
+	for (u32 i = 0; i < count && is_ok; ++i) {
+		is_ok = sound_convert(sounds[i].path, format, &converted[i]);
+		converted[i].entry.offset = size;
+		size = align_up(size + converted[i].size);
+	}
+
+	u8 *buffer = is_ok ? aligned_alloc(SOUND_BANK_ALIGNMENT, size) : NULL;
+
+	if (buffer) {
+		memset(buffer, 0, size);
+		*(Sound_Bank_Header*)buffer = (Sound_Bank_Header){
+			.magic = SOUND_BANK_MAGIC,
+			.version = SOUND_BANK_VERSION,
+			.format = format->format,
+			.channels = format->channels,
+			.sample_rate = format->sample_rate,
+			.sound_count = count,
+			.size = size,
+		};
+
+		Sound_Bank_Entry *entries = (Sound_Bank_Entry*)(buffer + sizeof(Sound_Bank_Header));
+		for (u32 i = 0; i < count; ++i) {
+			entries[i] = converted[i].entry;
+			memcpy(buffer + entries[i].offset, converted[i].data, converted[i].size);
+		}
+	}
+
+	for (u32 i = 0; i < count; ++i) {
+		free(converted[i].data);
+	}
+	free(converted);
+
+	if (!buffer)
+		return (File){0};
+
+	if (io_dir_create(SOUND_BANK_DIR) && io_dir_create(SOUND_BANK_SOUND_DIR))
+		io_file_write(buffer, size, path);
+
+	return (File){ .data = (char*)buffer, .len = size, .is_valid = true };
+}
+
+void audio_bank_load(const Audio_Bank_Sound *sounds, u32 count) {
+	Audio_Format format = audio_output_format();
+
+	char path[64];
+	bank_path(path, sizeof(path), sounds, count, &format);
+
+	File file = io_file_exists(path) ? io_file_map(path, IO_MAP_SEQUENTIAL) : (File){0};
+	if (file.is_valid && !bank_is_valid(&file, path, sounds, count, &format)) {
+		io_file_unmap(&file);
+	}
+
+	// Read instead of mapped where mapping is unavailable, and only malloc
+	// aligned then.
+	if (file.is_valid && !file.is_mapped) {
+		u8 *aligned = aligned_alloc(SOUND_BANK_ALIGNMENT, align_up(file.len));
+		if (!aligned)
+			ERROR_EXIT("Not enough memory for sound bank\n");
+
+		memcpy(aligned, file.data, file.len);
+		free(file.data);
+		file.data = (char*)aligned;
+	}
+
+	if (!file.is_valid) {
+		printf("Building sound bank %s\n", path);
+		file = bank_build(sounds, count, &format, path);
+		if (!file.is_valid)
+			ERROR_EXIT("Failed to build sound bank\n");
+	}
+
+	Mix_Chunk *chunks = malloc(sizeof(Mix_Chunk) * count);
+	if (!chunks)
+		ERROR_EXIT("Not enough memory for sound bank chunks\n");
+
+	Sound_Bank_Entry *entries = (Sound_Bank_Entry*)(file.data + sizeof(Sound_Bank_Header));
+
+	// Not allocated, so freeing a chunk leaves the bank's samples alone. The
+	// bank lives until exit.
+	for (u32 i = 0; i < count; ++i) {
+		chunks[i] = (Mix_Chunk){
+			.abuf = (u8*)file.data + entries[i].offset,
+			.alen = entries[i].size,
+			.volume = MIX_MAX_VOLUME,
+		};
+		*sounds[i].chunk = &chunks[i];
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include "../types.h"
+
+// The sample layout chunks must be in for the active backend.
+typedef struct audio_format {
+	SDL_AudioFormat format;
+	u32 channels;
+	u32 sample_rate;
+} Audio_Format;
+
+Audio_Format audio_output_format(void);
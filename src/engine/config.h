@@ -1,12 +1,25 @@
 #pragma once
 
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
 #include "input.h"
 #include "types.h"
 
-typedef struct config {
-	u8 keybinds[5];
-} Config_State;
+typedef void (*Config_Visit)(const char *key, const char *value, void *user_data);
 
 void config_init(void);
-void config_key_bind(Input_Key key, const char *key_name);
+void config_reload(void);
+// Binds the action to a comma-separated list of key names, replacing its
+// previous bindings.
+void config_key_bind(u32 action, const char *key_names);
+// Calls visit for every key in the section, in no particular order.
+void config_section_visit(const char *section, Config_Visit visit, void *user_data);
 
+// Constant-time lookups into the parsed config.ini. Missing keys return
+// default_value, as do malformed values after a warning.
+const char *config_get_string(const char *section, const char *key, const char *default_value);
+i32 config_get_int(const char *section, const char *key, i32 default_value);
+f32 config_get_float(const char *section, const char *key, f32 default_value);
+bool config_get_bool(const char *section, const char *key, bool default_value);
+SDL_Scancode config_get_scancode(const char *section, const char *key, SDL_Scancode default_value);
@@ -1,82 +1,362 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
 #include "../global.h"
 #include "../io.h"
+#include "../pack.h"
 #include "../util.h"
+#include "../hash.h"
 #include "../input.h"
 #include "../config.h"
 
+// config.ini is parsed in one pass into an open-addressed table keyed by
+// section and key. The parser keeps its own copy of the text and terminates
+// names and values in place, so entries point straight into it.
+
+#define MAX_CONFIG_ENTRIES 256
+#define CONFIG_TABLE_SIZE (MAX_CONFIG_ENTRIES * 2)
+
+typedef struct config_entry {
+	u64 hash;
+	const char *section;
+	const char *key;
+	const char *value;
+} Config_Entry;
+
+typedef struct config_store {
+	char *text;
+	Config_Entry table[CONFIG_TABLE_SIZE];
+	usize entry_count;
+} Config_Store;
+
+static Config_Store store;
+
 static const char *CONFIG_DEFAULT =
 	"[controls]\n"
 	"left = A\n"
 	"right = D\n"
 	"up = W\n"
-	"down = S\n"
+	"shoot = Space\n"
 	"escape = Escape\n"
+	"\n"
+	"[physics]\n"
+	"gravity = -79\n"
+	"terminal_velocity = -7000\n"
+	"iterations = 4\n"
+	"\n"
+	"[render]\n"
+	"window_width = 1920\n"
+	"window_height = 1080\n"
+	"scale = 3\n"
+	"\n"
+	"[time]\n"
+	"frame_rate = 60\n"
+	"\n"
+	"[audio]\n"
+	"channels = 16\n"
+	"backend = mixer\n"
+	"output = sdl\n"
+	"music_fade = 0.5\n"
+	"full_volume_radius = 160\n"
+	"audible_radius = 480\n"
+	"pan_width = 320\n"
+	"\n"
+	"[jobs]\n"
+	"worker_count = -1\n"
+	"parallel_systems = true\n"
 	"\n";
 
-static char tmp_buffer[20] = {0};
+static u64 key_hash(const char *section, const char *key) {
+	u64 hash = hash_string(section) ^ (hash_string(key) * 0x9e3779b97f4a7c15ULL);
+	return hash ? hash : 1;
+}
+
+static Config_Entry *entry_find(Config_Store *s, const char *section, const char *key) {
+	u64 hash = key_hash(section, key);
+
+	for (usize i = 0; i < CONFIG_TABLE_SIZE; ++i) {
+		Config_Entry *entry = &s->table[(hash + i) & (CONFIG_TABLE_SIZE - 1)];
+		if (entry->hash == 0)
+			return entry;
+		if (entry->hash == hash && strcmp(entry->section, section) == 0 && strcmp(entry->key, key) == 0)
+			return entry;
+	}
+
+	return NULL;
+}
+
+static char *trim(char *start, char *end) {
+	while (start < end && isspace((u8)*start))
+		++start;
+	while (end > start && isspace((u8)end[-1]))
+		--end;
+	*end = 0;
+
+	return start;
+}
+
+static bool store_parse(Config_Store *s, const char *source, usize len) {
+	*s = (Config_Store){0};
+
+	s->text = malloc(len + 1);
+	if (!s->text)
+		ERROR_RETURN(false, "Not enough free memory to parse config.\n");
+
+	memcpy(s->text, source, len);
+	s->text[len] = 0;
+
+	const char *section = "";
+	char *line = s->text;
+	char *text_end = s->text + len;
+
+	for (u32 line_number = 1; line < text_end; ++line_number) {
+		char *line_end = memchr(line, '\n', text_end - line);
+		if (!line_end)
+			line_end = text_end;
+		char *next = line_end + 1;
 
-static char *config_get_value(const char *config_buffer, const char *value) {
-	char *line = strstr(config_buffer, value);
-	if (!line)
-		ERROR_EXIT("Could not find config value: %s. "
-				"Try deleting config.ini and restarting.\n", value);
+		char *comment = line;
+		while (comment < line_end && *comment != ';' && *comment != '#')
+			++comment;
 
-	usize len = strlen(line);
-	char *end = line + len;
+		char *content = trim(line, comment);
+		line = next;
 
-	char *curr = line;
-	char *tmp_ptr = &tmp_buffer[0];
-	// Move pointer to '='.
-	while (*curr != '=' && curr != end)
-		++curr;
-	// Consume '='.
-	++curr;
-	// Consume any spaces.
-	while (*curr == ' ')
-		++curr;
-	// Get characters until end of line.
-	while (*curr != '\n' && *curr != 0 && curr != end)
-		*tmp_ptr++ = *curr++;
+		if (*content == 0)
+			continue;
 
-	*(tmp_ptr+1) = 0;
+		if (*content == '[') {
+			char *close = strchr(content, ']');
+			if (!close) {
+				fprintf(stderr, "config.ini:%u: Unterminated section header.\n", line_number);
+				continue;
+			}
+			section = trim(content + 1, close);
+			continue;
+		}
 
-	return tmp_buffer;
+		char *equals = strchr(content, '=');
+		if (!equals) {
+			fprintf(stderr, "config.ini:%u: Expected key = value.\n", line_number);
+			continue;
+		}
+
+		char *value = trim(equals + 1, content + strlen(content));
+		char *key = trim(content, equals);
+
+		Config_Entry *entry = entry_find(s, section, key);
+		if (!entry || (entry->hash == 0 && s->entry_count == MAX_CONFIG_ENTRIES)) {
+			fprintf(stderr, "config.ini:%u: Too many entries, max is %d.\n", line_number, MAX_CONFIG_ENTRIES);
+			break;
+		}
+
+		if (entry->hash == 0)
+			++s->entry_count;
+
+		// Later duplicates win, like most INI readers.
+		*entry = (Config_Entry){
+			.hash = key_hash(section, key),
+			.section = section,
+			.key = key,
+			.value = value,
+		};
+	}
+
+	return true;
 }
 
-static void load_controls(const char *config_buffer) {
-	config_key_bind(INPUT_KEY_LEFT, config_get_value(config_buffer, "left"));
-	config_key_bind(INPUT_KEY_RIGHT, config_get_value(config_buffer, "right"));
-	config_key_bind(INPUT_KEY_UP, config_get_value(config_buffer, "up"));
-	config_key_bind(INPUT_KEY_SHOOT, config_get_value(config_buffer, "shoot"));
-	config_key_bind(INPUT_KEY_ESCAPE, config_get_value(config_buffer, "escape"));
+static void bind_control(const char *key, const char *value, void *user_data) {
+	u32 action = input_action_get(key);
+	if (action != INPUT_ACTION_NONE)
+		config_key_bind(action, value);
+}
+
+// Every entry in [controls] is an action. The built-in ones fall back to the
+// default keys when missing.
+static void load_controls(void) {
+	static const SDL_Scancode defaults[INPUT_KEY_COUNT] = {
+		[INPUT_KEY_LEFT] = SDL_SCANCODE_A,
+		[INPUT_KEY_RIGHT] = SDL_SCANCODE_D,
+		[INPUT_KEY_UP] = SDL_SCANCODE_W,
+		[INPUT_KEY_SHOOT] = SDL_SCANCODE_SPACE,
+		[INPUT_KEY_ESCAPE] = SDL_SCANCODE_ESCAPE,
+	};
+
+	for (u32 i = 0; i < INPUT_KEY_COUNT; ++i) {
+		input_action_unbind_all(i);
+		input_action_bind(i, defaults[i]);
+	}
+
+	config_section_visit("controls", bind_control, NULL);
+}
+
+// Parses into a fresh store and only replaces the current one on success.
+static int config_apply(const char *source, usize len) {
+	Config_Store *parsed = malloc(sizeof(Config_Store));
+	if (!parsed)
+		ERROR_RETURN(1, "Not enough free memory to parse config.\n");
+
+	if (!store_parse(parsed, source, len)) {
+		free(parsed);
+		return 1;
+	}
+
+	free(store.text);
+	store = *parsed;
+	free(parsed);
+
+	load_controls();
+
+	return 0;
 }
 
 static int config_load(void) {
-	File file_config = io_file_read("./config.ini");
+	File file_config = io_file_map("./config.ini", IO_MAP_SEQUENTIAL);
 	if (!file_config.is_valid)
 		return 1;
 
-	load_controls(file_config.data);
+	int result = config_apply(file_config.data, file_config.len);
 
-	free(file_config.data);
+	io_file_unmap(&file_config);
 
-	return 0;
+	return result;
+}
+
+static int config_load_packed(void) {
+	Pack_View view = pack_find("./config.ini");
+	if (!view.is_valid)
+		return 1;
+
+	return config_apply((const char*)view.data, view.len);
 }
 
 void config_init(void) {
 	if (config_load() == 0)
 		return;
 
+	// No user config on disk, use the shipped one if there is one.
+	if (config_load_packed() == 0)
+		return;
+
 	io_file_write((void*)CONFIG_DEFAULT, strlen(CONFIG_DEFAULT), "./config.ini");
 
 	if (config_load() != 0)
 		ERROR_EXIT("Could not create or load config file.\n");
 }
 
-void config_key_bind(Input_Key key, const char *key_name) {
-	SDL_Scancode scan_code = SDL_GetScancodeFromName(key_name);
+void config_reload(void) {
+	if (config_load() != 0)
+		ERROR_RETURN(, "Could not reload config file, keeping current settings.\n");
+}
+
+const char *config_get_string(const char *section, const char *key, const char *default_value) {
+	Config_Entry *entry = entry_find(&store, section, key);
+	if (!entry || entry->hash == 0)
+		return default_value;
+
+	return entry->value;
+}
+
+i32 config_get_int(const char *section, const char *key, i32 default_value) {
+	const char *value = config_get_string(section, key, NULL);
+	if (!value)
+		return default_value;
+
+	char *end;
+	long result = strtol(value, &end, 10);
+	if (end == value || *end != 0)
+		ERROR_RETURN(default_value, "Config [%s] %s: expected an integer, got \"%s\".\n", section, key, value);
+
+	return (i32)result;
+}
+
+f32 config_get_float(const char *section, const char *key, f32 default_value) {
+	const char *value = config_get_string(section, key, NULL);
+	if (!value)
+		return default_value;
+
+	char *end;
+	f32 result = strtof(value, &end);
+	if (end == value || *end != 0)
+		ERROR_RETURN(default_value, "Config [%s] %s: expected a number, got \"%s\".\n", section, key, value);
+
+	return result;
+}
+
+bool config_get_bool(const char *section, const char *key, bool default_value) {
+	const char *value = config_get_string(section, key, NULL);
+	if (!value)
+		return default_value;
+
+	if (SDL_strcasecmp(value, "true") == 0 || SDL_strcasecmp(value, "yes") == 0
+			|| SDL_strcasecmp(value, "on") == 0 || strcmp(value, "1") == 0)
+		return true;
+
+	if (SDL_strcasecmp(value, "false") == 0 || SDL_strcasecmp(value, "no") == 0
+			|| SDL_strcasecmp(value, "off") == 0 || strcmp(value, "0") == 0)
+		return false;
+
+	ERROR_RETURN(default_value, "Config [%s] %s: expected true or false, got \"%s\".\n", section, key, value);
+}
+
+SDL_Scancode config_get_scancode(const char *section, const char *key, SDL_Scancode default_value) {
+	const char *value = config_get_string(section, key, NULL);
+	if (!value)
+		return default_value;
+
+	SDL_Scancode scan_code = SDL_GetScancodeFromName(value);
 	if (scan_code == SDL_SCANCODE_UNKNOWN)
-		ERROR_RETURN(, "Invalid scan code when binding key: %s\n", key_name);
+		ERROR_RETURN(default_value, "Invalid scan code when binding key: %s\n", value);
+
+	return scan_code;
+}
+
+void config_key_bind(u32 action, const char *key_names) {
+	SDL_Scancode scan_codes[8];
+	usize count = 0;
+	char name[64];
+
+	for (const char *start = key_names; *start; ) {
+		const char *end = strchr(start, ',');
+		if (!end)
+			end = start + strlen(start);
+
+		usize len = end - start;
+		if (len >= sizeof(name))
+			len = sizeof(name) - 1;
+		memcpy(name, start, len);
+		char *trimmed = trim(name, name + len);
+
+		start = *end ? end + 1 : end;
+
+		if (*trimmed == 0)
+			continue;
+
+		SDL_Scancode scan_code = SDL_GetScancodeFromName(trimmed);
+		if (scan_code == SDL_SCANCODE_UNKNOWN) {
+			fprintf(stderr, "Invalid scan code when binding key: %s\n", trimmed);
+			continue;
+		}
+
+		if (count < sizeof(scan_codes) / sizeof(scan_codes[0]))
+			scan_codes[count++] = scan_code;
+	}
+
+	// Keep the current bindings rather than leave the action unbound.
+	if (count == 0)
+		return;
+
+	input_action_unbind_all(action);
+	for (usize i = 0; i < count; ++i) {
+		input_action_bind(action, scan_codes[i]);
+	}
+}
 
-	global.config.keybinds[key] = scan_code;
+void config_section_visit(const char *section, Config_Visit visit, void *user_data) {
+	for (usize i = 0; i < CONFIG_TABLE_SIZE; ++i) {
+		Config_Entry *entry = &store.table[i];
+		if (entry->hash != 0 && strcmp(entry->section, section) == 0)
+			visit(entry->key, entry->value, user_data);
+	}
 }
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "types.h"
+
+// Archetype ECS. Every distinct set of components is an archetype whose rows
+// live in 16 KB chunks, one tightly packed array per component (SoA), so a
+// query walks matching chunks linearly. Adding or removing a component moves
+// the entity's row to another archetype; destroying one moves the archetype's
+// last row into the hole, keeping chunks dense.
+//
+// Structural changes (create, destroy, add, remove) invalidate component
+// pointers and must not happen while a query is iterating, nor while other
+// threads use the ECS. Code running inside systems or callbacks records them
+// with the ecs_defer_ functions instead, and they are applied at a sync point
+// by ecs_commands_flush.
+
+#define ECS_CHUNK_SIZE (16 * 1024)
+#define ECS_MAX_COMPONENTS 64
+#define ECS_MAX_ARCHETYPES 256
+#define ECS_ENTITY_NONE 0
+
+#define ECS_MASK(component) (1ULL << (component))
+
+typedef u32 Ecs_Component;
+typedef void (*Ecs_Command_Function)(void *data);
+typedef u64 Ecs_Mask;
+// Index in the low 32 bits, generation in the high ones. Never 0.
+typedef u64 Ecs_Entity;
+
+typedef struct ecs_query {
+	Ecs_Mask all;
+	Ecs_Mask none;
+	// The current chunk, set by ecs_query_next.
+	u32 count;
+	const Ecs_Entity *entities;
+	u32 archetype;
+	u32 chunk;
+} Ecs_Query;
+
+void ecs_init(void);
+// Components of size 0 are tags, they only affect which archetype an entity is in.
+Ecs_Component ecs_component_register(usize size);
+
+// Components start zeroed.
+Ecs_Entity ecs_entity_create(Ecs_Mask mask);
+void ecs_entity_destroy(Ecs_Entity entity);
+bool ecs_entity_is_alive(Ecs_Entity entity);
+usize ecs_entity_count(void);
+// Destroys every entity.
+void ecs_clear(void);
+
+// NULL if the entity is dead or lacks the component.
+void *ecs_get(Ecs_Entity entity, Ecs_Component component);
+bool ecs_has(Ecs_Entity entity, Ecs_Component component);
+// Returns the component, zeroed if it is new.
+void *ecs_add(Ecs_Entity entity, Ecs_Component component);
+void ecs_remove(Ecs_Entity entity, Ecs_Component component);
+
+// Each job thread records into its own buffer, so these need no locks. The
+// returned handle is valid at once but the entity only comes alive in the
+// flush. Commands on entities that are dead by then are dropped, and an
+// entity destroyed in the same batch as its create never comes alive.
+Ecs_Entity ecs_defer_create(Ecs_Mask mask);
+void ecs_defer_destroy(Ecs_Entity entity);
+// Copies the value, or leaves the component zeroed or unchanged if NULL.
+void ecs_defer_add(Ecs_Entity entity, Ecs_Component component, const void *value);
+void ecs_defer_remove(Ecs_Entity entity, Ecs_Component component);
+// Calls function with a copy of data in order with the other commands, for
+// work that has to happen once an entity exists. It must not record commands.
+void ecs_defer_call(Ecs_Command_Function function, const void *data, u32 size);
+// Applies the commands of every thread in the order they were recorded, so
+// systems the schedule runs one after another replay deterministically. Call
+// with no systems running.
+void ecs_commands_flush(void);
+
+// Matches archetypes with every component in all and none in none.
+//
+//   Ecs_Query query = ecs_query(ECS_MASK(A) | ECS_MASK(B), 0);
+//   while (ecs_query_next(&query)) {
+//       A *a = ecs_query_column(&query, A);
+//       for (u32 i = 0; i < query.count; ++i) ...
+//   }
+Ecs_Query ecs_query(Ecs_Mask all, Ecs_Mask none);
+bool ecs_query_next(Ecs_Query *query);
+void *ecs_query_column(Ecs_Query *query, Ecs_Component component);
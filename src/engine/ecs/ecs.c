@@ -0,0 +1,646 @@
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "../util.h"
+#include "../job.h"
+#include "../ecs.h"
+
+// A chunk starts with the entity handles of its rows, followed by one column
+// per component in the archetype, each aligned to ECS_COLUMN_ALIGNMENT. All
+// chunks of an archetype but the last are full, so row r is row r % capacity
+// of chunk r / capacity.
+
+#define ECS_COLUMN_ALIGNMENT 16
+#define ECS_NO_ARCHETYPE 0xffffffff
+#define ECS_COMMAND_ALIGNMENT 8
+
+typedef struct ecs_archetype {
+	Ecs_Mask mask;
+	u32 offsets[ECS_MAX_COMPONENTS];
+	u32 row_capacity;
+	u32 count;
+	u8 **chunks;
+	u32 chunk_count;
+	u32 chunk_capacity;
+} Ecs_Archetype;
+
+typedef struct ecs_record {
+	u32 archetype;
+	u32 row;
+	u32 generation;
+	// Set by the flush for a reserved handle that is destroyed in the same
+	// batch, so its create is skipped.
+	u32 doomed_generation;
+} Ecs_Record;
+
+typedef enum ecs_command_type {
+	ECS_COMMAND_CREATE,
+	ECS_COMMAND_DESTROY,
+	ECS_COMMAND_ADD,
+	ECS_COMMAND_REMOVE,
+	ECS_COMMAND_CALL,
+} Ecs_Command_Type;
+
+// Followed by size bytes of component value or call data, padded to
+// ECS_COMMAND_ALIGNMENT.
+typedef struct ecs_command {
+	Ecs_Command_Type type;
+	Ecs_Component component;
+	u32 size;
+	// Global recording order, so the flush doesn't depend on which thread
+	// happened to run which system.
+	u32 sequence;
+	Ecs_Entity entity;
+	Ecs_Mask mask;
+	Ecs_Command_Function function;
+} Ecs_Command;
+
+typedef struct ecs_command_buffer {
+	u8 *data;
+	usize len;
+	usize capacity;
+	// Read position during the flush.
+	usize offset;
+} Ecs_Command_Buffer;
+
+typedef struct ecs_state {
+	usize component_sizes[ECS_MAX_COMPONENTS];
+	u32 component_count;
+	Ecs_Archetype archetypes[ECS_MAX_ARCHETYPES];
+	u32 archetype_count;
+	Ecs_Record *records;
+	u32 record_count;
+	u32 record_capacity;
+	// Indices of unused records. Handles are reserved by atomically taking
+	// from the end, and past that from fresh indices above record_count, so
+	// any thread can get one while systems run.
+	u32 *free_indices;
+	u32 free_capacity;
+	SDL_atomic_t free_count;
+	SDL_atomic_t fresh_count;
+	usize alive_count;
+	Ecs_Command_Buffer command_buffers[JOB_MAX_THREADS];
+	SDL_atomic_t command_sequence;
+	// Emptied chunks are kept for reuse instead of going back to the heap.
+	u8 **free_chunks;
+	u32 free_chunk_count;
+	u32 free_chunk_capacity;
+} Ecs_State;
+
+static Ecs_State state;
+
+static u32 align_column(u32 offset) {
+	return (offset + ECS_COLUMN_ALIGNMENT - 1) & ~(u32)(ECS_COLUMN_ALIGNMENT - 1);
+}
+
+static Ecs_Record *record_get(Ecs_Entity entity) {
+	u32 index = (u32)entity;
+	u32 generation = entity >> 32;
+
+	if (index >= state.record_count)
+		return NULL;
+
+	Ecs_Record *record = &state.records[index];
+	if (record->generation != generation || record->archetype == ECS_NO_ARCHETYPE)
+		return NULL;
+
+	return record;
+}
+
+// Lays out columns for the largest row capacity that fits in a chunk.
+static bool archetype_layout(Ecs_Archetype *archetype, u32 row_capacity) {
+	u32 offset = align_column(sizeof(Ecs_Entity) * row_capacity);
+
+	for (Ecs_Component c = 0; c < state.component_count; ++c) {
+		if (!(archetype->mask & ECS_MASK(c)))
+			continue;
+
+		archetype->offsets[c] = offset;
+		offset = align_column(offset + state.component_sizes[c] * row_capacity);
+	}
+
+	return offset <= ECS_CHUNK_SIZE;
+}
+
+static u32 archetype_get(Ecs_Mask mask) {
+	// Games have tens of archetypes, a linear scan beats hashing here.
+	for (u32 i = 0; i < state.archetype_count; ++i) {
+		if (state.archetypes[i].mask == mask)
+			return i;
+	}
+
+	if (state.archetype_count == ECS_MAX_ARCHETYPES)
+		ERROR_EXIT("Too many archetypes, max is %d\n", ECS_MAX_ARCHETYPES);
+
+	Ecs_Archetype *archetype = &state.archetypes[state.archetype_count];
+	*archetype = (Ecs_Archetype){ .mask = mask };
+
+	usize row_size = sizeof(Ecs_Entity);
+	for (Ecs_Component c = 0; c < state.component_count; ++c) {
+		if (mask & ECS_MASK(c))
+			row_size += state.component_sizes[c];
+	}
+
+	u32 row_capacity = ECS_CHUNK_SIZE / row_size;
+	while (row_capacity > 0 && !archetype_layout(archetype, row_capacity)) {
+		--row_capacity;
+	}
+
+	if (row_capacity == 0)
+		ERROR_EXIT("Archetype row of %zu bytes does not fit in a chunk\n", row_size);
+
+	archetype->row_capacity = row_capacity;
+
+	return state.archetype_count++;
+}
+
+static u8 *chunk_alloc(void) {
+	if (state.free_chunk_count > 0)
+		return state.free_chunks[--state.free_chunk_count];
+
+	u8 *chunk = aligned_alloc(64, ECS_CHUNK_SIZE);
+	if (!chunk)
+		ERROR_EXIT("Could not allocate ECS chunk\n");
+
+	return chunk;
+}
+
+static void chunk_release(u8 *chunk) {
+	if (state.free_chunk_count == state.free_chunk_capacity) {
+		u32 capacity = state.free_chunk_capacity > 0 ? state.free_chunk_capacity * 2 : 16;
+		u8 **free_chunks = realloc(state.free_chunks, sizeof(u8*) * capacity);
+		if (!free_chunks) {
+			free(chunk);
+			return;
+		}
+
+		state.free_chunks = free_chunks;
+		state.free_chunk_capacity = capacity;
+	}
+
+	state.free_chunks[state.free_chunk_count++] = chunk;
+}
+
+static Ecs_Entity *row_entity(Ecs_Archetype *archetype, u32 row) {
+	u8 *chunk = archetype->chunks[row / archetype->row_capacity];
+	return (Ecs_Entity*)chunk + row % archetype->row_capacity;
+}
+
+static void *row_component(Ecs_Archetype *archetype, u32 row, Ecs_Component component) {
+	u8 *chunk = archetype->chunks[row / archetype->row_capacity];
+	return chunk + archetype->offsets[component] + (row % archetype->row_capacity) * state.component_sizes[component];
+}
+
+// Appends a zeroed row.
+static u32 row_push(Ecs_Archetype *archetype, Ecs_Entity entity) {
+	u32 row = archetype->count;
+
+	if (row == archetype->chunk_count * archetype->row_capacity) {
+		if (archetype->chunk_count == archetype->chunk_capacity) {
+			u32 capacity = archetype->chunk_capacity > 0 ? archetype->chunk_capacity * 2 : 4;
+			u8 **chunks = realloc(archetype->chunks, sizeof(u8*) * capacity);
+			if (!chunks)
+				ERROR_EXIT("Could not grow ECS chunk list\n");
+
+			archetype->chunks = chunks;
+			archetype->chunk_capacity = capacity;
+		}
+
+		archetype->chunks[archetype->chunk_count++] = chunk_alloc();
+	}
+
+	++archetype->count;
+	*row_entity(archetype, row) = entity;
+
+	for (Ecs_Component c = 0; c < state.component_count; ++c) {
+		if (archetype->mask & ECS_MASK(c))
+			memset(row_component(archetype, row, c), 0, state.component_sizes[c]);
+	}
+
+	return row;
+}
+
+// Fills the hole with the last row and frees the last chunk if it empties.
+static void row_remove(Ecs_Archetype *archetype, u32 row) {
+	u32 last = archetype->count - 1;
+
+	if (row != last) {
+		Ecs_Entity moved = *row_entity(archetype, last);
+		*row_entity(archetype, row) = moved;
+
+		for (Ecs_Component c = 0; c < state.component_count; ++c) {
+			if (archetype->mask & ECS_MASK(c))
+				memcpy(row_component(archetype, row, c), row_component(archetype, last, c), state.component_sizes[c]);
+		}
+
+		state.records[(u32)moved].row = row;
+	}
+
+	--archetype->count;
+
+	if (archetype->count == (archetype->chunk_count - 1) * archetype->row_capacity) {
+		chunk_release(archetype->chunks[--archetype->chunk_count]);
+	}
+}
+
+static void entity_move(Ecs_Entity entity, Ecs_Record *record, Ecs_Mask mask) {
+	u32 target_index = archetype_get(mask);
+	Ecs_Archetype *source = &state.archetypes[record->archetype];
+	Ecs_Archetype *target = &state.archetypes[target_index];
+
+	u32 row = row_push(target, entity);
+	Ecs_Mask shared = source->mask & target->mask;
+
+	for (Ecs_Component c = 0; c < state.component_count; ++c) {
+		if (shared & ECS_MASK(c))
+			memcpy(row_component(target, row, c), row_component(source, record->row, c), state.component_sizes[c]);
+	}
+
+	row_remove(source, record->row);
+	record->archetype = target_index;
+	record->row = row;
+}
+
+void ecs_init(void) {
+	ecs_clear();
+}
+
+Ecs_Component ecs_component_register(usize size) {
+	if (state.component_count == ECS_MAX_COMPONENTS)
+		ERROR_EXIT("Too many ECS components, max is %d\n", ECS_MAX_COMPONENTS);
+
+	// Archetypes laid out earlier don't know the new component, which is fine
+	// since none of them can contain it.
+	state.component_sizes[state.component_count] = size;
+
+	return state.component_count++;
+}
+
+static u32 generation_next(u32 generation) {
+	// Generation 0 is skipped so no handle is ever ECS_ENTITY_NONE.
+	return generation + 1 ? generation + 1 : 1;
+}
+
+static Ecs_Entity entity_reserve(void) {
+	i32 slot = SDL_AtomicAdd(&state.free_count, -1) - 1;
+
+	if (slot >= 0) {
+		u32 index = state.free_indices[slot];
+		return (Ecs_Entity)generation_next(state.records[index].generation) << 32 | index;
+	}
+
+	u32 index = state.record_count + (u32)SDL_AtomicAdd(&state.fresh_count, 1);
+	return (Ecs_Entity)1 << 32 | index;
+}
+
+// Only between parallel sections: takes in every fresh index reserved so far
+// and drops the overshoot reservations left in free_count.
+static void records_settle(void) {
+	if (SDL_AtomicGet(&state.free_count) < 0)
+		SDL_AtomicSet(&state.free_count, 0);
+
+	u32 fresh = (u32)SDL_AtomicGet(&state.fresh_count);
+	if (fresh == 0)
+		return;
+
+	u32 count = state.record_count + fresh;
+	if (count > state.record_capacity) {
+		u32 capacity = state.record_capacity > 0 ? state.record_capacity : 256;
+		while (capacity < count) {
+			capacity *= 2;
+		}
+
+		Ecs_Record *records = realloc(state.records, sizeof(Ecs_Record) * capacity);
+		if (!records)
+			ERROR_EXIT("Could not grow ECS entity records\n");
+
+		state.records = records;
+		state.record_capacity = capacity;
+	}
+
+	for (u32 i = state.record_count; i < count; ++i) {
+		state.records[i] = (Ecs_Record){ .archetype = ECS_NO_ARCHETYPE };
+	}
+
+	state.record_count = count;
+	SDL_AtomicSet(&state.fresh_count, 0);
+}
+
+static void free_index_push(u32 index) {
+	u32 count = (u32)SDL_AtomicGet(&state.free_count);
+
+	if (count == state.free_capacity) {
+		u32 capacity = state.free_capacity > 0 ? state.free_capacity * 2 : 256;
+		u32 *free_indices = realloc(state.free_indices, sizeof(u32) * capacity);
+		if (!free_indices)
+			ERROR_EXIT("Could not grow ECS free list\n");
+
+		state.free_indices = free_indices;
+		state.free_capacity = capacity;
+	}
+
+	state.free_indices[count] = index;
+	SDL_AtomicSet(&state.free_count, count + 1);
+}
+
+static void entity_materialize(Ecs_Entity entity, Ecs_Mask mask) {
+	records_settle();
+
+	Ecs_Record *record = &state.records[(u32)entity];
+	record->generation = entity >> 32;
+	record->archetype = archetype_get(mask);
+	record->row = row_push(&state.archetypes[record->archetype], entity);
+	++state.alive_count;
+}
+
+Ecs_Entity ecs_entity_create(Ecs_Mask mask) {
+	records_settle();
+
+	Ecs_Entity entity = entity_reserve();
+	entity_materialize(entity, mask);
+
+	return entity;
+}
+
+void ecs_entity_destroy(Ecs_Entity entity) {
+	Ecs_Record *record = record_get(entity);
+	if (!record)
+		return;
+
+	row_remove(&state.archetypes[record->archetype], record->row);
+
+	record->archetype = ECS_NO_ARCHETYPE;
+	records_settle();
+	free_index_push((u32)entity);
+	--state.alive_count;
+}
+
+bool ecs_entity_is_alive(Ecs_Entity entity) {
+	return record_get(entity) != NULL;
+}
+
+usize ecs_entity_count(void) {
+	return state.alive_count;
+}
+
+void ecs_clear(void) {
+	for (u32 i = 0; i < state.archetype_count; ++i) {
+		Ecs_Archetype *archetype = &state.archetypes[i];
+		while (archetype->chunk_count > 0) {
+			chunk_release(archetype->chunks[--archetype->chunk_count]);
+		}
+		archetype->count = 0;
+	}
+
+	for (u32 i = 0; i < JOB_MAX_THREADS; ++i) {
+		state.command_buffers[i].len = 0;
+	}
+	SDL_AtomicSet(&state.command_sequence, 0);
+
+	// Generations survive so handles from before the clear stay dead.
+	records_settle();
+	SDL_AtomicSet(&state.free_count, 0);
+	for (u32 i = state.record_count; i-- > 0; ) {
+		state.records[i].archetype = ECS_NO_ARCHETYPE;
+		state.records[i].doomed_generation = 0;
+		free_index_push(i);
+	}
+
+	state.alive_count = 0;
+}
+
+void *ecs_get(Ecs_Entity entity, Ecs_Component component) {
+	Ecs_Record *record = record_get(entity);
+	if (!record)
+		return NULL;
+
+	Ecs_Archetype *archetype = &state.archetypes[record->archetype];
+	if (!(archetype->mask & ECS_MASK(component)))
+		return NULL;
+
+	return row_component(archetype, record->row, component);
+}
+
+bool ecs_has(Ecs_Entity entity, Ecs_Component component) {
+	Ecs_Record *record = record_get(entity);
+	return record && (state.archetypes[record->archetype].mask & ECS_MASK(component));
+}
+
+void *ecs_add(Ecs_Entity entity, Ecs_Component component) {
+	Ecs_Record *record = record_get(entity);
+	if (!record)
+		return NULL;
+
+	Ecs_Mask mask = state.archetypes[record->archetype].mask;
+	if (!(mask & ECS_MASK(component)))
+		entity_move(entity, record, mask | ECS_MASK(component));
+
+	return row_component(&state.archetypes[record->archetype], record->row, component);
+}
+
+void ecs_remove(Ecs_Entity entity, Ecs_Component component) {
+	Ecs_Record *record = record_get(entity);
+	if (!record)
+		return;
+
+	Ecs_Mask mask = state.archetypes[record->archetype].mask;
+	if (mask & ECS_MASK(component))
+		entity_move(entity, record, mask & ~ECS_MASK(component));
+}
+
+Ecs_Query ecs_query(Ecs_Mask all, Ecs_Mask none) {
+	return (Ecs_Query){
+		.all = all,
+		.none = none,
+		.archetype = 0,
+		// Advanced to 0 by the first ecs_query_next.
+		.chunk = (u32)-1,
+	};
+}
+
+bool ecs_query_next(Ecs_Query *query) {
+	++query->chunk;
+
+	for (; query->archetype < state.archetype_count; ++query->archetype, query->chunk = 0) {
+		Ecs_Archetype *archetype = &state.archetypes[query->archetype];
+
+		if ((archetype->mask & query->all) != query->all || (archetype->mask & query->none))
+			continue;
+
+		if (query->chunk < archetype->chunk_count) {
+			u32 first = query->chunk * archetype->row_capacity;
+			u32 count = archetype->count - first;
+
+			query->count = count < archetype->row_capacity ? count : archetype->row_capacity;
+			query->entities = (Ecs_Entity*)archetype->chunks[query->chunk];
+
+			return true;
+		}
+	}
+
+	query->count = 0;
+	query->entities = NULL;
+
+	return false;
+}
+
+void *ecs_query_column(Ecs_Query *query, Ecs_Component component) {
+	Ecs_Archetype *archetype = &state.archetypes[query->archetype];
+	if (!(archetype->mask & ECS_MASK(component)))
+		return NULL;
+
+	return archetype->chunks[query->chunk] + archetype->offsets[component];
+}
+
+static usize command_size(u32 value_size) {
+	return sizeof(Ecs_Command) + ((value_size + ECS_COMMAND_ALIGNMENT - 1) & ~(usize)(ECS_COMMAND_ALIGNMENT - 1));
+}
+
+static void *command_push(Ecs_Command command) {
+	Ecs_Command_Buffer *buffer = &state.command_buffers[job_thread_index()];
+	usize size = command_size(command.size);
+	command.sequence = (u32)SDL_AtomicAdd(&state.command_sequence, 1);
+
+	if (buffer->len + size > buffer->capacity) {
+		usize capacity = buffer->capacity > 0 ? buffer->capacity : 4096;
+		while (capacity < buffer->len + size) {
+			capacity *= 2;
+		}
+
+		u8 *data = realloc(buffer->data, capacity);
+		if (!data)
+			ERROR_EXIT("Could not grow ECS command buffer\n");
+
+		buffer->data = data;
+		buffer->capacity = capacity;
+	}
+
+	u8 *at = buffer->data + buffer->len;
+	memcpy(at, &command, sizeof(Ecs_Command));
+	buffer->len += size;
+
+	return at + sizeof(Ecs_Command);
+}
+
+Ecs_Entity ecs_defer_create(Ecs_Mask mask) {
+	Ecs_Entity entity = entity_reserve();
+	command_push((Ecs_Command){ .type = ECS_COMMAND_CREATE, .entity = entity, .mask = mask });
+
+	return entity;
+}
+
+void ecs_defer_destroy(Ecs_Entity entity) {
+	command_push((Ecs_Command){ .type = ECS_COMMAND_DESTROY, .entity = entity });
+}
+
+void ecs_defer_add(Ecs_Entity entity, Ecs_Component component, const void *value) {
+	u32 size = value ? (u32)state.component_sizes[component] : 0;
+	void *data = command_push((Ecs_Command){ .type = ECS_COMMAND_ADD, .entity = entity, .component = component, .size = size });
+
+	if (size > 0)
+		memcpy(data, value, size);
+}
+
+void ecs_defer_remove(Ecs_Entity entity, Ecs_Component component) {
+	command_push((Ecs_Command){ .type = ECS_COMMAND_REMOVE, .entity = entity, .component = component });
+}
+
+void ecs_defer_call(Ecs_Command_Function function, const void *data, u32 size) {
+	void *copy = command_push((Ecs_Command){ .type = ECS_COMMAND_CALL, .function = function, .size = size });
+
+	if (size > 0)
+		memcpy(copy, data, size);
+}
+
+// The handle is released again without the entity ever coming alive.
+static void entity_abandon(Ecs_Entity entity) {
+	Ecs_Record *record = &state.records[(u32)entity];
+	record->generation = entity >> 32;
+	record->doomed_generation = 0;
+	free_index_push((u32)entity);
+}
+
+static void command_apply(const Ecs_Command *command, u8 *value) {
+	switch (command->type) {
+	case ECS_COMMAND_CREATE:
+		if (state.records[(u32)command->entity].doomed_generation == command->entity >> 32)
+			entity_abandon(command->entity);
+		else
+			entity_materialize(command->entity, command->mask);
+		break;
+	case ECS_COMMAND_DESTROY:
+		ecs_entity_destroy(command->entity);
+		break;
+	case ECS_COMMAND_ADD: {
+		void *component = ecs_add(command->entity, command->component);
+		if (component && command->size > 0)
+			memcpy(component, value, command->size);
+		break;
+	}
+	case ECS_COMMAND_REMOVE:
+		ecs_remove(command->entity, command->component);
+		break;
+	case ECS_COMMAND_CALL:
+		command->function(value);
+		break;
+	}
+}
+
+// Merges the buffers by sequence. Each buffer is already in order, and only
+// the few threads that recorded anything take part.
+void ecs_commands_flush(void) {
+	records_settle();
+
+	Ecs_Command_Buffer *buffers[JOB_MAX_THREADS];
+	u32 buffer_count = 0;
+
+	for (u32 i = 0; i < JOB_MAX_THREADS; ++i) {
+		if (state.command_buffers[i].len > 0) {
+			state.command_buffers[i].offset = 0;
+			buffers[buffer_count++] = &state.command_buffers[i];
+		}
+	}
+
+	// Destroys of entities that aren't alive yet mark them before anything is
+	// applied, so nothing recorded after their create sees them alive.
+	for (u32 i = 0; i < buffer_count; ++i) {
+		for (usize offset = 0; offset < buffers[i]->len; ) {
+			Ecs_Command *command = (Ecs_Command*)(buffers[i]->data + offset);
+			offset += command_size(command->size);
+
+			u32 index = (u32)command->entity;
+			if (command->type != ECS_COMMAND_DESTROY || index >= state.record_count)
+				continue;
+
+			Ecs_Record *record = &state.records[index];
+			if (record->archetype == ECS_NO_ARCHETYPE)
+				record->doomed_generation = command->entity >> 32;
+		}
+	}
+
+	while (buffer_count > 0) {
+		u32 next = 0;
+		u32 next_sequence = (u32)-1;
+
+		for (u32 i = 0; i < buffer_count; ++i) {
+			Ecs_Command *command = (Ecs_Command*)(buffers[i]->data + buffers[i]->offset);
+			if (command->sequence < next_sequence) {
+				next_sequence = command->sequence;
+				next = i;
+			}
+		}
+
+		Ecs_Command_Buffer *buffer = buffers[next];
+		Ecs_Command *command = (Ecs_Command*)(buffer->data + buffer->offset);
+		command_apply(command, (u8*)(command + 1));
+		buffer->offset += command_size(command->size);
+
+		if (buffer->offset >= buffer->len) {
+			buffer->len = 0;
+			buffers[next] = buffers[--buffer_count];
+		}
+	}
+
+	SDL_AtomicSet(&state.command_sequence, 0);
+}
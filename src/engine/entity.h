@@ -5,25 +5,70 @@
 #include "physics.h"
 #include "types.h"
 #include "render.h"
+#include "animation.h"
+#include "ecs.h"
 
-typedef struct entity {
-	usize body_id;
+// Entities are ECS entities. The per-entity data systems read every frame
+// (AABB, velocity, animation frame and flip) lives in components, so queries
+// walk it in place. Physics keeps its bodies for collision, and
+// entity_physics_update copies position and velocity between the two around
+// each step.
+
+typedef struct entity_sprite {
 	usize animation_id;
-    vec2 sprite_offset;
-	bool is_active;
-    bool is_enraged;
-    u8 health;
-} Entity;
+	vec2 sprite_offset;
+} Entity_Sprite;
+
+typedef struct entity_components {
+	// usize body id.
+	Ecs_Component body;
+	// vec2 each: AABB center, AABB half size and velocity.
+	Ecs_Component position;
+	Ecs_Component half_size;
+	Ecs_Component velocity;
+	// Entity_Sprite, only on entities created with an animation.
+	Ecs_Component sprite;
+	// Animation_State, with sprite.
+	Ecs_Component animation;
+	// u8 hit points left, entities without one die on any damage.
+	Ecs_Component health;
+	// Tag.
+	Ecs_Component enraged;
+} Entity_Components;
+
+extern Entity_Components entity_components;
 
 void entity_init(void);
-usize entity_create(vec2 position, vec2 size, vec2 sprite_offset, vec2 velocity, u8 collision_layer, u8 collision_mask, bool is_kinematic, usize animation_id, On_Hit on_hit, On_Hit_Static on_hit_static);
-Entity *entity_get(usize id);
+// Deferred: the entity and its body appear at the next entity_flush, which
+// is the frame's sync point. Safe from any job thread.
+Ecs_Entity entity_create(vec2 position, vec2 size, vec2 sprite_offset, vec2 velocity, u8 collision_layer, u8 collision_mask, bool is_kinematic, usize animation_id, On_Hit on_hit, On_Hit_Static on_hit_static);
+// Applies the creates, destroys and component changes recorded since the
+// last flush. No system may be running.
+void entity_flush(void);
 usize entity_count(void);
 void entity_reset(void);
-Entity *entity_by_body_id(usize body_id);
-usize entity_id_by_body_id(usize body_id);
+// False once destroyed, even before the flush removes the entity.
+bool entity_is_alive(Ecs_Entity entity_id);
 
-// Returns true if the enemy dies.
-bool entity_damage(usize entity_id, u8 amount);
-void entity_destroy(usize entity_id);
+// Steps physics. Component changes made since the last step go to the bodies
+// first, and the results come back after.
+void entity_physics_update(void);
+// Advances each entity's animation and turns it to face where it moves.
+void entity_animation_update(f32 dt);
+
+// NULL if the entity is dead or has no such component.
+Body *entity_body(Ecs_Entity entity_id);
+Entity_Sprite *entity_sprite(Ecs_Entity entity_id);
+Animation_State *entity_animation(Ecs_Entity entity_id);
+f32 *entity_position(Ecs_Entity entity_id);
+f32 *entity_velocity(Ecs_Entity entity_id);
+// Restarts the animation if it changes.
+void entity_set_animation(Ecs_Entity entity_id, usize animation_id);
+bool entity_is_enraged(Ecs_Entity entity_id);
+// Deferred like entity_create.
+void entity_set_enraged(Ecs_Entity entity_id, bool is_enraged);
 
+// Returns true if the enemy dies.
+bool entity_damage(Ecs_Entity entity_id, u8 amount);
+// Deactivates the body at once and removes the entity at the next flush.
+void entity_destroy(Ecs_Entity entity_id);
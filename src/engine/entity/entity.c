@@ -1,68 +1,227 @@
-#include "../array_list.h"
 #include "../util.h"
 #include "../entity.h"
 
-static Array_List *entity_list;
+// Bodies are created at the flush, right after the ECS makes the entity
+// alive, so the physics body list never grows while physics iterates it.
+typedef struct entity_spawn {
+	Ecs_Entity entity_id;
+	vec2 position;
+	vec2 size;
+	vec2 velocity;
+	vec2 sprite_offset;
+	usize animation_id;
+	On_Hit on_hit;
+	On_Hit_Static on_hit_static;
+	u8 collision_layer;
+	u8 collision_mask;
+	bool is_kinematic;
+} Entity_Spawn;
+
+Entity_Components entity_components;
 
 void entity_init(void) {
-	entity_list = array_list_create(sizeof(Entity), 0);
+	ecs_init();
+
+	entity_components = (Entity_Components){
+		.body = ecs_component_register(sizeof(usize)),
+		.position = ecs_component_register(sizeof(vec2)),
+		.half_size = ecs_component_register(sizeof(vec2)),
+		.velocity = ecs_component_register(sizeof(vec2)),
+		.sprite = ecs_component_register(sizeof(Entity_Sprite)),
+		.animation = ecs_component_register(sizeof(Animation_State)),
+		.health = ecs_component_register(sizeof(u8)),
+		.enraged = ecs_component_register(0),
+	};
 }
 
-usize entity_create(vec2 position, vec2 size, vec2 sprite_offset, vec2 velocity, u8 collision_layer, u8 collision_mask, bool is_kinematic, usize animation_id, On_Hit on_hit, On_Hit_Static on_hit_static) {
-	usize id = entity_list->len;
+static void spawn_apply(void *data) {
+	Entity_Spawn *spawn = data;
 
-	// Find inactive Entity.
-	for (usize i = 0; i < entity_list->len; ++i) {
-		Entity *entity = array_list_get(entity_list, i);
-		if (!entity->is_active) {
-			id = i;
-			break;
-		}
+	// Destroyed in the same batch, so the ECS never made it alive.
+	usize *body_id = ecs_get(spawn->entity_id, entity_components.body);
+	if (!body_id) {
+		return;
 	}
 
-	if (id == entity_list->len) {
-		if (array_list_append(entity_list, &(Entity){0}) == (usize)-1) {
-			ERROR_EXIT("Could not append entity to list\n");
-		}
+	*body_id = physics_body_create(spawn->position, spawn->size, spawn->velocity, spawn->collision_layer, spawn->collision_mask, spawn->is_kinematic, spawn->on_hit, spawn->on_hit_static, spawn->entity_id);
+
+	Body *body = physics_body_get(*body_id);
+	vec2_dup(ecs_get(spawn->entity_id, entity_components.position), body->aabb.position);
+	vec2_dup(ecs_get(spawn->entity_id, entity_components.half_size), body->aabb.half_size);
+	vec2_dup(ecs_get(spawn->entity_id, entity_components.velocity), body->velocity);
+
+	Entity_Sprite *sprite = ecs_get(spawn->entity_id, entity_components.sprite);
+	if (sprite) {
+		*sprite = (Entity_Sprite){
+			.animation_id = spawn->animation_id,
+			.sprite_offset = { spawn->sprite_offset[0], spawn->sprite_offset[1] },
+		};
+	}
+}
+
+Ecs_Entity entity_create(vec2 position, vec2 size, vec2 sprite_offset, vec2 velocity, u8 collision_layer, u8 collision_mask, bool is_kinematic, usize animation_id, On_Hit on_hit, On_Hit_Static on_hit_static) {
+	Ecs_Mask mask = ECS_MASK(entity_components.body) | ECS_MASK(entity_components.position) | ECS_MASK(entity_components.half_size) | ECS_MASK(entity_components.velocity);
+	if (animation_id != (usize)-1) {
+		mask |= ECS_MASK(entity_components.sprite) | ECS_MASK(entity_components.animation);
 	}
 
-	Entity *entity = entity_get(id);
+	Ecs_Entity id = ecs_defer_create(mask);
 
-	*entity = (Entity){
-		.is_active = true,
+	Entity_Spawn spawn = {
+		.entity_id = id,
+		.position = { position[0], position[1] },
+		.size = { size[0], size[1] },
+		.velocity = { velocity[0], velocity[1] },
+		.sprite_offset = { sprite_offset[0], sprite_offset[1] },
 		.animation_id = animation_id,
-		.body_id = physics_body_create(position, size, velocity, collision_layer, collision_mask, is_kinematic, on_hit, on_hit_static, id),
-        .sprite_offset = { sprite_offset[0], sprite_offset[1] },
+		.on_hit = on_hit,
+		.on_hit_static = on_hit_static,
+		.collision_layer = collision_layer,
+		.collision_mask = collision_mask,
+		.is_kinematic = is_kinematic,
 	};
+	ecs_defer_call(spawn_apply, &spawn, sizeof(spawn));
 
 	return id;
 }
 
-Entity *entity_get(usize id) {
-	return array_list_get(entity_list, id);
+void entity_flush(void) {
+	ecs_commands_flush();
 }
 
-usize entity_count() {
-	return entity_list->len;
+usize entity_count(void) {
+	return ecs_entity_count();
 }
 
 void entity_reset(void) {
-    entity_list->len = 0;
+	ecs_clear();
+}
+
+bool entity_is_alive(Ecs_Entity entity_id) {
+	Body *body = entity_body(entity_id);
+	return body && body->is_active;
+}
+
+void entity_physics_update(void) {
+	Ecs_Mask mask = ECS_MASK(entity_components.body) | ECS_MASK(entity_components.position) | ECS_MASK(entity_components.velocity);
+
+	Ecs_Query query = ecs_query(mask, 0);
+	while (ecs_query_next(&query)) {
+		usize *body_ids = ecs_query_column(&query, entity_components.body);
+		vec2 *positions = ecs_query_column(&query, entity_components.position);
+		vec2 *velocities = ecs_query_column(&query, entity_components.velocity);
+
+		for (u32 i = 0; i < query.count; ++i) {
+			Body *body = physics_body_get(body_ids[i]);
+			vec2_dup(body->aabb.position, positions[i]);
+			vec2_dup(body->velocity, velocities[i]);
+		}
+	}
+
+	physics_update();
+
+	query = ecs_query(mask, 0);
+	while (ecs_query_next(&query)) {
+		usize *body_ids = ecs_query_column(&query, entity_components.body);
+		vec2 *positions = ecs_query_column(&query, entity_components.position);
+		vec2 *velocities = ecs_query_column(&query, entity_components.velocity);
+
+		for (u32 i = 0; i < query.count; ++i) {
+			Body *body = physics_body_get(body_ids[i]);
+			vec2_dup(positions[i], body->aabb.position);
+			vec2_dup(velocities[i], body->velocity);
+		}
+	}
+}
+
+void entity_animation_update(f32 dt) {
+	Ecs_Mask mask = ECS_MASK(entity_components.sprite) | ECS_MASK(entity_components.animation) | ECS_MASK(entity_components.velocity);
+
+	Ecs_Query query = ecs_query(mask, 0);
+	while (ecs_query_next(&query)) {
+		Entity_Sprite *sprites = ecs_query_column(&query, entity_components.sprite);
+		Animation_State *states = ecs_query_column(&query, entity_components.animation);
+		vec2 *velocities = ecs_query_column(&query, entity_components.velocity);
+
+		for (u32 i = 0; i < query.count; ++i) {
+			if (velocities[i][0] < 0) {
+				states[i].is_flipped = true;
+			} else if (velocities[i][0] > 0) {
+				states[i].is_flipped = false;
+			}
+
+			animation_step(sprites[i].animation_id, &states[i], dt);
+		}
+	}
+}
+
+Body *entity_body(Ecs_Entity entity_id) {
+	usize *body_id = ecs_get(entity_id, entity_components.body);
+	return body_id ? physics_body_get(*body_id) : NULL;
+}
+
+Entity_Sprite *entity_sprite(Ecs_Entity entity_id) {
+	return ecs_get(entity_id, entity_components.sprite);
 }
 
-bool entity_damage(usize entity_id, u8 amount) {
-    Entity *entity = entity_get(entity_id);
-    if (amount >= entity->health) {
-        entity_destroy(entity_id);
-        return true;
-    }
+Animation_State *entity_animation(Ecs_Entity entity_id) {
+	return ecs_get(entity_id, entity_components.animation);
+}
+
+f32 *entity_position(Ecs_Entity entity_id) {
+	return ecs_get(entity_id, entity_components.position);
+}
+
+f32 *entity_velocity(Ecs_Entity entity_id) {
+	return ecs_get(entity_id, entity_components.velocity);
+}
+
+void entity_set_animation(Ecs_Entity entity_id, usize animation_id) {
+	Entity_Sprite *sprite = entity_sprite(entity_id);
+	Animation_State *state = entity_animation(entity_id);
+	if (!sprite || !state || sprite->animation_id == animation_id) {
+		return;
+	}
 
-    entity->health -= amount;
-    return false;
+	sprite->animation_id = animation_id;
+	*state = (Animation_State){ .is_flipped = state->is_flipped };
 }
 
-void entity_destroy(usize entity_id) {
-    Entity *entity = entity_get(entity_id);
-    physics_body_destroy(entity->body_id);
-    entity->is_active = false;
+bool entity_is_enraged(Ecs_Entity entity_id) {
+	return ecs_has(entity_id, entity_components.enraged);
+}
+
+void entity_set_enraged(Ecs_Entity entity_id, bool is_enraged) {
+	if (is_enraged) {
+		ecs_defer_add(entity_id, entity_components.enraged, NULL);
+	} else {
+		ecs_defer_remove(entity_id, entity_components.enraged);
+	}
+}
+
+bool entity_damage(Ecs_Entity entity_id, u8 amount) {
+	if (!entity_is_alive(entity_id)) {
+		return false;
+	}
+
+	u8 *health = ecs_get(entity_id, entity_components.health);
+	if (!health || amount >= *health) {
+		entity_destroy(entity_id);
+		return true;
+	}
+
+	*health -= amount;
+	return false;
+}
+
+// The body stops colliding now; its slot is only reused by bodies created at
+// the flush, when the entity is gone too. An entity created this frame has no
+// body yet and the flush skips creating it.
+void entity_destroy(Ecs_Entity entity_id) {
+	usize *body_id = ecs_get(entity_id, entity_components.body);
+	if (body_id) {
+		physics_body_destroy(*body_id);
+	}
+
+	ecs_defer_destroy(entity_id);
 }
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "types.h"
+
+// Always-on frame time recorder. Keeps the last FRAME_STATS_WINDOW frames of
+// the whole frame and of every profiler zone in log-linear histograms (16
+// sub-buckets per power of two, so percentiles are within ~3%), and reports
+// frames slower than the hitch threshold.
+
+#define FRAME_STATS_WINDOW 1024
+#define FRAME_STATS_MAX_HITCHES 32
+
+typedef struct frame_stats_summary {
+	u32 samples;
+	f32 p50_ms;
+	f32 p95_ms;
+	f32 p99_ms;
+	f32 max_ms;
+} Frame_Stats_Summary;
+
+typedef struct frame_hitch {
+	u64 frame;
+	f32 frame_ms;
+	// The slowest profiler zone of that frame, if any.
+	const char *zone;
+	f32 zone_ms;
+} Frame_Hitch;
+
+// Reads [stats] hitch_ms. Zero or less means twice the target frame time.
+void frame_stats_init(void);
+// Records the previous frame. Call once per frame after time_update and
+// profile_frame_end.
+void frame_stats_record(void);
+// zone is a profiler zone name, or NULL for the whole frame.
+bool frame_stats_summary(const char *zone, Frame_Stats_Summary *summary);
+// Most recent hitches, oldest first.
+const Frame_Hitch *frame_stats_hitches(usize *count);
+u64 frame_stats_hitch_count(void);
+bool frame_stats_write_csv(const char *path);
@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../util.h"
+#include "../io.h"
+#include "../config.h"
+#include "../global.h"
+#include "../profile.h"
+#include "../frame_stats.h"
+
+// Samples are in microseconds. Values below 16 get a bucket each, above that
+// each power of two is split into 16 buckets.
+#define SUB_BUCKET_BITS 4
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define BUCKET_COUNT (SUB_BUCKETS + (32 - SUB_BUCKET_BITS) * SUB_BUCKETS)
+
+// The whole frame, then one series per profiler zone in zone order.
+#define MAX_SERIES (MAX_PROFILE_ZONES + 1)
+
+typedef struct frame_series {
+	u32 counts[BUCKET_COUNT];
+	u32 samples[FRAME_STATS_WINDOW];
+	u64 head;
+} Frame_Series;
+
+typedef struct frame_stats_state {
+	Frame_Series series[MAX_SERIES];
+	Frame_Hitch hitches[FRAME_STATS_MAX_HITCHES];
+	u64 hitch_count;
+	u64 frame;
+	f32 hitch_ms;
+} Frame_Stats_State;
+
+static Frame_Stats_State state;
+
+static u32 bucket_index(u32 us) {
+	if (us < SUB_BUCKETS)
+		return us;
+
+	u32 exponent = 31 - __builtin_clz(us);
+	u32 shift = exponent - SUB_BUCKET_BITS;
+
+	return SUB_BUCKETS + shift * SUB_BUCKETS + ((us >> shift) & (SUB_BUCKETS - 1));
+}
+
+// Reporting the middle of the bucket halves the worst-case error.
+static u32 bucket_middle(u32 index) {
+	if (index < SUB_BUCKETS)
+		return index;
+
+	u32 shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+	u32 sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+
+	return ((SUB_BUCKETS + sub) << shift) + ((1u << shift) >> 1);
+}
+
+static void series_add(Frame_Series *series, u32 us) {
+	u32 slot = series->head % FRAME_STATS_WINDOW;
+
+	if (series->head >= FRAME_STATS_WINDOW)
+		--series->counts[bucket_index(series->samples[slot])];
+
+	series->samples[slot] = us;
+	++series->counts[bucket_index(us)];
+	++series->head;
+}
+
+static void series_summary(Frame_Series *series, Frame_Stats_Summary *summary) {
+	u32 samples = series->head < FRAME_STATS_WINDOW ? series->head : FRAME_STATS_WINDOW;
+	*summary = (Frame_Stats_Summary){ .samples = samples };
+
+	if (samples == 0)
+		return;
+
+	u32 max = 0;
+	for (u32 i = 0; i < samples; ++i) {
+		if (series->samples[i] > max)
+			max = series->samples[i];
+	}
+
+	u32 targets[3] = { (samples * 50 + 99) / 100, (samples * 95 + 99) / 100, (samples * 99 + 99) / 100 };
+	u32 results[3] = {0};
+	u32 seen = 0;
+	u32 next = 0;
+
+	for (u32 i = 0; i < BUCKET_COUNT && next < 3; ++i) {
+		seen += series->counts[i];
+		while (next < 3 && seen >= targets[next]) {
+			u32 middle = bucket_middle(i);
+			results[next++] = middle < max ? middle : max;
+		}
+	}
+
+	summary->p50_ms = results[0] / 1000.f;
+	summary->p95_ms = results[1] / 1000.f;
+	summary->p99_ms = results[2] / 1000.f;
+	summary->max_ms = max / 1000.f;
+}
+
+void frame_stats_init(void) {
+	state.hitch_ms = config_get_float("stats", "hitch_ms", 0);
+}
+
+void frame_stats_record(void) {
+	// The first delta covers start-up, not a frame.
+	if (state.frame++ == 0)
+		return;
+
+	u32 frame_us = global.time.delta_ns / 1000;
+	series_add(&state.series[0], frame_us);
+
+	usize zone_count;
+	const Profile_Zone_Stats *zones = profile_zones(&zone_count);
+	const Profile_Zone_Stats *slowest = NULL;
+
+	for (usize i = 0; i < zone_count; ++i) {
+		if (zones[i].calls == 0)
+			continue;
+
+		series_add(&state.series[i + 1], zones[i].last_ms * 1000.f);
+
+		if (!slowest || zones[i].last_ms > slowest->last_ms)
+			slowest = &zones[i];
+	}
+
+	f32 threshold_ms = state.hitch_ms > 0 ? state.hitch_ms : global.time.frame_delay_ns * 2 / 1e6f;
+	f32 frame_ms = frame_us / 1000.f;
+
+	if (frame_ms > threshold_ms) {
+		Frame_Hitch *hitch = &state.hitches[state.hitch_count % FRAME_STATS_MAX_HITCHES];
+		*hitch = (Frame_Hitch){
+			.frame = state.frame - 1,
+			.frame_ms = frame_ms,
+			.zone = slowest ? slowest->name : NULL,
+			.zone_ms = slowest ? slowest->last_ms : 0,
+		};
+		++state.hitch_count;
+
+		if (slowest)
+			fprintf(stderr, "Hitch: frame %llu took %.2f ms, slowest zone %s %.2f ms\n",
+					(unsigned long long)hitch->frame, frame_ms, slowest->name, slowest->last_ms);
+		else
+			fprintf(stderr, "Hitch: frame %llu took %.2f ms\n", (unsigned long long)hitch->frame, frame_ms);
+	}
+}
+
+bool frame_stats_summary(const char *zone, Frame_Stats_Summary *summary) {
+	if (!zone) {
+		series_summary(&state.series[0], summary);
+		return true;
+	}
+
+	usize zone_count;
+	const Profile_Zone_Stats *zones = profile_zones(&zone_count);
+
+	for (usize i = 0; i < zone_count; ++i) {
+		if (strcmp(zones[i].name, zone) == 0) {
+			series_summary(&state.series[i + 1], summary);
+			return true;
+		}
+	}
+
+	*summary = (Frame_Stats_Summary){0};
+
+	return false;
+}
+
+const Frame_Hitch *frame_stats_hitches(usize *count) {
+	static Frame_Hitch ordered[FRAME_STATS_MAX_HITCHES];
+
+	usize n = state.hitch_count < FRAME_STATS_MAX_HITCHES ? state.hitch_count : FRAME_STATS_MAX_HITCHES;
+	for (usize i = 0; i < n; ++i) {
+		ordered[i] = state.hitches[(state.hitch_count - n + i) % FRAME_STATS_MAX_HITCHES];
+	}
+
+	*count = n;
+
+	return ordered;
+}
+
+u64 frame_stats_hitch_count(void) {
+	return state.hitch_count;
+}
+
+bool frame_stats_write_csv(const char *path) {
+	usize zone_count;
+	const Profile_Zone_Stats *zones = profile_zones(&zone_count);
+
+	// Header, one row per series and one per remembered hitch.
+	usize capacity = (zone_count + FRAME_STATS_MAX_HITCHES + 4) * 128;
+	char *buffer = malloc(capacity);
+	if (!buffer)
+		ERROR_RETURN(false, "Not enough free memory to write frame stats\n");
+
+	usize len = snprintf(buffer, capacity, "series,samples,p50_ms,p95_ms,p99_ms,max_ms\n");
+
+	for (usize i = 0; i <= zone_count; ++i) {
+		Frame_Stats_Summary summary;
+		series_summary(&state.series[i], &summary);
+
+		len += snprintf(buffer + len, capacity - len, "%.64s,%u,%.3f,%.3f,%.3f,%.3f\n",
+				i == 0 ? "frame" : zones[i - 1].name,
+				summary.samples, summary.p50_ms, summary.p95_ms, summary.p99_ms, summary.max_ms);
+	}
+
+	usize hitch_count;
+	const Frame_Hitch *hitches = frame_stats_hitches(&hitch_count);
+
+	len += snprintf(buffer + len, capacity - len, "\nhitch_frame,frame_ms,zone,zone_ms\n");
+	for (usize i = 0; i < hitch_count; ++i) {
+		len += snprintf(buffer + len, capacity - len, "%llu,%.3f,%.64s,%.3f\n",
+				(unsigned long long)hitches[i].frame, hitches[i].frame_ms,
+				hitches[i].zone ? hitches[i].zone : "", hitches[i].zone_ms);
+	}
+
+	bool is_written = io_file_write(buffer, len, path) == 0;
+	free(buffer);
+
+	return is_written;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "types.h"
+
+// 64-bit FNV-1a. Never returns 0 so callers can use 0 as an empty marker.
+u64 hash_bytes(const void *data, usize len);
+u64 hash_string(const char *str);
@@ -0,0 +1,27 @@
+#include "../hash.h"
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+u64 hash_bytes(const void *data, usize len) {
+	const u8 *bytes = data;
+	u64 hash = FNV_OFFSET_BASIS;
+
+	for (usize i = 0; i < len; ++i) {
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash ? hash : 1;
+}
+
+u64 hash_string(const char *str) {
+	u64 hash = FNV_OFFSET_BASIS;
+
+	while (*str) {
+		hash ^= (u8)*str++;
+		hash *= FNV_PRIME;
+	}
+
+	return hash ? hash : 1;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <SDL2/SDL_mixer.h>
+
+#include "render.h"
+
+// Watches loose asset files (inotify on Linux, no-op elsewhere) and reloads
+// them while the game runs. Decoding happens off the main thread; the swap
+// into the existing handle happens in hot_reload_update, which should be
+// called once per frame. Files inside a mounted pack are not watched.
+
+// Runs on the watcher thread. Returns data handed to Hot_Reload_Apply.
+typedef void *(*Hot_Reload_Load)(const char *path, void *user_data);
+// Runs on the main thread at a frame boundary.
+typedef void (*Hot_Reload_Apply)(const char *path, void *user_data, void *loaded);
+
+void hot_reload_init(void);
+void hot_reload_update(void);
+void hot_reload_watch(const char *path, Hot_Reload_Load load, Hot_Reload_Apply apply, void *user_data);
+
+void hot_reload_watch_sprite_sheet(Sprite_Sheet *sprite_sheet, const char *path);
+void hot_reload_watch_sound(Mix_Chunk *chunk, const char *path);
+void hot_reload_watch_shaders(void);
+void hot_reload_watch_config(void);
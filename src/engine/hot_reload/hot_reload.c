@@ -0,0 +1,319 @@
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "../util.h"
+#include "../pack.h"
+#include "../audio.h"
+#include "../config.h"
+#include "../render.h"
+#include "../physics.h"
+#include "../replay.h"
+#include "../time.h"
+#include "../frame_stats.h"
+#include "../hot_reload.h"
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#define MAX_HOT_RELOAD_WATCHES 64
+#define MAX_HOT_RELOAD_DIRS 16
+// Editors often write a file in several steps, wait for them to settle.
+#define HOT_RELOAD_SETTLE_MS 100
+
+typedef struct hot_reload_entry {
+	char path[256];
+	Hot_Reload_Load load;
+	Hot_Reload_Apply apply;
+	void *user_data;
+	void *loaded;
+	u32 changed_at;
+	bool is_changed;
+	bool is_ready;
+} Hot_Reload_Entry;
+
+typedef struct watched_dir {
+	i32 wd;
+	char path[256];
+} Watched_Dir;
+
+typedef struct hot_reload_state {
+	Hot_Reload_Entry entries[MAX_HOT_RELOAD_WATCHES];
+	usize entry_count;
+	Watched_Dir dirs[MAX_HOT_RELOAD_DIRS];
+	usize dir_count;
+	i32 fd;
+	SDL_mutex *mutex;
+} Hot_Reload_State;
+
+static Hot_Reload_State state = { .fd = -1 };
+
+static void mark_changed(const char *path) {
+	u32 now = SDL_GetTicks();
+
+	SDL_LockMutex(state.mutex);
+	for (usize i = 0; i < state.entry_count; ++i) {
+		if (strcmp(state.entries[i].path, path) == 0) {
+			state.entries[i].changed_at = now;
+			state.entries[i].is_changed = true;
+		}
+	}
+	SDL_UnlockMutex(state.mutex);
+}
+
+static void read_events(void) {
+	char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+	ssize_t len = read(state.fd, buffer, sizeof(buffer));
+	if (len <= 0) {
+		return;
+	}
+
+	for (char *ptr = buffer; ptr < buffer + len; ) {
+		struct inotify_event *event = (struct inotify_event*)ptr;
+		ptr += sizeof(struct inotify_event) + event->len;
+
+		if (event->len == 0) {
+			continue;
+		}
+
+		// Watches are added from the main thread while this one runs.
+		char path[512];
+		bool is_found = false;
+
+		SDL_LockMutex(state.mutex);
+		for (usize i = 0; i < state.dir_count; ++i) {
+			if (state.dirs[i].wd != event->wd) {
+				continue;
+			}
+
+			if (strcmp(state.dirs[i].path, ".") == 0) {
+				snprintf(path, sizeof(path), "%s", event->name);
+			} else {
+				snprintf(path, sizeof(path), "%s/%s", state.dirs[i].path, event->name);
+			}
+			is_found = true;
+			break;
+		}
+		SDL_UnlockMutex(state.mutex);
+
+		if (is_found) {
+			mark_changed(path);
+		}
+	}
+}
+
+static void load_settled(void) {
+	u32 now = SDL_GetTicks();
+
+	for (usize i = 0; i < MAX_HOT_RELOAD_WATCHES; ++i) {
+		Hot_Reload_Entry *entry = &state.entries[i];
+
+		SDL_LockMutex(state.mutex);
+		// Wait for the main thread to take the previous result first.
+		bool is_settled = i < state.entry_count
+			&& entry->is_changed
+			&& !entry->is_ready
+			&& now - entry->changed_at >= HOT_RELOAD_SETTLE_MS;
+		if (is_settled) {
+			entry->is_changed = false;
+		}
+		SDL_UnlockMutex(state.mutex);
+
+		if (!is_settled) {
+			continue;
+		}
+
+		void *loaded = entry->load ? entry->load(entry->path, entry->user_data) : NULL;
+
+		SDL_LockMutex(state.mutex);
+		entry->loaded = loaded;
+		entry->is_ready = true;
+		SDL_UnlockMutex(state.mutex);
+	}
+}
+
+static int watcher_thread(void *data) {
+	struct pollfd pfd = { .fd = state.fd, .events = POLLIN };
+
+	while (true) {
+		if (poll(&pfd, 1, HOT_RELOAD_SETTLE_MS) > 0) {
+			read_events();
+		}
+
+		load_settled();
+	}
+
+	return 0;
+}
+
+void hot_reload_init(void) {
+	state.mutex = SDL_CreateMutex();
+	if (!state.mutex) {
+		ERROR_EXIT("Could not create hot reload mutex: %s\n", SDL_GetError());
+	}
+
+	state.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (state.fd < 0) {
+		ERROR_RETURN(, "Hot reload disabled, inotify_init failed. errno: %d\n", errno);
+	}
+
+	SDL_Thread *thread = SDL_CreateThread(watcher_thread, "hot_reload", NULL);
+	if (!thread) {
+		ERROR_EXIT("Could not create hot reload thread: %s\n", SDL_GetError());
+	}
+	SDL_DetachThread(thread);
+}
+
+// Directories are watched rather than files, since many editors save by
+// writing a new file and renaming it over the old one.
+static bool watch_dir(const char *path) {
+	char dir[256] = ".";
+	const char *slash = strrchr(path, '/');
+
+	if (slash) {
+		usize len = slash - path;
+		if (len >= sizeof(dir)) {
+			return false;
+		}
+		memcpy(dir, path, len);
+		dir[len] = 0;
+	}
+
+	for (usize i = 0; i < state.dir_count; ++i) {
+		if (strcmp(state.dirs[i].path, dir) == 0) {
+			return true;
+		}
+	}
+
+	if (state.dir_count == MAX_HOT_RELOAD_DIRS) {
+		ERROR_RETURN(false, "Too many hot reload directories, max is %d\n", MAX_HOT_RELOAD_DIRS);
+	}
+
+	i32 wd = inotify_add_watch(state.fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+	if (wd < 0) {
+		ERROR_RETURN(false, "Could not watch directory: %s. errno: %d\n", dir, errno);
+	}
+
+	Watched_Dir *watched = &state.dirs[state.dir_count];
+	watched->wd = wd;
+	strcpy(watched->path, dir);
+	++state.dir_count;
+
+	return true;
+}
+
+void hot_reload_watch(const char *path, Hot_Reload_Load load, Hot_Reload_Apply apply, void *user_data) {
+	if (state.fd < 0 || pack_find(path).is_valid) {
+		return;
+	}
+
+	path = pack_path_normalize(path);
+	if (strlen(path) >= sizeof(state.entries[0].path)) {
+		ERROR_RETURN(, "Hot reload path too long: %s\n", path);
+	}
+
+	SDL_LockMutex(state.mutex);
+
+	if (state.entry_count == MAX_HOT_RELOAD_WATCHES) {
+		SDL_UnlockMutex(state.mutex);
+		ERROR_RETURN(, "Too many hot reload watches, max is %d\n", MAX_HOT_RELOAD_WATCHES);
+	}
+
+	if (watch_dir(path)) {
+		Hot_Reload_Entry *entry = &state.entries[state.entry_count++];
+		*entry = (Hot_Reload_Entry){
+			.load = load,
+			.apply = apply,
+			.user_data = user_data,
+		};
+		strcpy(entry->path, path);
+	}
+
+	SDL_UnlockMutex(state.mutex);
+}
+
+void hot_reload_update(void) {
+	if (state.fd < 0) {
+		return;
+	}
+
+	for (usize i = 0; i < state.entry_count; ++i) {
+		Hot_Reload_Entry *entry = &state.entries[i];
+
+		SDL_LockMutex(state.mutex);
+		bool is_ready = entry->is_ready;
+		void *loaded = entry->loaded;
+		entry->is_ready = false;
+		entry->loaded = NULL;
+		SDL_UnlockMutex(state.mutex);
+
+		if (is_ready) {
+			printf("Reloading %s\n", entry->path);
+			entry->apply(entry->path, entry->user_data, loaded);
+		}
+	}
+}
+
+#else
+
+void hot_reload_init(void) {}
+void hot_reload_update(void) {}
+void hot_reload_watch(const char *path, Hot_Reload_Load load, Hot_Reload_Apply apply, void *user_data) {}
+
+#endif
+
+static void apply_sprite_sheet(const char *path, void *user_data, void *loaded) {
+	// The render loader decodes off-thread and swaps the texture at upload.
+	render_sprite_sheet_reload(user_data, path);
+}
+
+static void *load_sound(const char *path, void *user_data) {
+	return audio_sound_decode(path);
+}
+
+static void apply_sound(const char *path, void *user_data, void *loaded) {
+	if (loaded) {
+		audio_sound_replace(user_data, loaded);
+	}
+}
+
+static void apply_shaders(const char *path, void *user_data, void *loaded) {
+	render_shaders_reload();
+}
+
+static void apply_config(const char *path, void *user_data, void *loaded) {
+	// A replay only plays back correctly with the settings it was recorded with.
+	if (replay_is_recording() || replay_is_playing()) {
+		fprintf(stderr, "Ignoring change to %s while a replay is running.\n", path);
+		return;
+	}
+
+	config_reload();
+	time_apply_config();
+	physics_apply_config();
+	render_apply_config();
+	frame_stats_init();
+}
+
+void hot_reload_watch_sprite_sheet(Sprite_Sheet *sprite_sheet, const char *path) {
+	hot_reload_watch(path, NULL, apply_sprite_sheet, sprite_sheet);
+}
+
+void hot_reload_watch_sound(Mix_Chunk *chunk, const char *path) {
+	hot_reload_watch(path, load_sound, apply_sound, chunk);
+}
+
+void hot_reload_watch_shaders(void) {
+	hot_reload_watch(SHADER_DEFAULT_VERT, NULL, apply_shaders, NULL);
+	hot_reload_watch(SHADER_DEFAULT_FRAG, NULL, apply_shaders, NULL);
+	hot_reload_watch(SHADER_BATCH_VERT, NULL, apply_shaders, NULL);
+	hot_reload_watch(SHADER_BATCH_FRAG, NULL, apply_shaders, NULL);
+}
+
+void hot_reload_watch_config(void) {
+	hot_reload_watch("./config.ini", NULL, apply_config, NULL);
+}
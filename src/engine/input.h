@@ -1,11 +1,33 @@
 #pragma once
 
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+#include "types.h"
+
+// Keyboard events are captured by an SDL event watch as SDL delivers them and
+// pushed with a timestamp into a lock-free single-producer ring, which
+// input_update drains once per frame. Presses and releases are never lost,
+// even when both land between two frames.
+//
+// Actions are named and bound to any number of scancodes from [controls] in
+// config.ini (e.g. "jump = Space, Up"). The first INPUT_KEY_COUNT actions are
+// the built-in ones mirrored in Input_State. Every action goes through the
+// replay log.
+
+// One bit each in the binding and replay masks.
+#define MAX_INPUT_ACTIONS 64
+#define INPUT_EVENT_RING_SIZE 1024
+#define MAX_INPUT_FRAME_EVENTS 256
+#define INPUT_ACTION_NONE ((u32)-1)
+
 typedef enum input_key {
 	INPUT_KEY_LEFT,
 	INPUT_KEY_RIGHT,
 	INPUT_KEY_UP,
 	INPUT_KEY_SHOOT,
-	INPUT_KEY_ESCAPE
+	INPUT_KEY_ESCAPE,
+	INPUT_KEY_COUNT
 } Input_Key;
 
 typedef enum key_state {
@@ -22,5 +44,29 @@ typedef struct input_state {
 	Key_State escape;
 } Input_State;
 
+// A change of an action, in the order it happened.
+typedef struct input_event {
+	u64 time_ns;
+	u32 action;
+	bool is_down;
+} Input_Event;
+
+// Starts capturing events. Needs SDL's event subsystem.
+void input_init(void);
 void input_update(void);
 
+// Returns the existing action of that name, or creates it.
+u32 input_action_get(const char *name);
+u32 input_action_find(const char *name);
+bool input_action_bind(u32 action, SDL_Scancode scan_code);
+void input_action_unbind_all(u32 action);
+
+// KS_PRESSED if the action went down this frame, even if it was also
+// released again.
+Key_State input_action_state(u32 action);
+bool input_action_is_down(u32 action);
+// Presses since the last frame, so quick taps can be counted.
+u32 input_action_presses(u32 action);
+// Every action change since the last frame, oldest first, timestamped on the
+// time_now_ns clock.
+const Input_Event *input_events(usize *count);
@@ -1,24 +1,253 @@
+#include <string.h>
+
 #include "../input.h"
 #include "../global.h"
+#include "../replay.h"
+#include "../time.h"
 #include "../types.h"
+#include "../util.h"
 
-static void update_key_state(u8 current_state, Key_State *key_state) {
-	if (current_state) {
-		if (*key_state > 0)
-			*key_state = KS_HELD;
-		else
-			*key_state = KS_PRESSED;
-	} else {
-		*key_state = KS_UNPRESSED;
+typedef struct key_event {
+	u64 time_ns;
+	u16 scan_code;
+	bool is_down;
+} Key_Event;
+
+typedef struct input_action {
+	char name[32];
+	// Bound keys currently held, so releasing one of two held keys doesn't
+	// release the action.
+	u32 keys_down;
+	u32 presses;
+	// As logged, which during playback is not what keys_down says.
+	bool is_down;
+	Key_State state;
+} Input_Action;
+
+typedef struct input_internal_state {
+	// Written by the event watch only.
+	Key_Event ring[INPUT_EVENT_RING_SIZE];
+	SDL_atomic_t ring_head;
+	// Written by input_update only.
+	SDL_atomic_t ring_tail;
+	SDL_atomic_t dropped;
+
+	bool keys_down[SDL_NUM_SCANCODES];
+	// Bit n set when action n is bound to the scancode.
+	u64 bindings[SDL_NUM_SCANCODES];
+
+	Input_Action actions[MAX_INPUT_ACTIONS];
+	u32 action_count;
+
+	Input_Event events[MAX_INPUT_FRAME_EVENTS];
+	usize event_count;
+} Input_Internal_State;
+
+static Input_Internal_State state = {
+	.actions = {
+		[INPUT_KEY_LEFT] = { .name = "left" },
+		[INPUT_KEY_RIGHT] = { .name = "right" },
+		[INPUT_KEY_UP] = { .name = "up" },
+		[INPUT_KEY_SHOOT] = { .name = "shoot" },
+		[INPUT_KEY_ESCAPE] = { .name = "escape" },
+	},
+	.action_count = INPUT_KEY_COUNT,
+};
+
+// SDL calls watches from the thread that pumps events, which for keyboard
+// input is always the main thread, so there is a single producer.
+static int event_watch(void *user_data, SDL_Event *event) {
+	if ((event->type != SDL_KEYDOWN && event->type != SDL_KEYUP) || event->key.repeat)
+		return 0;
+
+	i32 head = SDL_AtomicGet(&state.ring_head);
+	if ((u32)(head - SDL_AtomicGet(&state.ring_tail)) == INPUT_EVENT_RING_SIZE) {
+		SDL_AtomicAdd(&state.dropped, 1);
+		return 0;
+	}
+
+	state.ring[head & (INPUT_EVENT_RING_SIZE - 1)] = (Key_Event){
+		.time_ns = time_now_ns(),
+		.scan_code = event->key.keysym.scancode,
+		.is_down = event->type == SDL_KEYDOWN,
+	};
+	SDL_AtomicSet(&state.ring_head, head + 1);
+
+	return 0;
+}
+
+void input_init(void) {
+	SDL_AddEventWatch(event_watch, NULL);
+}
+
+static void record_event(u64 time_ns, u32 action, bool is_down) {
+	if (state.event_count < MAX_INPUT_FRAME_EVENTS) {
+		state.events[state.event_count++] = (Input_Event){
+			.time_ns = time_ns,
+			.action = action,
+			.is_down = is_down,
+		};
 	}
 }
 
+static void apply_key_event(Key_Event *event) {
+	if (event->scan_code >= SDL_NUM_SCANCODES || state.keys_down[event->scan_code] == event->is_down)
+		return;
+
+	state.keys_down[event->scan_code] = event->is_down;
+
+	u64 bound = state.bindings[event->scan_code];
+	for (u32 i = 0; bound; ++i, bound >>= 1) {
+		if (!(bound & 1))
+			continue;
+
+		Input_Action *action = &state.actions[i];
+		if (event->is_down) {
+			if (action->keys_down++ == 0) {
+				++action->presses;
+				record_event(event->time_ns, i, true);
+			}
+		} else if (action->keys_down > 0 && --action->keys_down == 0) {
+			record_event(event->time_ns, i, false);
+		}
+	}
+}
+
+static void update_key_state(bool is_pressed, bool is_down, Key_State *key_state) {
+	if (is_pressed)
+		*key_state = KS_PRESSED;
+	else if (is_down)
+		*key_state = KS_HELD;
+	else
+		*key_state = KS_UNPRESSED;
+}
+
 void input_update() {
-	const u8 *keyboard_state = SDL_GetKeyboardState(NULL);
+	state.event_count = 0;
+	for (u32 i = 0; i < state.action_count; ++i) {
+		state.actions[i].presses = 0;
+	}
+
+	i32 head = SDL_AtomicGet(&state.ring_head);
+	i32 tail = SDL_AtomicGet(&state.ring_tail);
+
+	for (; tail != head; ++tail) {
+		apply_key_event(&state.ring[tail & (INPUT_EVENT_RING_SIZE - 1)]);
+	}
+	SDL_AtomicSet(&state.ring_tail, tail);
+
+	i32 dropped = SDL_AtomicSet(&state.dropped, 0);
+	if (dropped > 0)
+		fprintf(stderr, "Input event ring full, dropped %d events\n", dropped);
+
+	// Every action goes through the replay log, so its state is derived from
+	// the logged bits whether recording, playing or neither.
+	Replay_Actions logged = {0};
+	for (u32 i = 0; i < state.action_count; ++i) {
+		Input_Action *action = &state.actions[i];
+		logged.down |= (u64)(action->keys_down > 0) << i;
+		logged.pressed |= (u64)(action->presses > 0) << i;
+		logged.presses[i] = action->presses;
+	}
+
+	replay_actions(&logged);
+
+	// Events come from the live keyboard, so rebuild them from the log.
+	if (replay_is_playing())
+		state.event_count = 0;
+
+	for (u32 i = 0; i < state.action_count; ++i) {
+		Input_Action *action = &state.actions[i];
+		bool is_down = logged.down >> i & 1;
+		bool is_pressed = logged.pressed >> i & 1;
+
+		if (replay_is_playing()) {
+			u64 now = time_now_ns();
+			if (is_pressed && action->is_down)
+				record_event(now, i, false);
+			if (is_pressed || (is_down && !action->is_down))
+				record_event(now, i, true);
+			if (!is_down && (is_pressed || action->is_down))
+				record_event(now, i, false);
+		}
+
+		action->is_down = is_down;
+		action->presses = logged.presses[i];
+		update_key_state(is_pressed, is_down, &action->state);
+	}
+
+	global.input.left = state.actions[INPUT_KEY_LEFT].state;
+	global.input.right = state.actions[INPUT_KEY_RIGHT].state;
+	global.input.up = state.actions[INPUT_KEY_UP].state;
+	global.input.shoot = state.actions[INPUT_KEY_SHOOT].state;
+	global.input.escape = state.actions[INPUT_KEY_ESCAPE].state;
+}
+
+u32 input_action_find(const char *name) {
+	for (u32 i = 0; i < state.action_count; ++i) {
+		if (strcmp(state.actions[i].name, name) == 0)
+			return i;
+	}
+
+	return INPUT_ACTION_NONE;
+}
+
+u32 input_action_get(const char *name) {
+	u32 action = input_action_find(name);
+	if (action != INPUT_ACTION_NONE)
+		return action;
+
+	if (state.action_count == MAX_INPUT_ACTIONS)
+		ERROR_RETURN(INPUT_ACTION_NONE, "Too many input actions, max is %d\n", MAX_INPUT_ACTIONS);
+
+	if (strlen(name) >= sizeof(state.actions[0].name))
+		ERROR_RETURN(INPUT_ACTION_NONE, "Input action name too long: %s\n", name);
+
+	action = state.action_count++;
+	state.actions[action] = (Input_Action){0};
+	strcpy(state.actions[action].name, name);
+
+	return action;
+}
+
+bool input_action_bind(u32 action, SDL_Scancode scan_code) {
+	if (action >= state.action_count || scan_code <= SDL_SCANCODE_UNKNOWN || scan_code >= SDL_NUM_SCANCODES)
+		return false;
+
+	u64 bit = 1ULL << action;
+	if (!(state.bindings[scan_code] & bit)) {
+		state.bindings[scan_code] |= bit;
+		if (state.keys_down[scan_code])
+			++state.actions[action].keys_down;
+	}
+
+	return true;
+}
+
+void input_action_unbind_all(u32 action) {
+	if (action >= state.action_count)
+		return;
+
+	u64 bit = 1ULL << action;
+	for (u32 i = 0; i < SDL_NUM_SCANCODES; ++i) {
+		state.bindings[i] &= ~bit;
+	}
+	state.actions[action].keys_down = 0;
+}
+
+Key_State input_action_state(u32 action) {
+	return action < state.action_count ? state.actions[action].state : KS_UNPRESSED;
+}
+
+bool input_action_is_down(u32 action) {
+	return action < state.action_count && state.actions[action].is_down;
+}
+
+u32 input_action_presses(u32 action) {
+	return action < state.action_count ? state.actions[action].presses : 0;
+}
 
-	update_key_state(keyboard_state[global.config.keybinds[INPUT_KEY_LEFT]], &global.input.left);
-	update_key_state(keyboard_state[global.config.keybinds[INPUT_KEY_RIGHT]], &global.input.right);
-	update_key_state(keyboard_state[global.config.keybinds[INPUT_KEY_UP]], &global.input.up);
-	update_key_state(keyboard_state[global.config.keybinds[INPUT_KEY_SHOOT]], &global.input.shoot);
-	update_key_state(keyboard_state[global.config.keybinds[INPUT_KEY_ESCAPE]], &global.input.escape);
+const Input_Event *input_events(usize *count) {
+	*count = state.event_count;
+	return state.events;
 }
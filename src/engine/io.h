@@ -8,8 +8,58 @@ typedef struct file {
 	char *data;
 	usize len;
 	bool is_valid;
+	bool is_mapped;
 } File;
 
+typedef struct file_info {
+	u64 size;
+	i64 modified;
+} File_Info;
+
+// Access pattern hint passed to madvise for mapped files.
+typedef enum io_map_hint {
+	IO_MAP_NORMAL,
+	IO_MAP_SEQUENTIAL,
+	IO_MAP_RANDOM,
+} IO_Map_Hint;
+
+typedef enum io_fsync_policy {
+	IO_FSYNC_NEVER,
+	// fsync the data and the directory before io_file_write returns.
+	IO_FSYNC_ALWAYS,
+} IO_Fsync_Policy;
+
+bool io_file_exists(const char *path);
+bool io_file_info(const char *path, File_Info *info);
+// Creates a single directory level. Succeeds if it already exists.
+bool io_dir_create(const char *path);
 File io_file_read(const char *path);
+// Atomic: writes a temporary file and renames it over path.
 int io_file_write(void *buffer, usize size, const char *path);
+void io_set_fsync_policy(IO_Fsync_Policy policy);
+// Overwrites size bytes at offset in an existing file, in place. Not atomic,
+// for small header fields where a torn write only costs a recheck.
+bool io_file_patch(const char *path, u64 offset, const void *data, usize size);
+
+// Maps the file read-only, or reads it into an exact-size buffer where mapping
+// is unavailable. data is always NUL-terminated. Release with io_file_unmap.
+File io_file_map(const char *path, IO_Map_Hint hint);
+void io_file_unmap(File *file);
+
+// Streams a file in fixed-size chunks. A background I/O thread keeps up to
+// read_ahead chunks buffered. Each stream should have one consumer thread.
+typedef struct io_stream IO_Stream;
+
+IO_Stream *io_stream_open(const char *path, usize chunk_size, u32 read_ahead);
+// Copies the next chunk into buffer, which must hold at least chunk_size
+// bytes. Blocks until a chunk is ready. Returns 0 at end of file or on error.
+usize io_stream_read(IO_Stream *stream, void *buffer, usize capacity);
+void io_stream_seek(IO_Stream *stream, u64 position);
+bool io_stream_is_error(IO_Stream *stream);
+void io_stream_close(IO_Stream *stream);
 
+// Copies buffer and writes it with io_file_write on the I/O thread. A queued
+// write to the same path that hasn't started yet is replaced.
+void io_file_write_async(const void *buffer, usize size, const char *path);
+// Blocks until every queued write has finished.
+void io_flush(void);
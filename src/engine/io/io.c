@@ -1,6 +1,18 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#endif
 
 #include "../types.h"
 #include "../util.h"
@@ -12,15 +24,48 @@
 #define IO_READ_ERROR_GENERAL "Error reading filie: %s. errno: %d\n"
 #define IO_READ_ERROR_MEMORY "Not enough free memory to read file: %s\n"
 
-// Adapted from https://stackoverflow.com/a/44894946 (not the chosen answer) by Nominal Animal
-File io_file_read(const char *path) {
+// Returns false when the size can't be known up front, e.g. for pipes.
+static bool file_size(FILE *fp, usize *size) {
+#ifdef _WIN32
+	struct _stat64 st;
+	if (_fstat64(_fileno(fp), &st) != 0 || (st.st_mode & _S_IFREG) == 0)
+		return false;
+#else
+	struct stat st;
+	if (fstat(fileno(fp), &st) != 0 || !S_ISREG(st.st_mode))
+		return false;
+#endif
+
+	*size = (usize)st.st_size;
+	return true;
+}
+
+// Single exact-size read for regular files.
+static File read_exact(FILE *fp, usize size, const char *path) {
 	File file = { .is_valid = false };
 
-	FILE *fp = fopen(path, "rb");
-	if (!fp || ferror(fp)) {
+	char *data = malloc(size + 1);
+	if (!data)
+		ERROR_RETURN(file, IO_READ_ERROR_MEMORY, path);
+
+	if (fread(data, 1, size, fp) != size) {
+		free(data);
 		ERROR_RETURN(file, IO_READ_ERROR_GENERAL, path, errno);
 	}
 
+	data[size] = 0;
+
+	file.data = data;
+	file.len = size;
+	file.is_valid = true;
+
+	return file;
+}
+
+// Adapted from https://stackoverflow.com/a/44894946 (not the chosen answer) by Nominal Animal
+static File read_chunked(FILE *fp, const char *path) {
+	File file = { .is_valid = false };
+
 	char *data = NULL;
 	char *tmp;
 	usize used = 0;
@@ -71,19 +116,225 @@ File io_file_read(const char *path) {
 	return file;
 }
 
+bool io_file_exists(const char *path) {
+	struct stat st;
+	return stat(path, &st) == 0;
+}
+
+bool io_file_info(const char *path, File_Info *info) {
+	struct stat st;
+	if (stat(path, &st) != 0)
+		return false;
+
+	info->size = (u64)st.st_size;
+	info->modified = (i64)st.st_mtime;
+	return true;
+}
+
+bool io_dir_create(const char *path) {
+#ifdef _WIN32
+	if (_mkdir(path) == 0 || errno == EEXIST)
+		return true;
+#else
+	if (mkdir(path, 0755) == 0 || errno == EEXIST)
+		return true;
+#endif
+
+	ERROR_RETURN(false, "Cannot create directory: %s. errno: %d\n", path, errno);
+}
+
+File io_file_read(const char *path) {
+	File file = { .is_valid = false };
+
+	FILE *fp = fopen(path, "rb");
+	if (!fp || ferror(fp)) {
+		ERROR_RETURN(file, IO_READ_ERROR_GENERAL, path, errno);
+	}
+
+	usize size;
+	if (file_size(fp, &size))
+		file = read_exact(fp, size, path);
+	else
+		file = read_chunked(fp, path);
+
+	fclose(fp);
+
+	return file;
+}
+
+bool io_file_patch(const char *path, u64 offset, const void *data, usize size) {
+	FILE *fp = fopen(path, "r+b");
+	if (!fp)
+		return false;
+
+	bool is_written = fseek(fp, (long)offset, SEEK_SET) == 0 && fwrite(data, size, 1, fp) == 1;
+	bool is_closed = fclose(fp) == 0;
+
+	return is_written && is_closed;
+}
+
+File io_file_map(const char *path, IO_Map_Hint hint) {
+#ifndef _WIN32
+	File file = { .is_valid = false };
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		ERROR_RETURN(file, IO_READ_ERROR_GENERAL, path, errno);
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		ERROR_RETURN(file, IO_READ_ERROR_GENERAL, path, errno);
+	}
+
+	// Reserve one byte more than the file as zeroed anonymous memory, then map
+	// the file over the start of it. The byte after the file is always a NUL,
+	// even when the file ends exactly on a page boundary.
+	usize size = (usize)st.st_size;
+
+	if (S_ISREG(st.st_mode) && size > 0) {
+		void *data = mmap(NULL, size + 1, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (data != MAP_FAILED && mmap(data, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+			munmap(data, size + 1);
+			data = MAP_FAILED;
+		}
+
+		close(fd);
+
+		if (data != MAP_FAILED) {
+			if (hint == IO_MAP_SEQUENTIAL) {
+				madvise(data, size, MADV_SEQUENTIAL);
+				madvise(data, size, MADV_WILLNEED);
+			} else if (hint == IO_MAP_RANDOM) {
+				madvise(data, size, MADV_RANDOM);
+			}
+
+			file.data = data;
+			file.len = size;
+			file.is_valid = true;
+			file.is_mapped = true;
+
+			return file;
+		}
+	} else {
+		close(fd);
+	}
+#endif
+
+	return io_file_read(path);
+}
+
+void io_file_unmap(File *file) {
+	if (!file->is_valid)
+		return;
+
+#ifndef _WIN32
+	if (file->is_mapped)
+		munmap(file->data, file->len + 1);
+	else
+#endif
+		free(file->data);
+
+	*file = (File){ .is_valid = false };
+}
+
+static IO_Fsync_Policy fsync_policy = IO_FSYNC_NEVER;
+
+void io_set_fsync_policy(IO_Fsync_Policy policy) {
+	fsync_policy = policy;
+}
+
+#ifndef _WIN32
+static pthread_once_t default_mode_once = PTHREAD_ONCE_INIT;
+static mode_t default_mode;
+
+// umask can only be read by setting it, which is a process wide change, so
+// it happens once no matter how many threads write files.
+static void default_mode_init(void) {
+	mode_t mask = umask(0);
+	umask(mask);
+	default_mode = 0666 & ~mask;
+}
+#endif
+
+// Writes go to a temporary file next to the target which is renamed over it,
+// so readers (and crashes) only ever see the old or the new contents.
 int io_file_write(void *buffer, usize size, const char *path) {
-	FILE *fp = fopen(path, "wb");
+	char tmp_path[512];
+
+#ifdef _WIN32
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+	FILE *fp = fopen(tmp_path, "wb");
+#else
+	if (snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", path) >= (int)sizeof(tmp_path))
+		ERROR_RETURN(1, "Path too long: %s.\n", path);
+
+	int fd = mkstemp(tmp_path);
+	FILE *fp = fd >= 0 ? fdopen(fd, "wb") : NULL;
+	if (fd >= 0 && !fp)
+		close(fd);
+#endif
+
 	if (!fp || ferror(fp))
 		ERROR_RETURN(1, "Cannot write file: %s.\n", path);
 
-	usize chunks_written = fwrite(buffer, size, 1, fp);
+	usize chunks_written = size > 0 ? fwrite(buffer, size, 1, fp) : 1;
+	bool is_flushed = fflush(fp) == 0;
+
+#ifndef _WIN32
+	// mkstemp creates the file 0600. Keep the mode of the file being
+	// replaced, or use what a plain fopen would have created. Set before the
+	// fsync so the mode is durable too.
+	struct stat st;
+	if (stat(path, &st) == 0) {
+		fchmod(fileno(fp), st.st_mode & 07777);
+	} else {
+		pthread_once(&default_mode_once, default_mode_init);
+		fchmod(fileno(fp), default_mode);
+	}
+
+	if (is_flushed && fsync_policy == IO_FSYNC_ALWAYS)
+		is_flushed = fsync(fileno(fp)) == 0;
+#endif
 
 	fclose(fp);
 
-	if (chunks_written != 1)
+	if (chunks_written != 1 || !is_flushed) {
+		remove(tmp_path);
 		ERROR_RETURN(1, "Write error. "
 				"Expected 1 chunk, got %zu.\n", chunks_written);
+	}
+
+#ifdef _WIN32
+	bool is_renamed = MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	bool is_renamed = rename(tmp_path, path) == 0;
+#endif
+
+	if (!is_renamed) {
+		remove(tmp_path);
+		ERROR_RETURN(1, "Cannot replace file: %s. errno: %d\n", path, errno);
+	}
+
+#ifndef _WIN32
+	// Make the rename itself durable.
+	if (fsync_policy == IO_FSYNC_ALWAYS) {
+		char dir[512];
+		snprintf(dir, sizeof(dir), "%s", path);
+		char *slash = strrchr(dir, '/');
+		if (slash)
+			*slash = 0;
+		else
+			strcpy(dir, ".");
+
+		int dir_fd = open(dir, O_RDONLY);
+		if (dir_fd >= 0) {
+			fsync(dir_fd);
+			close(dir_fd);
+		}
+	}
+#endif
 
 	return 0;
 }
-
@@ -0,0 +1,347 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <SDL2/SDL.h>
+
+#include "../types.h"
+#include "../util.h"
+#include "../io.h"
+
+// A single background thread services every open stream, keeping up to
+// read_ahead chunks buffered per stream ahead of the consumer, and drains the
+// queue of deferred writes. Stream reads go first since someone is waiting on
+// them.
+
+struct io_stream {
+	FILE *fp;
+	u8 *slots;
+	usize *slot_len;
+	usize chunk_size;
+	u32 slot_count;
+	// Consumer takes from head, the I/O thread fills at tail.
+	u32 head;
+	u32 tail;
+	u64 position;
+	// Bumped by seeks so reads that were in flight are dropped.
+	u32 generation;
+	bool is_eof;
+	bool is_error;
+	bool is_busy;
+	IO_Stream *next;
+};
+
+typedef struct write_request {
+	char *path;
+	u8 *data;
+	usize size;
+	struct write_request *next;
+} Write_Request;
+
+typedef struct io_async_state {
+	SDL_mutex *mutex;
+	SDL_cond *cond_work;
+	// Signalled when a chunk is read or a write finishes.
+	SDL_cond *cond_data;
+	SDL_Thread *thread;
+	IO_Stream *streams;
+	Write_Request *write_head;
+	Write_Request *write_tail;
+	bool is_writing;
+} IO_Async_State;
+
+static IO_Async_State state;
+static SDL_SpinLock init_lock;
+
+static bool stream_wants_data(IO_Stream *stream) {
+	return !stream->is_eof && !stream->is_error && stream->tail - stream->head < stream->slot_count;
+}
+
+static IO_Stream *next_stream_with_work(void) {
+	for (IO_Stream *stream = state.streams; stream; stream = stream->next) {
+		if (stream_wants_data(stream)) {
+			return stream;
+		}
+	}
+
+	return NULL;
+}
+
+static void stream_fill(IO_Stream *stream) {
+	u32 generation = stream->generation;
+	u64 position = stream->position;
+	u8 *slot = stream->slots + (stream->tail % stream->slot_count) * stream->chunk_size;
+	stream->is_busy = true;
+
+	SDL_UnlockMutex(state.mutex);
+
+	usize n = 0;
+	bool is_error = fseek(stream->fp, (long)position, SEEK_SET) != 0;
+	if (!is_error) {
+		n = fread(slot, 1, stream->chunk_size, stream->fp);
+		is_error = ferror(stream->fp) != 0;
+	}
+
+	SDL_LockMutex(state.mutex);
+
+	stream->is_busy = false;
+
+	if (generation == stream->generation) {
+		if (is_error) {
+			stream->is_error = true;
+		} else if (n > 0) {
+			stream->slot_len[stream->tail % stream->slot_count] = n;
+			++stream->tail;
+			stream->position += n;
+		}
+
+		if (n < stream->chunk_size) {
+			stream->is_eof = true;
+		}
+	}
+
+	SDL_CondBroadcast(state.cond_data);
+}
+
+static void write_next(void) {
+	Write_Request *request = state.write_head;
+	state.write_head = request->next;
+	if (!state.write_head) {
+		state.write_tail = NULL;
+	}
+	state.is_writing = true;
+
+	SDL_UnlockMutex(state.mutex);
+
+	io_file_write(request->data, request->size, request->path);
+	free(request->path);
+	free(request->data);
+	free(request);
+
+	SDL_LockMutex(state.mutex);
+
+	state.is_writing = false;
+	SDL_CondBroadcast(state.cond_data);
+}
+
+static int io_thread(void *data) {
+	SDL_LockMutex(state.mutex);
+
+	while (true) {
+		IO_Stream *stream = next_stream_with_work();
+		if (stream) {
+			stream_fill(stream);
+		} else if (state.write_head) {
+			write_next();
+		} else {
+			SDL_CondWait(state.cond_work, state.mutex);
+		}
+	}
+
+	SDL_UnlockMutex(state.mutex);
+
+	return 0;
+}
+
+static void io_async_init(void) {
+	SDL_AtomicLock(&init_lock);
+
+	if (!state.thread) {
+		state.mutex = SDL_CreateMutex();
+		state.cond_work = SDL_CreateCond();
+		state.cond_data = SDL_CreateCond();
+		if (!state.mutex || !state.cond_work || !state.cond_data) {
+			ERROR_EXIT("Could not create I/O sync objects: %s\n", SDL_GetError());
+		}
+
+		state.thread = SDL_CreateThread(io_thread, "io", NULL);
+		if (!state.thread) {
+			ERROR_EXIT("Could not create I/O thread: %s\n", SDL_GetError());
+		}
+	}
+
+	SDL_AtomicUnlock(&init_lock);
+}
+
+IO_Stream *io_stream_open(const char *path, usize chunk_size, u32 read_ahead) {
+	io_async_init();
+
+	if (chunk_size == 0 || read_ahead == 0)
+		ERROR_RETURN(NULL, "Invalid stream parameters for %s\n", path);
+
+	FILE *fp = fopen(path, "rb");
+	if (!fp)
+		ERROR_RETURN(NULL, "Error opening stream: %s. errno: %d\n", path, errno);
+
+	IO_Stream *stream = calloc(1, sizeof(IO_Stream));
+	if (stream) {
+		stream->slots = malloc(chunk_size * read_ahead);
+		stream->slot_len = calloc(read_ahead, sizeof(usize));
+	}
+
+	if (!stream || !stream->slots || !stream->slot_len) {
+		fclose(fp);
+		if (stream) {
+			free(stream->slots);
+			free(stream->slot_len);
+		}
+		free(stream);
+		ERROR_RETURN(NULL, "Not enough free memory to stream file: %s\n", path);
+	}
+
+	// Our own read-ahead replaces stdio buffering.
+	setvbuf(fp, NULL, _IONBF, 0);
+
+	stream->fp = fp;
+	stream->chunk_size = chunk_size;
+	stream->slot_count = read_ahead;
+
+	SDL_LockMutex(state.mutex);
+	stream->next = state.streams;
+	state.streams = stream;
+	SDL_CondSignal(state.cond_work);
+	SDL_UnlockMutex(state.mutex);
+
+	return stream;
+}
+
+usize io_stream_read(IO_Stream *stream, void *buffer, usize capacity) {
+	if (capacity < stream->chunk_size)
+		ERROR_RETURN(0, "Stream buffer smaller than chunk size: %zu < %zu\n", capacity, stream->chunk_size);
+
+	SDL_LockMutex(state.mutex);
+
+	while (stream->head == stream->tail && !stream->is_eof && !stream->is_error) {
+		SDL_CondWait(state.cond_data, state.mutex);
+	}
+
+	if (stream->head == stream->tail) {
+		SDL_UnlockMutex(state.mutex);
+		return 0;
+	}
+
+	u32 index = stream->head % stream->slot_count;
+	usize len = stream->slot_len[index];
+
+	SDL_UnlockMutex(state.mutex);
+
+	// The I/O thread never writes to a slot between head and tail, so the copy
+	// can happen without holding the lock.
+	memcpy(buffer, stream->slots + index * stream->chunk_size, len);
+
+	SDL_LockMutex(state.mutex);
+	++stream->head;
+	SDL_CondSignal(state.cond_work);
+	SDL_UnlockMutex(state.mutex);
+
+	return len;
+}
+
+void io_stream_seek(IO_Stream *stream, u64 position) {
+	SDL_LockMutex(state.mutex);
+
+	stream->head = stream->tail;
+	stream->position = position;
+	stream->is_eof = false;
+	stream->is_error = false;
+	++stream->generation;
+
+	SDL_CondSignal(state.cond_work);
+	SDL_UnlockMutex(state.mutex);
+}
+
+bool io_stream_is_error(IO_Stream *stream) {
+	SDL_LockMutex(state.mutex);
+	bool is_error = stream->is_error;
+	SDL_UnlockMutex(state.mutex);
+
+	return is_error;
+}
+
+void io_stream_close(IO_Stream *stream) {
+	SDL_LockMutex(state.mutex);
+
+	while (stream->is_busy) {
+		SDL_CondWait(state.cond_data, state.mutex);
+	}
+
+	IO_Stream **link = &state.streams;
+	while (*link != stream) {
+		link = &(*link)->next;
+	}
+	*link = stream->next;
+
+	SDL_UnlockMutex(state.mutex);
+
+	fclose(stream->fp);
+	free(stream->slots);
+	free(stream->slot_len);
+	free(stream);
+}
+
+void io_file_write_async(const void *buffer, usize size, const char *path) {
+	io_async_init();
+
+	u8 *data = malloc(size > 0 ? size : 1);
+	char *path_copy = malloc(strlen(path) + 1);
+	if (!data || !path_copy) {
+		free(data);
+		free(path_copy);
+		ERROR_RETURN(, "Not enough free memory to queue write: %s\n", path);
+	}
+
+	memcpy(data, buffer, size);
+	strcpy(path_copy, path);
+
+	SDL_LockMutex(state.mutex);
+
+	// Only the latest contents matter, replace a pending write to the same file.
+	for (Write_Request *request = state.write_head; request; request = request->next) {
+		if (strcmp(request->path, path) == 0) {
+			free(request->data);
+			free(path_copy);
+			request->data = data;
+			request->size = size;
+			SDL_UnlockMutex(state.mutex);
+			return;
+		}
+	}
+
+	Write_Request *request = malloc(sizeof(Write_Request));
+	if (!request) {
+		SDL_UnlockMutex(state.mutex);
+		free(data);
+		free(path_copy);
+		ERROR_RETURN(, "Not enough free memory to queue write: %s\n", path);
+	}
+
+	*request = (Write_Request){
+		.path = path_copy,
+		.data = data,
+		.size = size,
+	};
+
+	if (state.write_tail) {
+		state.write_tail->next = request;
+	} else {
+		state.write_head = request;
+	}
+	state.write_tail = request;
+
+	SDL_CondSignal(state.cond_work);
+	SDL_UnlockMutex(state.mutex);
+}
+
+void io_flush(void) {
+	if (!state.thread) {
+		return;
+	}
+
+	SDL_LockMutex(state.mutex);
+
+	while (state.write_head || state.is_writing) {
+		SDL_CondWait(state.cond_data, state.mutex);
+	}
+
+	SDL_UnlockMutex(state.mutex);
+}
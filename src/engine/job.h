@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+#include "types.h"
+
+// Work-stealing job system. Every pool thread owns a Chase-Lev deque: it
+// pushes and pops its own jobs at the bottom without locking while idle
+// threads steal from the top of the others. The thread that calls job_init is
+// thread 0; it has no worker loop and runs jobs while it waits on a counter.
+// Threads outside the pool submit through a shared locked queue.
+//
+// Waiting never parks a worker: job_wait runs other jobs until the counter
+// drains, and job_run_after chains work onto a counter instead of waiting.
+
+#define JOB_MAX_THREADS 64
+// Per deque, must be a power of two. Jobs pushed to a full deque run inline.
+#define JOB_QUEUE_SIZE 4096
+#define JOB_DEFAULT_BATCH 64
+
+typedef void (*Job_Function)(void *data);
+// Processes indices [start, end).
+typedef void (*Job_Range_Function)(void *data, u32 start, u32 end);
+
+typedef struct job_continuation Job_Continuation;
+
+// Number of unfinished jobs, plus the continuations to start when it drops to
+// zero. Zero-initialize. A counter can be reused once it has drained.
+typedef struct job_counter {
+	SDL_atomic_t value;
+	SDL_SpinLock lock;
+	Job_Continuation *continuations;
+} Job_Counter;
+
+// Starts worker_count workers, or one per extra core if negative. With none,
+// jobs run when the main thread waits.
+void job_init(i32 worker_count);
+// Runs what is still queued, then stops the workers.
+void job_shutdown(void);
+// Workers plus the main thread.
+u32 job_thread_count(void);
+// 0 on the main thread and on threads outside the pool.
+u32 job_thread_index(void);
+
+// counter may be NULL.
+void job_run(Job_Function function, void *data, Job_Counter *counter);
+// Runs the job once dependency drains, or now if it already has. counter is
+// incremented immediately, so waiting on it also waits for the continuation.
+void job_run_after(Job_Counter *dependency, Job_Function function, void *data, Job_Counter *counter);
+// Splits [0, count) into ranges of at most batch indices. Idle threads steal
+// the larger halves, so uneven ranges balance themselves.
+void job_run_range(Job_Range_Function function, void *data, u32 count, u32 batch, Job_Counter *counter);
+// job_run_range and job_wait.
+void job_parallel_for(Job_Range_Function function, void *data, u32 count, u32 batch);
+
+// Runs one queued job on the calling thread. False if there was none.
+bool job_run_one(void);
+// Runs queued jobs until the counter reaches zero.
+void job_wait(Job_Counter *counter);
@@ -0,0 +1,439 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+
+#include "../util.h"
+#include "../profile.h"
+#include "../job.h"
+
+// Failed searches before a worker goes to sleep.
+#define JOB_SPIN_COUNT 256
+
+typedef struct job {
+	Job_Function function;
+	// Set instead of function for range jobs.
+	Job_Range_Function range_function;
+	void *data;
+	Job_Counter *counter;
+	u32 start;
+	u32 end;
+	u32 batch;
+} Job;
+
+struct job_continuation {
+	Job job;
+	Job_Continuation *next;
+};
+
+// Chase-Lev deque over a fixed ring. Only the owner writes bottom; top only
+// ever moves up, by CAS. Indices wrap, so sizes are taken as differences.
+typedef struct job_deque {
+	SDL_atomic_t top;
+	u8 top_padding[64 - sizeof(SDL_atomic_t)];
+	SDL_atomic_t bottom;
+	u8 bottom_padding[64 - sizeof(SDL_atomic_t)];
+	Job jobs[JOB_QUEUE_SIZE];
+} Job_Deque;
+
+// For threads outside the pool, which can't push to a deque they don't own.
+typedef struct job_injection_queue {
+	SDL_mutex *mutex;
+	Job jobs[JOB_QUEUE_SIZE];
+	u32 head;
+	u32 tail;
+} Job_Injection_Queue;
+
+typedef struct job_state {
+	Job_Deque *deques;
+	SDL_Thread *threads[JOB_MAX_THREADS];
+	u32 thread_count;
+	Job_Injection_Queue injected;
+	// Queued jobs across every queue, workers sleep while it is zero.
+	SDL_atomic_t pending;
+	SDL_atomic_t sleeping;
+	SDL_atomic_t is_quitting;
+	SDL_mutex *sleep_mutex;
+	SDL_cond *sleep_cond;
+} Job_State;
+
+static Job_State state;
+static _Thread_local u32 thread_index;
+static _Thread_local bool is_pool_thread;
+static _Thread_local u32 steal_seed;
+
+static i32 index_distance(i32 from, i32 to) {
+	return (i32)((u32)to - (u32)from);
+}
+
+static bool deque_push(Job_Deque *deque, Job job) {
+	i32 bottom = SDL_AtomicGet(&deque->bottom);
+	i32 top = SDL_AtomicGet(&deque->top);
+
+	if (index_distance(top, bottom) >= JOB_QUEUE_SIZE)
+		return false;
+
+	deque->jobs[bottom & (JOB_QUEUE_SIZE - 1)] = job;
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&deque->bottom, (i32)((u32)bottom + 1));
+
+	return true;
+}
+
+static bool deque_pop(Job_Deque *deque, Job *job) {
+	i32 old_bottom = SDL_AtomicGet(&deque->bottom);
+	i32 bottom = (i32)((u32)old_bottom - 1);
+
+	// Always succeeds since only the owner writes bottom. It's a CAS for the
+	// full barrier: a thief must see the new bottom before we read top.
+	SDL_AtomicCAS(&deque->bottom, old_bottom, bottom);
+
+	i32 top = SDL_AtomicGet(&deque->top);
+	i32 size = index_distance(top, bottom);
+
+	if (size < 0) {
+		SDL_AtomicSet(&deque->bottom, top);
+		return false;
+	}
+
+	*job = deque->jobs[bottom & (JOB_QUEUE_SIZE - 1)];
+	if (size > 0)
+		return true;
+
+	// Last job, race the thieves for it.
+	bool is_won = SDL_AtomicCAS(&deque->top, top, (i32)((u32)top + 1));
+	SDL_AtomicSet(&deque->bottom, (i32)((u32)top + 1));
+
+	return is_won;
+}
+
+static bool deque_steal(Job_Deque *deque, Job *job) {
+	i32 top = SDL_AtomicGet(&deque->top);
+	SDL_MemoryBarrierAcquire();
+	i32 bottom = SDL_AtomicGet(&deque->bottom);
+
+	if (index_distance(top, bottom) <= 0)
+		return false;
+
+	// May be torn if the owner popped it meanwhile, but then the CAS fails.
+	Job stolen = deque->jobs[top & (JOB_QUEUE_SIZE - 1)];
+	if (!SDL_AtomicCAS(&deque->top, top, (i32)((u32)top + 1)))
+		return false;
+
+	*job = stolen;
+
+	return true;
+}
+
+static bool injected_push(Job job) {
+	Job_Injection_Queue *queue = &state.injected;
+	SDL_LockMutex(queue->mutex);
+
+	bool is_pushed = queue->tail - queue->head < JOB_QUEUE_SIZE;
+	if (is_pushed) {
+		queue->jobs[queue->tail & (JOB_QUEUE_SIZE - 1)] = job;
+		++queue->tail;
+	}
+
+	SDL_UnlockMutex(queue->mutex);
+
+	return is_pushed;
+}
+
+static bool injected_pop(Job *job) {
+	Job_Injection_Queue *queue = &state.injected;
+	SDL_LockMutex(queue->mutex);
+
+	bool is_popped = queue->head != queue->tail;
+	if (is_popped) {
+		*job = queue->jobs[queue->head & (JOB_QUEUE_SIZE - 1)];
+		++queue->head;
+	}
+
+	SDL_UnlockMutex(queue->mutex);
+
+	return is_popped;
+}
+
+static void job_execute(Job job);
+
+static void job_push(Job job) {
+	bool is_pushed;
+	if (state.thread_count == 0) {
+		is_pushed = false;
+	} else if (is_pool_thread) {
+		is_pushed = deque_push(&state.deques[thread_index], job);
+	} else {
+		is_pushed = injected_push(job);
+	}
+
+	if (!is_pushed) {
+		job_execute(job);
+		return;
+	}
+
+	SDL_AtomicAdd(&state.pending, 1);
+
+	// Pairs with the sleeping/pending check in worker_sleep: either the worker
+	// sees the job or we see the worker.
+	if (SDL_AtomicGet(&state.sleeping) > 0) {
+		SDL_LockMutex(state.sleep_mutex);
+		SDL_CondSignal(state.sleep_cond);
+		SDL_UnlockMutex(state.sleep_mutex);
+	}
+}
+
+static void counter_submit(Job_Continuation *continuation) {
+	while (continuation) {
+		Job_Continuation *next = continuation->next;
+		job_push(continuation->job);
+		free(continuation);
+		continuation = next;
+	}
+}
+
+static void counter_decrement(Job_Counter *counter) {
+	while (true) {
+		i32 value = SDL_AtomicGet(&counter->value);
+		if (value <= 1)
+			break;
+		if (SDL_AtomicCAS(&counter->value, value, value - 1))
+			return;
+	}
+
+	// Possibly the last job. Reaching zero under the lock keeps it atomic with
+	// job_run_after's check, and job_wait takes the lock before returning so
+	// the counter outlives this block.
+	Job_Continuation *continuations = NULL;
+
+	SDL_AtomicLock(&counter->lock);
+	if (SDL_AtomicAdd(&counter->value, -1) == 1) {
+		continuations = counter->continuations;
+		counter->continuations = NULL;
+	}
+	SDL_AtomicUnlock(&counter->lock);
+
+	counter_submit(continuations);
+}
+
+// Keeps the lower half of a range and offers the upper halves to thieves,
+// largest first.
+static void job_execute(Job job) {
+	if (job.range_function) {
+		while (job.end - job.start > job.batch) {
+			Job upper = job;
+			upper.start = job.start + (job.end - job.start) / 2;
+			job.end = upper.start;
+
+			if (job.counter)
+				SDL_AtomicAdd(&job.counter->value, 1);
+			job_push(upper);
+		}
+
+		job.range_function(job.data, job.start, job.end);
+	} else {
+		job.function(job.data);
+	}
+
+	if (job.counter)
+		counter_decrement(job.counter);
+}
+
+static bool job_find(Job *job) {
+	if (is_pool_thread && deque_pop(&state.deques[thread_index], job))
+		return true;
+
+	if (injected_pop(job))
+		return true;
+
+	// Start from a random victim so thieves spread out.
+	steal_seed = steal_seed * 1664525 + 1013904223;
+	u32 first = (steal_seed >> 16) % state.thread_count;
+
+	for (u32 i = 0; i < state.thread_count; ++i) {
+		u32 victim = (first + i) % state.thread_count;
+		if ((!is_pool_thread || victim != thread_index) && deque_steal(&state.deques[victim], job))
+			return true;
+	}
+
+	return false;
+}
+
+static void worker_sleep(void) {
+	SDL_LockMutex(state.sleep_mutex);
+	SDL_AtomicAdd(&state.sleeping, 1);
+
+	while (SDL_AtomicGet(&state.pending) == 0 && !SDL_AtomicGet(&state.is_quitting)) {
+		SDL_CondWait(state.sleep_cond, state.sleep_mutex);
+	}
+
+	SDL_AtomicAdd(&state.sleeping, -1);
+	SDL_UnlockMutex(state.sleep_mutex);
+}
+
+static int worker_thread(void *data) {
+	thread_index = (u32)(usize)data;
+	is_pool_thread = true;
+	steal_seed = thread_index;
+
+	char name[16];
+	snprintf(name, sizeof(name), "job %u", thread_index);
+	profile_thread_name(name);
+
+	u32 spins = 0;
+
+	while (!SDL_AtomicGet(&state.is_quitting)) {
+		if (job_run_one()) {
+			spins = 0;
+		} else if (++spins < JOB_SPIN_COUNT) {
+			SDL_CPUPauseInstruction();
+		} else {
+			worker_sleep();
+			spins = 0;
+		}
+	}
+
+	return 0;
+}
+
+void job_init(i32 worker_count) {
+	if (worker_count < 0)
+		worker_count = SDL_GetCPUCount() - 1;
+	if (worker_count < 0)
+		worker_count = 0;
+	if (worker_count > JOB_MAX_THREADS - 1)
+		worker_count = JOB_MAX_THREADS - 1;
+
+	state.thread_count = worker_count + 1;
+	state.deques = aligned_alloc(64, sizeof(Job_Deque) * state.thread_count);
+	if (!state.deques)
+		ERROR_EXIT("Not enough memory for job queues\n");
+
+	for (u32 i = 0; i < state.thread_count; ++i) {
+		SDL_AtomicSet(&state.deques[i].top, 0);
+		SDL_AtomicSet(&state.deques[i].bottom, 0);
+	}
+
+	state.injected.mutex = SDL_CreateMutex();
+	state.sleep_mutex = SDL_CreateMutex();
+	state.sleep_cond = SDL_CreateCond();
+	if (!state.injected.mutex || !state.sleep_mutex || !state.sleep_cond)
+		ERROR_EXIT("Could not create job sync objects: %s\n", SDL_GetError());
+
+	thread_index = 0;
+	is_pool_thread = true;
+	steal_seed = 0x9e3779b9;
+
+	for (u32 i = 1; i < state.thread_count; ++i) {
+		state.threads[i] = SDL_CreateThread(worker_thread, "job", (void*)(usize)i);
+		if (!state.threads[i])
+			ERROR_EXIT("Could not create job worker: %s\n", SDL_GetError());
+	}
+}
+
+void job_shutdown(void) {
+	while (SDL_AtomicGet(&state.pending) > 0) {
+		if (!job_run_one())
+			SDL_Delay(0);
+	}
+
+	SDL_LockMutex(state.sleep_mutex);
+	SDL_AtomicSet(&state.is_quitting, 1);
+	SDL_CondBroadcast(state.sleep_cond);
+	SDL_UnlockMutex(state.sleep_mutex);
+
+	for (u32 i = 1; i < state.thread_count; ++i) {
+		SDL_WaitThread(state.threads[i], NULL);
+	}
+
+	free(state.deques);
+	SDL_DestroyMutex(state.injected.mutex);
+	SDL_DestroyCond(state.sleep_cond);
+	SDL_DestroyMutex(state.sleep_mutex);
+	state = (Job_State){0};
+	is_pool_thread = false;
+}
+
+u32 job_thread_count(void) {
+	return state.thread_count;
+}
+
+u32 job_thread_index(void) {
+	return is_pool_thread ? thread_index : 0;
+}
+
+void job_run(Job_Function function, void *data, Job_Counter *counter) {
+	if (counter)
+		SDL_AtomicAdd(&counter->value, 1);
+
+	job_push((Job){ .function = function, .data = data, .counter = counter });
+}
+
+void job_run_after(Job_Counter *dependency, Job_Function function, void *data, Job_Counter *counter) {
+	Job job = { .function = function, .data = data, .counter = counter };
+
+	if (counter)
+		SDL_AtomicAdd(&counter->value, 1);
+
+	SDL_AtomicLock(&dependency->lock);
+
+	if (SDL_AtomicGet(&dependency->value) > 0) {
+		Job_Continuation *continuation = malloc(sizeof(Job_Continuation));
+		if (!continuation) {
+			SDL_AtomicUnlock(&dependency->lock);
+			ERROR_EXIT("Not enough memory for job continuation\n");
+		}
+
+		*continuation = (Job_Continuation){ .job = job, .next = dependency->continuations };
+		dependency->continuations = continuation;
+		SDL_AtomicUnlock(&dependency->lock);
+		return;
+	}
+
+	SDL_AtomicUnlock(&dependency->lock);
+	job_push(job);
+}
+
+void job_run_range(Job_Range_Function function, void *data, u32 count, u32 batch, Job_Counter *counter) {
+	if (count == 0)
+		return;
+
+	if (counter)
+		SDL_AtomicAdd(&counter->value, 1);
+
+	job_push((Job){
+		.range_function = function,
+		.data = data,
+		.counter = counter,
+		.start = 0,
+		.end = count,
+		.batch = batch > 0 ? batch : 1,
+	});
+}
+
+void job_parallel_for(Job_Range_Function function, void *data, u32 count, u32 batch) {
+	Job_Counter counter = {0};
+	job_run_range(function, data, count, batch, &counter);
+	job_wait(&counter);
+}
+
+bool job_run_one(void) {
+	Job job;
+	if (!job_find(&job))
+		return false;
+
+	SDL_AtomicAdd(&state.pending, -1);
+	job_execute(job);
+
+	return true;
+}
+
+void job_wait(Job_Counter *counter) {
+	while (SDL_AtomicGet(&counter->value) > 0) {
+		if (!job_run_one())
+			SDL_CPUPauseInstruction();
+	}
+
+	// The last job may still be inside counter_decrement.
+	SDL_AtomicLock(&counter->lock);
+	SDL_AtomicUnlock(&counter->lock);
+}
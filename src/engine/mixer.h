@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "types.h"
+
+// Engine-owned software mixer. Voices are float buffers at any sample rate,
+// mixed into interleaved stereo f32 with linear resampling, per-voice gain and
+// constant-power pan. The inner loops use SSE when available; build with
+// -DMIXER_NO_SIMD for the scalar reference path.
+//
+// The mix goes to an SDL audio device, a float WAV file, or nowhere. The file
+// and null outputs are pumped in real time by mixer_update on the calling
+// thread, so they need no audio hardware.
+
+#define MAX_MIXER_VOICES 128
+#define MIXER_DEFAULT_SAMPLE_RATE 48000
+#define MIXER_DEFAULT_BLOCK_FRAMES 512
+
+typedef enum mixer_output {
+	MIXER_OUTPUT_NULL,
+	MIXER_OUTPUT_SDL,
+	MIXER_OUTPUT_WAV,
+} Mixer_Output;
+
+// Interleaved f32, 1 or 2 channels. The mixer only borrows samples, they must
+// outlive every voice playing them.
+typedef struct mixer_sound {
+	const f32 *samples;
+	u32 frame_count;
+	u32 channels;
+	u32 sample_rate;
+} Mixer_Sound;
+
+typedef struct mixer_voice_params {
+	f32 gain;
+	// -1 is hard left, 1 is hard right.
+	f32 pan;
+	// Playback rate multiplier on top of the sample rate conversion.
+	f32 pitch;
+	bool is_looping;
+} Mixer_Voice_Params;
+
+// Adds frames of interleaved stereo into out, after the voices are mixed.
+// Runs on the output's thread and must not block.
+typedef void (*Mixer_Stream)(f32 *out, u32 frames, void *user_data);
+
+// wav_path is only used by MIXER_OUTPUT_WAV.
+bool mixer_init(Mixer_Output output, u32 sample_rate, u32 block_frames, const char *wav_path);
+void mixer_shutdown(void);
+u32 mixer_sample_rate(void);
+// Renders whatever the null and file outputs are due. No-op for SDL output.
+void mixer_update(void);
+
+// Voices are addressed by slot, 0 to MAX_MIXER_VOICES - 1. Voice calls are
+// queued for the output thread without locking and must not run concurrently.
+// They take effect at the start of the next mixed block. Plays and parameter
+// changes are dropped when the queue is full, stops never wait or drop.
+bool mixer_voice_play(u32 voice, const Mixer_Sound *sound, Mixer_Voice_Params params);
+void mixer_voice_set(u32 voice, Mixer_Voice_Params params);
+void mixer_voice_stop(u32 voice);
+bool mixer_voice_is_playing(u32 voice);
+// Waits until stopped voices no longer reference their samples. Only needed
+// before freeing them.
+void mixer_sync(void);
+// Plays and parameter changes dropped because the queue was full.
+u32 mixer_commands_dropped(void);
+
+// One streamed source, such as music, mixed on top of the voices. NULL removes it.
+void mixer_stream_set(Mixer_Stream stream, void *user_data);
+
+// Mixes every voice into frames of interleaved stereo, overwriting out.
+// Called by the outputs; exposed for benchmarks and tests.
+void mixer_render(f32 *out, u32 frames);
+
+// Decodes a WAV (from the pack when mounted) to f32 at its own rate and
+// channel count. Release with mixer_sound_free.
+bool mixer_sound_load(Mixer_Sound *sound, const char *path);
+// Converts to stereo at the mixer's rate so voices take the copy-free path.
+bool mixer_sound_load_native(Mixer_Sound *sound, const char *path);
+void mixer_sound_free(Mixer_Sound *sound);
@@ -0,0 +1,385 @@
+#include <math.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "../mixer.h"
+#include "mixer_internal.h"
+
+#if defined(__SSE2__) && !defined(MIXER_NO_SIMD)
+#define MIXER_SSE
+#include <emmintrin.h>
+#endif
+
+// Frames resampled into a scratch buffer at a time before being mixed.
+#define RESAMPLE_BLOCK 256
+#define FIXED_ONE (1ULL << 32)
+#define MIXER_COMMAND_QUEUE_SIZE 1024
+
+typedef enum mixer_command_type {
+	MIXER_COMMAND_PLAY,
+	MIXER_COMMAND_SET,
+} Mixer_Command_Type;
+
+typedef struct mixer_command {
+	Mixer_Command_Type type;
+	u32 voice;
+	u32 play_id;
+	Mixer_Sound sound;
+	Mixer_Voice_Params params;
+} Mixer_Command;
+
+typedef struct mixer_voice {
+	Mixer_Sound sound;
+	// 32.32 fixed point, in source frames.
+	u64 position;
+	u64 step;
+	f32 gain_left;
+	f32 gain_right;
+	u32 play_id;
+	bool is_looping;
+	bool is_playing;
+} Mixer_Voice;
+
+typedef struct mixer_core_state {
+	// Voice changes go through the queue, so the output thread never waits
+	// on the game thread.
+	Mixer_Command commands[MIXER_COMMAND_QUEUE_SIZE];
+	// The output thread takes from head, the game thread pushes at tail.
+	SDL_atomic_t command_head;
+	SDL_atomic_t command_tail;
+	SDL_atomic_t commands_dropped;
+	// The last play each voice finished, published by the output thread.
+	SDL_atomic_t finished_ids[MAX_MIXER_VOICES];
+	// The play each voice was last told to stop. Stops skip the queue so they
+	// can never be dropped or wait for room.
+	SDL_atomic_t stop_ids[MAX_MIXER_VOICES];
+
+	// Game thread.
+	u32 play_ids[MAX_MIXER_VOICES];
+	bool is_stopped[MAX_MIXER_VOICES];
+
+	// Output thread.
+	Mixer_Voice voices[MAX_MIXER_VOICES];
+	Mixer_Stream stream;
+	void *stream_user_data;
+	u32 sample_rate;
+} Mixer_Core_State;
+
+static Mixer_Core_State state = { .sample_rate = MIXER_DEFAULT_SAMPLE_RATE };
+
+void mixer_core_init(u32 sample_rate) {
+	state = (Mixer_Core_State){ .sample_rate = sample_rate };
+}
+
+u32 mixer_sample_rate(void) {
+	return state.sample_rate;
+}
+
+static void voice_apply(Mixer_Voice *voice, Mixer_Voice_Params params) {
+	f32 pan = params.pan < -1 ? -1 : params.pan > 1 ? 1 : params.pan;
+	f32 angle = (pan + 1) * (f32)M_PI * 0.25f;
+	f32 pitch = params.pitch > 0 ? params.pitch : 1;
+
+	voice->gain_left = params.gain * cosf(angle);
+	voice->gain_right = params.gain * sinf(angle);
+	voice->step = (u64)((f64)voice->sound.sample_rate / state.sample_rate * pitch * FIXED_ONE);
+	voice->is_looping = params.is_looping;
+
+	// Identical rates take the copy path, don't let rounding push them off it.
+	if (voice->sound.sample_rate == state.sample_rate && pitch == 1)
+		voice->step = FIXED_ONE;
+}
+
+static void commands_drain(void) {
+	i32 head = SDL_AtomicGet(&state.command_head);
+	i32 tail = SDL_AtomicGet(&state.command_tail);
+
+	for (; head != tail; ++head) {
+		Mixer_Command *command = &state.commands[(u32)head % MIXER_COMMAND_QUEUE_SIZE];
+		Mixer_Voice *voice = &state.voices[command->voice];
+
+		switch (command->type) {
+		case MIXER_COMMAND_PLAY:
+			if (voice->is_playing)
+				SDL_AtomicSet(&state.finished_ids[command->voice], voice->play_id);
+			*voice = (Mixer_Voice){
+				.sound = command->sound,
+				.play_id = command->play_id,
+				.is_playing = true,
+			};
+			voice_apply(voice, command->params);
+			break;
+		case MIXER_COMMAND_SET:
+			voice_apply(voice, command->params);
+			break;
+		}
+	}
+
+	SDL_AtomicSet(&state.command_head, head);
+}
+
+// Only the game thread pushes, only the output thread drains. A full queue
+// drops the command.
+static bool command_push(Mixer_Command *command) {
+	i32 tail = SDL_AtomicGet(&state.command_tail);
+
+	if ((u32)(tail - SDL_AtomicGet(&state.command_head)) == MIXER_COMMAND_QUEUE_SIZE) {
+		SDL_AtomicAdd(&state.commands_dropped, 1);
+		return false;
+	}
+
+	state.commands[(u32)tail % MIXER_COMMAND_QUEUE_SIZE] = *command;
+	SDL_AtomicSet(&state.command_tail, tail + 1);
+
+	return true;
+}
+
+bool mixer_voice_play(u32 voice_index, const Mixer_Sound *sound, Mixer_Voice_Params params) {
+	if (voice_index >= MAX_MIXER_VOICES || !sound->samples || sound->frame_count == 0
+			|| (sound->channels != 1 && sound->channels != 2))
+		return false;
+
+	// Ids skip 0, which every voice starts out finished with.
+	u32 play_id = state.play_ids[voice_index] + 1;
+	if (play_id == 0)
+		play_id = 1;
+
+	Mixer_Command command = {
+		.type = MIXER_COMMAND_PLAY,
+		.voice = voice_index,
+		.play_id = play_id,
+		.sound = *sound,
+		.params = params,
+	};
+
+	if (!command_push(&command))
+		return false;
+
+	state.play_ids[voice_index] = play_id;
+	state.is_stopped[voice_index] = false;
+
+	return true;
+}
+
+void mixer_voice_set(u32 voice_index, Mixer_Voice_Params params) {
+	if (voice_index >= MAX_MIXER_VOICES)
+		return;
+
+	Mixer_Command command = {
+		.type = MIXER_COMMAND_SET,
+		.voice = voice_index,
+		.params = params,
+	};
+	command_push(&command);
+}
+
+// A stop is the voice's current play id, which the output thread checks
+// before mixing, so it also catches a play still in the queue.
+void mixer_voice_stop(u32 voice_index) {
+	if (voice_index >= MAX_MIXER_VOICES || state.is_stopped[voice_index])
+		return;
+
+	SDL_AtomicSet(&state.stop_ids[voice_index], state.play_ids[voice_index]);
+	state.is_stopped[voice_index] = true;
+}
+
+// Answered from the game thread's own view, a voice that was just played or
+// stopped reports so before the output thread has seen the command.
+bool mixer_voice_is_playing(u32 voice_index) {
+	if (voice_index >= MAX_MIXER_VOICES)
+		return false;
+
+	return !state.is_stopped[voice_index]
+		&& (u32)SDL_AtomicGet(&state.finished_ids[voice_index]) != state.play_ids[voice_index];
+}
+
+// Renders hold the output lock, so once it is taken any render that could
+// have missed a stop is over, and later ones check stops before mixing.
+void mixer_sync(void) {
+	mixer_output_lock();
+	mixer_output_unlock();
+}
+
+u32 mixer_commands_dropped(void) {
+	return SDL_AtomicGet(&state.commands_dropped);
+}
+
+void mixer_stream_set(Mixer_Stream stream, void *user_data) {
+	mixer_output_lock();
+	state.stream = stream;
+	state.stream_user_data = user_data;
+	mixer_output_unlock();
+}
+
+// Accumulate frames of source samples into stereo out with the given gains.
+static void mix_mono(const f32 *src, f32 *out, u32 frames, f32 gain_left, f32 gain_right) {
+	u32 i = 0;
+
+#ifdef MIXER_SSE
+	__m128 gains = _mm_setr_ps(gain_left, gain_right, gain_left, gain_right);
+
+	for (; i + 4 <= frames; i += 4) {
+		__m128 s = _mm_loadu_ps(src + i);
+		__m128 lo = _mm_mul_ps(_mm_unpacklo_ps(s, s), gains);
+		__m128 hi = _mm_mul_ps(_mm_unpackhi_ps(s, s), gains);
+		_mm_storeu_ps(out + i * 2, _mm_add_ps(_mm_loadu_ps(out + i * 2), lo));
+		_mm_storeu_ps(out + i * 2 + 4, _mm_add_ps(_mm_loadu_ps(out + i * 2 + 4), hi));
+	}
+#endif
+
+	for (; i < frames; ++i) {
+		out[i * 2] += src[i] * gain_left;
+		out[i * 2 + 1] += src[i] * gain_right;
+	}
+}
+
+static void mix_stereo(const f32 *src, f32 *out, u32 frames, f32 gain_left, f32 gain_right) {
+	u32 i = 0;
+
+#ifdef MIXER_SSE
+	__m128 gains = _mm_setr_ps(gain_left, gain_right, gain_left, gain_right);
+
+	for (; i + 4 <= frames; i += 4) {
+		__m128 a = _mm_mul_ps(_mm_loadu_ps(src + i * 2), gains);
+		__m128 b = _mm_mul_ps(_mm_loadu_ps(src + i * 2 + 4), gains);
+		_mm_storeu_ps(out + i * 2, _mm_add_ps(_mm_loadu_ps(out + i * 2), a));
+		_mm_storeu_ps(out + i * 2 + 4, _mm_add_ps(_mm_loadu_ps(out + i * 2 + 4), b));
+	}
+#endif
+
+	for (; i < frames; ++i) {
+		out[i * 2] += src[i * 2] * gain_left;
+		out[i * 2 + 1] += src[i * 2 + 1] * gain_right;
+	}
+}
+
+static void mix_block(Mixer_Voice *voice, const f32 *src, f32 *out, u32 frames) {
+	if (voice->sound.channels == 1)
+		mix_mono(src, out, frames, voice->gain_left, voice->gain_right);
+	else
+		mix_stereo(src, out, frames, voice->gain_left, voice->gain_right);
+}
+
+// Returns false once a one-shot voice runs out.
+static bool voice_wrap(Mixer_Voice *voice) {
+	u64 end = (u64)voice->sound.frame_count << 32;
+	if (voice->position < end)
+		return true;
+
+	if (!voice->is_looping)
+		return false;
+
+	voice->position %= end;
+
+	return true;
+}
+
+static void mix_voice_direct(Mixer_Voice *voice, f32 *out, u32 frames) {
+	u32 channels = voice->sound.channels;
+
+	while (frames > 0) {
+		u32 index = voice->position >> 32;
+		u32 available = voice->sound.frame_count - index;
+		u32 n = frames < available ? frames : available;
+
+		mix_block(voice, voice->sound.samples + index * channels, out, n);
+
+		voice->position += (u64)n << 32;
+		out += n * 2;
+		frames -= n;
+
+		if (!voice_wrap(voice)) {
+			voice->is_playing = false;
+			return;
+		}
+	}
+}
+
+// Linear interpolation into a scratch buffer in the source layout, which is
+// then mixed with the same loops as the direct path.
+static void mix_voice_resampled(Mixer_Voice *voice, f32 *out, u32 frames) {
+	f32 scratch[RESAMPLE_BLOCK * 2];
+	u32 channels = voice->sound.channels;
+	u32 count = voice->sound.frame_count;
+	const f32 *samples = voice->sound.samples;
+
+	while (frames > 0) {
+		u32 n = frames < RESAMPLE_BLOCK ? frames : RESAMPLE_BLOCK;
+		u32 produced = 0;
+
+		for (; produced < n; ++produced) {
+			if (!voice_wrap(voice))
+				break;
+
+			u32 index = voice->position >> 32;
+			f32 t = (u32)voice->position * (1.f / FIXED_ONE);
+			u32 next = index + 1 < count ? index + 1 : (voice->is_looping ? 0 : index);
+
+			for (u32 c = 0; c < channels; ++c) {
+				f32 a = samples[index * channels + c];
+				f32 b = samples[next * channels + c];
+				scratch[produced * channels + c] = a + (b - a) * t;
+			}
+
+			voice->position += voice->step;
+		}
+
+		mix_block(voice, scratch, out, produced);
+
+		if (produced < n) {
+			voice->is_playing = false;
+			return;
+		}
+
+		out += n * 2;
+		frames -= n;
+	}
+}
+
+static void clamp_output(f32 *out, u32 samples) {
+	u32 i = 0;
+
+#ifdef MIXER_SSE
+	__m128 low = _mm_set1_ps(-1);
+	__m128 high = _mm_set1_ps(1);
+
+	for (; i + 4 <= samples; i += 4) {
+		_mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(out + i), low), high));
+	}
+#endif
+
+	for (; i < samples; ++i) {
+		out[i] = out[i] < -1 ? -1 : out[i] > 1 ? 1 : out[i];
+	}
+}
+
+// Runs on the output's thread with the output lock held.
+void mixer_render(f32 *out, u32 frames) {
+	commands_drain();
+	memset(out, 0, sizeof(f32) * frames * 2);
+
+	for (u32 i = 0; i < MAX_MIXER_VOICES; ++i) {
+		Mixer_Voice *voice = &state.voices[i];
+		if (!voice->is_playing)
+			continue;
+
+		if ((u32)SDL_AtomicGet(&state.stop_ids[i]) == voice->play_id) {
+			voice->is_playing = false;
+			SDL_AtomicSet(&state.finished_ids[i], voice->play_id);
+			continue;
+		}
+
+		if (voice->step == FIXED_ONE && (u32)voice->position == 0)
+			mix_voice_direct(voice, out, frames);
+		else
+			mix_voice_resampled(voice, out, frames);
+
+		if (!voice->is_playing)
+			SDL_AtomicSet(&state.finished_ids[i], voice->play_id);
+	}
+
+	if (state.stream)
+		state.stream(out, frames, state.stream_user_data);
+
+	clamp_output(out, frames * 2);
+}
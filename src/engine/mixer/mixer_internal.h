@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "../types.h"
+
+// Set up by mixer_init in mixer_output.c before any voice plays.
+void mixer_core_init(u32 sample_rate);
+// Held around stream changes while an output renders on another thread.
+void mixer_output_lock(void);
+void mixer_output_unlock(void);
+// False for the pumped outputs, which render on the thread calling mixer_update.
+bool mixer_output_is_threaded(void);
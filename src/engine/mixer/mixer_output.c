@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <SDL2/SDL.h>
+
+#include "../util.h"
+#include "../pack.h"
+#include "../mixer.h"
+#include "mixer_internal.h"
+
+// Null and WAV outputs render on the thread calling mixer_update, so their
+// lock is a no-op. The SDL output renders from the device callback.
+
+#define WAV_HEADER_SIZE 44
+// Behind by more than this, the pumped outputs drop the backlog.
+#define MAX_PUMP_SECONDS 1
+
+typedef struct mixer_output_state {
+	Mixer_Output output;
+	SDL_AudioDeviceID device;
+	FILE *wav;
+	f32 *block;
+	u32 block_frames;
+	u64 start_ticks;
+	u64 frames_rendered;
+	u64 frames_written;
+	bool is_initialized;
+} Mixer_Output_State;
+
+static Mixer_Output_State state;
+
+void mixer_output_lock(void) {
+	if (state.device)
+		SDL_LockAudioDevice(state.device);
+}
+
+void mixer_output_unlock(void) {
+	if (state.device)
+		SDL_UnlockAudioDevice(state.device);
+}
+
+bool mixer_output_is_threaded(void) {
+	return state.device != 0;
+}
+
+static void sdl_callback(void *user_data, u8 *stream, i32 len) {
+	mixer_render((f32*)stream, len / (sizeof(f32) * 2));
+}
+
+static void put_u16(u8 *ptr, u16 value) {
+	ptr[0] = value;
+	ptr[1] = value >> 8;
+}
+
+static void put_u32(u8 *ptr, u32 value) {
+	put_u16(ptr, value);
+	put_u16(ptr + 2, value >> 16);
+}
+
+// IEEE float stereo, sizes are patched in once the stream is closed.
+static void wav_header(u8 *header, u32 sample_rate, u64 frames) {
+	u32 data_size = frames * sizeof(f32) * 2;
+
+	memcpy(header, "RIFF", 4);
+	put_u32(header + 4, 36 + data_size);
+	memcpy(header + 8, "WAVEfmt ", 8);
+	put_u32(header + 16, 16);
+	put_u16(header + 20, 3);
+	put_u16(header + 22, 2);
+	put_u32(header + 24, sample_rate);
+	put_u32(header + 28, sample_rate * sizeof(f32) * 2);
+	put_u16(header + 32, sizeof(f32) * 2);
+	put_u16(header + 34, 32);
+	memcpy(header + 36, "data", 4);
+	put_u32(header + 40, data_size);
+}
+
+static bool open_sdl(u32 sample_rate, u32 block_frames) {
+	if (SDL_Init(SDL_INIT_AUDIO) != 0)
+		ERROR_RETURN(false, "Could not init SDL audio: %s\n", SDL_GetError());
+
+	SDL_AudioSpec want = {
+		.freq = sample_rate,
+		.format = AUDIO_F32SYS,
+		.channels = 2,
+		.samples = block_frames,
+		.callback = sdl_callback,
+	};
+	SDL_AudioSpec have;
+
+	// The device callback renders straight into SDL's buffer, so the format
+	// and channel count must match, only the rate may differ.
+	state.device = SDL_OpenAudioDevice(NULL, 0, &want, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+	if (!state.device)
+		ERROR_RETURN(false, "Could not open audio device: %s\n", SDL_GetError());
+
+	mixer_core_init(have.freq);
+	SDL_PauseAudioDevice(state.device, 0);
+
+	return true;
+}
+
+static bool open_wav(const char *path, u32 sample_rate) {
+	if (!path)
+		ERROR_RETURN(false, "Mixer WAV output needs a path\n");
+
+	state.wav = fopen(path, "wb");
+	if (!state.wav)
+		ERROR_RETURN(false, "Could not open mixer output: %s. errno: %d\n", path, errno);
+
+	u8 header[WAV_HEADER_SIZE];
+	wav_header(header, sample_rate, 0);
+	fwrite(header, 1, sizeof(header), state.wav);
+
+	return true;
+}
+
+bool mixer_init(Mixer_Output output, u32 sample_rate, u32 block_frames, const char *wav_path) {
+	if (state.is_initialized)
+		mixer_shutdown();
+
+	if (sample_rate == 0)
+		sample_rate = MIXER_DEFAULT_SAMPLE_RATE;
+	if (block_frames == 0)
+		block_frames = MIXER_DEFAULT_BLOCK_FRAMES;
+
+	state = (Mixer_Output_State){
+		.output = output,
+		.block_frames = block_frames,
+	};
+	mixer_core_init(sample_rate);
+
+	switch (output) {
+	case MIXER_OUTPUT_SDL:
+		if (!open_sdl(sample_rate, block_frames))
+			return false;
+		break;
+	case MIXER_OUTPUT_WAV:
+		if (!open_wav(wav_path, sample_rate))
+			return false;
+		// Fall through, the file output is pumped like the null one.
+	case MIXER_OUTPUT_NULL:
+		state.block = malloc(sizeof(f32) * 2 * block_frames);
+		if (!state.block) {
+			mixer_shutdown();
+			ERROR_RETURN(false, "Not enough memory for mixer block\n");
+		}
+		state.start_ticks = SDL_GetPerformanceCounter();
+		break;
+	}
+
+	state.is_initialized = true;
+
+	return true;
+}
+
+void mixer_shutdown(void) {
+	if (state.device) {
+		SDL_CloseAudioDevice(state.device);
+		state.device = 0;
+	}
+
+	if (state.wav) {
+		u8 header[WAV_HEADER_SIZE];
+		wav_header(header, mixer_sample_rate(), state.frames_written);
+		fseek(state.wav, 0, SEEK_SET);
+		fwrite(header, 1, sizeof(header), state.wav);
+		fclose(state.wav);
+		state.wav = NULL;
+	}
+
+	free(state.block);
+	state.block = NULL;
+	state.is_initialized = false;
+}
+
+void mixer_update(void) {
+	if (!state.block)
+		return;
+
+	// Read the counter directly so tools can use the mixer without the time module.
+	u64 rate = mixer_sample_rate();
+	u64 frequency = SDL_GetPerformanceFrequency();
+	u64 elapsed = SDL_GetPerformanceCounter() - state.start_ticks;
+	u64 due = elapsed / frequency * rate + elapsed % frequency * rate / frequency;
+
+	if (due - state.frames_rendered > rate * MAX_PUMP_SECONDS)
+		state.frames_rendered = due - rate * MAX_PUMP_SECONDS;
+
+	// Whole blocks only, the remainder goes out with the next update.
+	while (due - state.frames_rendered >= state.block_frames) {
+		mixer_render(state.block, state.block_frames);
+		state.frames_rendered += state.block_frames;
+
+		if (state.wav) {
+			fwrite(state.block, sizeof(f32) * 2, state.block_frames, state.wav);
+			state.frames_written += state.block_frames;
+		}
+	}
+}
+
+static bool sound_convert(Mixer_Sound *sound, const char *path, bool is_native) {
+	Pack_View view = pack_find(path);
+	SDL_RWops *rw = view.is_valid ? SDL_RWFromConstMem(view.data, (i32)view.len) : SDL_RWFromFile(path, "rb");
+
+	SDL_AudioSpec spec;
+	u8 *wav_data;
+	u32 wav_len;
+	if (!SDL_LoadWAV_RW(rw, 1, &spec, &wav_data, &wav_len))
+		ERROR_RETURN(false, "Failed to load WAV %s: %s\n", path, SDL_GetError());
+
+	u32 channels = is_native || spec.channels > 2 ? 2 : spec.channels;
+	u32 rate = is_native ? mixer_sample_rate() : (u32)spec.freq;
+
+	SDL_AudioCVT cvt;
+	if (SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq, AUDIO_F32SYS, channels, rate) < 0) {
+		SDL_FreeWAV(wav_data);
+		ERROR_RETURN(false, "Cannot convert WAV %s: %s\n", path, SDL_GetError());
+	}
+
+	cvt.len = wav_len;
+	cvt.buf = malloc((usize)wav_len * cvt.len_mult);
+	if (!cvt.buf) {
+		SDL_FreeWAV(wav_data);
+		ERROR_RETURN(false, "Not enough memory to convert WAV: %s\n", path);
+	}
+
+	memcpy(cvt.buf, wav_data, wav_len);
+	SDL_FreeWAV(wav_data);
+
+	if (SDL_ConvertAudio(&cvt) < 0) {
+		free(cvt.buf);
+		ERROR_RETURN(false, "Cannot convert WAV %s: %s\n", path, SDL_GetError());
+	}
+
+	*sound = (Mixer_Sound){
+		.samples = (f32*)cvt.buf,
+		.frame_count = cvt.len_cvt / (sizeof(f32) * channels),
+		.channels = channels,
+		.sample_rate = rate,
+	};
+
+	return true;
+}
+
+bool mixer_sound_load(Mixer_Sound *sound, const char *path) {
+	return sound_convert(sound, path, false);
+}
+
+bool mixer_sound_load_native(Mixer_Sound *sound, const char *path) {
+	return sound_convert(sound, path, true);
+}
+
+void mixer_sound_free(Mixer_Sound *sound) {
+	free((f32*)sound->samples);
+	*sound = (Mixer_Sound){0};
+}
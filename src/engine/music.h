@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "types.h"
+
+// Streams music into the engine mixer. A decode thread reads tracks through
+// io_stream (or straight from the mounted pack), converts them to the mixer's
+// format and fills a fixed ring of PCM blocks that the mixer drains on its
+// output thread. Memory use doesn't depend on track length and nothing is
+// decoded on the calling thread. Tracks must be WAV, PCM or float, or MP3,
+// which loops gaplessly when it has a LAME tag.
+
+#define MAX_MUSIC_PLAYLIST 16
+#define MAX_MUSIC_PATH 256
+#define MUSIC_BLOCK_FRAMES 1024
+#define MUSIC_RING_BLOCKS 8
+
+// Needs mixer_init first.
+void music_init(void);
+void music_shutdown(void);
+
+// Replaces the playlist and fades from whatever plays into its first track
+// over fade seconds. Tracks also crossfade into each other by fade, a track
+// followed by itself always loops gaplessly. A fade of 0 cuts immediately.
+void music_playlist(const char *const *paths, u32 count, bool is_looping, f32 fade);
+// Loops a single track.
+void music_play(const char *path, f32 fade);
+void music_next(f32 fade);
+void music_stop(f32 fade);
+// Applies to the next mixed block, independent of fades.
+void music_gain(f32 gain);
+bool music_is_playing(void);
+// Times the mixer found the ring empty while music was playing.
+u32 music_underruns(void);
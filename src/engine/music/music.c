@@ -0,0 +1,737 @@
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#define MP3_DECODE_IMPLEMENTATION
+#include <mp3_decode.h>
+
+#include "../util.h"
+#include "../io.h"
+#include "../pack.h"
+#include "../mixer.h"
+#include "../music.h"
+
+// The decode thread owns the decks and the playlist. Callers only post a
+// command under the mutex, and the mixer only touches the ring, so the output
+// thread never waits on anything.
+
+#define MUSIC_CHUNK_SIZE (32 * 1024)
+#define MUSIC_READ_AHEAD 4
+// How long the decode thread sleeps on a full ring before checking again.
+#define MUSIC_WAIT_MS 5
+#define MUSIC_DECK_COUNT 2
+// MP3 is refilled when less than this is buffered, so a whole frame and the
+// header after it are always there.
+#define MUSIC_MP3_KEEP (2 * MP3D_MAX_FRAME_BYTES)
+
+typedef struct music_block {
+	f32 samples[MUSIC_BLOCK_FRAMES * 2];
+	u32 generation;
+} Music_Block;
+
+typedef struct wav_format {
+	SDL_AudioFormat format;
+	u32 channels;
+	u32 sample_rate;
+	u32 block_align;
+	usize data_offset;
+	u64 data_size;
+} Wav_Format;
+
+typedef enum music_codec {
+	MUSIC_CODEC_WAV,
+	MUSIC_CODEC_MP3,
+} Music_Codec;
+
+typedef struct music_deck {
+	IO_Stream *stream;
+	// Used instead of stream when the track is in the mounted pack.
+	Pack_View packed;
+	usize packed_offset;
+	SDL_AudioStream *convert;
+	Music_Codec codec;
+	u8 chunk[MUSIC_CHUNK_SIZE + MUSIC_MP3_KEEP];
+	// WAV: PCM bytes not yet handed to convert.
+	u64 data_left;
+	// MP3: undecoded bytes are chunk[chunk_start, chunk_end).
+	usize chunk_start;
+	usize chunk_end;
+	mp3d mp3;
+	// Format of the first frame, frames that differ are dropped.
+	mp3d_frame_info mp3_format;
+	// Decoded samples per channel still to drop for the encoder's delay, and
+	// to play before its padding.
+	u64 skip;
+	u64 pcm_left;
+	bool is_eof;
+	// Output frames still to come, used to start crossfades on time.
+	u64 frames_left;
+	f32 gain;
+	f32 gain_target;
+	f32 gain_step;
+	u32 track;
+	bool is_active;
+	bool is_flushed;
+} Music_Deck;
+
+typedef struct music_command {
+	char paths[MAX_MUSIC_PLAYLIST][MAX_MUSIC_PATH];
+	u32 count;
+	f32 fade;
+	bool is_looping;
+	bool is_playlist;
+	bool is_next;
+	bool is_stop;
+} Music_Command;
+
+typedef struct music_state {
+	Music_Block ring[MUSIC_RING_BLOCKS];
+	// The mixer takes from head, the decode thread fills at tail.
+	SDL_atomic_t head;
+	SDL_atomic_t tail;
+	// Cuts bump the generation and the mixer skips older blocks, so they
+	// don't wait for the ring to drain.
+	SDL_atomic_t generation;
+	SDL_atomic_t underruns;
+	SDL_atomic_t is_playing;
+	// f32 bits.
+	SDL_atomic_t gain;
+	// Frames of the head block already mixed. Only the mixer touches it.
+	u32 read_offset;
+
+	Music_Deck decks[MUSIC_DECK_COUNT];
+	u32 current;
+	char playlist[MAX_MUSIC_PLAYLIST][MAX_MUSIC_PATH];
+	u32 track_count;
+	u32 fade_frames;
+	bool is_looping;
+	u32 sample_rate;
+
+	SDL_mutex *mutex;
+	SDL_cond *cond;
+	SDL_Thread *thread;
+	Music_Command command;
+	bool has_command;
+	bool is_quitting;
+} Music_State;
+
+static Music_State state;
+
+static u16 get_u16(const u8 *ptr) {
+	return ptr[0] | ptr[1] << 8;
+}
+
+static u32 get_u32(const u8 *ptr) {
+	return get_u16(ptr) | (u32)get_u16(ptr + 2) << 16;
+}
+
+static SDL_AudioFormat wav_sample_format(u16 tag, u16 bits) {
+	if (tag == 1 && bits == 8)
+		return AUDIO_U8;
+	if (tag == 1 && bits == 16)
+		return AUDIO_S16LSB;
+	if (tag == 1 && bits == 32)
+		return AUDIO_S32LSB;
+	if (tag == 3 && bits == 32)
+		return AUDIO_F32LSB;
+
+	return 0;
+}
+
+// The fmt and data headers must be within the first chunk read.
+static bool wav_parse(const u8 *data, usize len, Wav_Format *wav) {
+	if (len < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0)
+		return false;
+
+	bool has_format = false;
+
+	for (usize offset = 12; offset + 8 <= len; ) {
+		const u8 *chunk = data + offset;
+		u32 size = get_u32(chunk + 4);
+
+		if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16 && offset + 8 + size <= len) {
+			u16 tag = get_u16(chunk + 8);
+			// WAVE_FORMAT_EXTENSIBLE keeps the real tag at the start of the sub format GUID.
+			if (tag == 0xfffe && size >= 40)
+				tag = get_u16(chunk + 32);
+
+			wav->format = wav_sample_format(tag, get_u16(chunk + 22));
+			wav->channels = get_u16(chunk + 10);
+			wav->sample_rate = get_u32(chunk + 12);
+			wav->block_align = get_u16(chunk + 20);
+			has_format = wav->format && wav->channels > 0 && wav->sample_rate > 0 && wav->block_align > 0;
+		} else if (memcmp(chunk, "data", 4) == 0) {
+			wav->data_offset = offset + 8;
+			wav->data_size = size;
+			return has_format;
+		}
+
+		offset += 8 + size + (size & 1);
+	}
+
+	return false;
+}
+
+// ID3v2 tags go before the first MP3 frame, their size is syncsafe.
+static u64 id3_size(const u8 *data, usize len) {
+	if (len < 10 || memcmp(data, "ID3", 3) != 0)
+		return 0;
+
+	u64 size = 10 + ((u64)(data[6] & 0x7f) << 21 | (data[7] & 0x7f) << 14 | (data[8] & 0x7f) << 7 | (data[9] & 0x7f));
+
+	// Footer.
+	return data[5] & 0x10 ? size + 10 : size;
+}
+
+// Reads up to MUSIC_CHUNK_SIZE bytes into buffer.
+static usize deck_read(Music_Deck *deck, u8 *buffer) {
+	if (deck->stream)
+		return io_stream_read(deck->stream, buffer, MUSIC_CHUNK_SIZE);
+
+	usize n = deck->packed.len - deck->packed_offset;
+	if (n > MUSIC_CHUNK_SIZE)
+		n = MUSIC_CHUNK_SIZE;
+
+	memcpy(buffer, (u8*)deck->packed.data + deck->packed_offset, n);
+	deck->packed_offset += n;
+
+	return n;
+}
+
+// Drops what is buffered and continues reading at position.
+static void deck_seek(Music_Deck *deck, u64 position) {
+	if (deck->stream)
+		io_stream_seek(deck->stream, position);
+	else
+		deck->packed_offset = position < deck->packed.len ? position : deck->packed.len;
+
+	deck->chunk_start = 0;
+	deck->chunk_end = 0;
+}
+
+static void deck_refill(Music_Deck *deck) {
+	usize kept = deck->chunk_end - deck->chunk_start;
+	if (deck->is_eof || kept >= MUSIC_MP3_KEEP)
+		return;
+
+	memmove(deck->chunk, deck->chunk + deck->chunk_start, kept);
+	usize n = deck_read(deck, deck->chunk + kept);
+
+	deck->chunk_start = 0;
+	deck->chunk_end = kept + n;
+	deck->is_eof = n == 0;
+}
+
+static void deck_close(Music_Deck *deck) {
+	if (deck->stream)
+		io_stream_close(deck->stream);
+	if (deck->convert)
+		SDL_FreeAudioStream(deck->convert);
+
+	deck->stream = NULL;
+	deck->convert = NULL;
+	deck->is_active = false;
+}
+
+static void deck_fade(Music_Deck *deck, f32 target, u32 frames) {
+	deck->gain_target = target;
+	deck->gain_step = frames > 0 ? (target - deck->gain) / frames : target - deck->gain;
+}
+
+// Finds the first frame after len bytes were read into the chunk, and takes
+// the track's length and gapless trim from the Xing frame if there is one.
+static bool mp3_open(Music_Deck *deck, const char *path, usize len) {
+	// A WAV with samples wav_parse doesn't take.
+	if (len >= 4 && memcmp(deck->chunk, "RIFF", 4) == 0)
+		return false;
+
+	deck->chunk_start = 0;
+	deck->chunk_end = len;
+	deck->is_eof = len == 0;
+
+	u64 audio_start = id3_size(deck->chunk, len);
+	if (audio_start > len)
+		deck_seek(deck, audio_start);
+	else
+		deck->chunk_start = audio_start;
+
+	deck_refill(deck);
+
+	mp3d_frame_info *format = &deck->mp3_format;
+	usize available = deck->chunk_end - deck->chunk_start;
+	int offset = mp3d_find_frame(deck->chunk + deck->chunk_start, (int)available, format);
+	if (offset < 0 || (usize)(offset + format->frame_bytes) > available)
+		return false;
+
+	deck->chunk_start += offset;
+	audio_start += offset;
+
+	mp3d_init(&deck->mp3);
+	deck->skip = 0;
+	deck->pcm_left = UINT64_MAX;
+
+	mp3d_xing xing;
+	if (mp3d_read_xing(deck->chunk + deck->chunk_start, format, &xing)) {
+		deck->chunk_start += format->frame_bytes;
+		audio_start += format->frame_bytes;
+
+		// Only a LAME tag says what the encoder added.
+		if (xing.delay > 0 || xing.padding > 0)
+			deck->skip = xing.delay + MP3D_DECODER_DELAY;
+
+		u64 total = (u64)xing.frames * format->samples;
+		u64 added = xing.delay + xing.padding;
+		if (xing.frames > 0)
+			deck->pcm_left = total > added ? total - added : 0;
+	}
+
+	u64 samples = deck->pcm_left;
+
+	// Without a frame count, guess from the size as if the bitrate were
+	// constant.
+	if (samples == UINT64_MAX) {
+		File_Info info;
+		u64 size = deck->packed.is_valid ? deck->packed.len : io_file_info(path, &info) ? info.size : 0;
+		samples = size > audio_start ? (size - audio_start) / format->frame_bytes * format->samples : 0;
+	}
+
+	deck->frames_left = samples * state.sample_rate / format->sample_rate;
+
+	return true;
+}
+
+// Keeps the deck's gain, so a track can follow another without a click.
+static bool deck_open(Music_Deck *deck, u32 track) {
+	const char *path = state.playlist[track];
+
+	deck_close(deck);
+	deck->packed = pack_find(path);
+	deck->packed_offset = 0;
+
+	if (!deck->packed.is_valid) {
+		deck->stream = io_stream_open(path, MUSIC_CHUNK_SIZE, MUSIC_READ_AHEAD);
+		if (!deck->stream)
+			return false;
+	}
+
+	Wav_Format wav;
+	usize len = deck_read(deck, deck->chunk);
+
+	if (wav_parse(deck->chunk, len, &wav)) {
+		deck->codec = MUSIC_CODEC_WAV;
+		deck->convert = SDL_NewAudioStream(wav.format, wav.channels, wav.sample_rate, AUDIO_F32SYS, 2, state.sample_rate);
+	} else if (mp3_open(deck, path, len)) {
+		deck->codec = MUSIC_CODEC_MP3;
+		deck->convert = SDL_NewAudioStream(AUDIO_F32SYS, deck->mp3_format.channels, deck->mp3_format.sample_rate, AUDIO_F32SYS, 2, state.sample_rate);
+	} else {
+		deck_close(deck);
+		ERROR_RETURN(false, "Cannot stream music %s, only WAV (PCM or float) and MP3 are supported\n", path);
+	}
+
+	if (!deck->convert) {
+		deck_close(deck);
+		ERROR_RETURN(false, "Cannot convert music %s: %s\n", path, SDL_GetError());
+	}
+
+	// WAV data goes to convert as it is read.
+	if (deck->codec == MUSIC_CODEC_WAV) {
+		u64 first = len - wav.data_offset < wav.data_size ? len - wav.data_offset : wav.data_size;
+		SDL_AudioStreamPut(deck->convert, deck->chunk + wav.data_offset, (i32)first);
+
+		deck->data_left = wav.data_size - first;
+		deck->frames_left = wav.data_size / wav.block_align * state.sample_rate / wav.sample_rate;
+	}
+
+	deck->track = track;
+	deck->is_flushed = false;
+	deck->is_active = true;
+
+	return true;
+}
+
+// Hands the next chunk of PCM to convert. Returns false at the end.
+static bool wav_put(Music_Deck *deck) {
+	usize n = deck->data_left > 0 ? deck_read(deck, deck->chunk) : 0;
+	if (n == 0)
+		return false;
+
+	if (n > deck->data_left)
+		n = deck->data_left;
+
+	deck->data_left -= n;
+	SDL_AudioStreamPut(deck->convert, deck->chunk, (i32)n);
+
+	return true;
+}
+
+// Decodes the next frame into convert. Returns false at the end.
+static bool mp3_put(Music_Deck *deck) {
+	static f32 pcm[MP3D_MAX_SAMPLES_PER_FRAME];
+
+	if (deck->pcm_left == 0)
+		return false;
+
+	deck_refill(deck);
+
+	mp3d_frame_info info;
+	u64 samples = mp3d_decode_frame(&deck->mp3, deck->chunk + deck->chunk_start, (int)(deck->chunk_end - deck->chunk_start), pcm, &info);
+	deck->chunk_start += info.frame_bytes;
+
+	// Junk dropped. At least a frame is buffered until the end, so nothing to
+	// drop means nothing is left.
+	if (samples == 0)
+		return info.frame_bytes > 0;
+
+	if (info.channels != deck->mp3_format.channels || info.sample_rate != deck->mp3_format.sample_rate)
+		return true;
+
+	u64 skip = deck->skip < samples ? deck->skip : samples;
+	deck->skip -= skip;
+	samples -= skip;
+
+	if (samples > deck->pcm_left)
+		samples = deck->pcm_left;
+	deck->pcm_left -= samples;
+
+	SDL_AudioStreamPut(deck->convert, pcm + skip * info.channels, (i32)(samples * info.channels * sizeof(f32)));
+
+	return true;
+}
+
+// Converts up to frames of stereo into out, reading more of the track as needed.
+static u32 deck_pull(Music_Deck *deck, f32 *out, u32 frames) {
+	i32 wanted = frames * sizeof(f32) * 2;
+
+	while (SDL_AudioStreamAvailable(deck->convert) < wanted && !deck->is_flushed) {
+		bool is_more = deck->codec == MUSIC_CODEC_MP3 ? mp3_put(deck) : wav_put(deck);
+		if (!is_more) {
+			SDL_AudioStreamFlush(deck->convert);
+			deck->is_flushed = true;
+		}
+	}
+
+	i32 got = SDL_AudioStreamGet(deck->convert, out, wanted);
+
+	return got > 0 ? got / (sizeof(f32) * 2) : 0;
+}
+
+static u32 next_track(u32 track) {
+	if (track + 1 < state.track_count)
+		return track + 1;
+
+	return state.is_looping ? 0 : state.track_count;
+}
+
+static void cut(void) {
+	for (u32 i = 0; i < MUSIC_DECK_COUNT; ++i) {
+		deck_close(&state.decks[i]);
+	}
+
+	SDL_AtomicAdd(&state.generation, 1);
+	SDL_AtomicSet(&state.is_playing, 0);
+}
+
+static void start_track(u32 track, u32 fade_frames) {
+	Music_Deck *current = &state.decks[state.current];
+
+	if (fade_frames == 0 || !current->is_active) {
+		cut();
+		current->gain = 1;
+		deck_fade(current, 1, 0);
+		deck_open(current, track);
+		return;
+	}
+
+	state.current = (state.current + 1) % MUSIC_DECK_COUNT;
+	Music_Deck *next = &state.decks[state.current];
+
+	deck_fade(current, 0, fade_frames);
+	next->gain = 0;
+	deck_fade(next, 1, fade_frames);
+	deck_open(next, track);
+}
+
+static void command_apply(Music_Command *command) {
+	u32 fade_frames = command->fade > 0 ? (u32)(command->fade * state.sample_rate) : 0;
+	Music_Deck *current = &state.decks[state.current];
+
+	if (command->is_playlist) {
+		memcpy(state.playlist, command->paths, sizeof(state.playlist));
+		state.track_count = command->count;
+		state.is_looping = command->is_looping;
+		state.fade_frames = fade_frames;
+		start_track(0, fade_frames);
+	} else if (command->is_next && current->is_active && next_track(current->track) < state.track_count) {
+		start_track(next_track(current->track), fade_frames);
+	} else if (command->is_stop || command->is_next) {
+		state.track_count = 0;
+		if (fade_frames == 0) {
+			cut();
+		} else {
+			for (u32 i = 0; i < MUSIC_DECK_COUNT; ++i) {
+				deck_fade(&state.decks[i], 0, fade_frames);
+			}
+		}
+	}
+}
+
+static void mix_ramped(Music_Deck *deck, const f32 *src, f32 *out, u32 frames) {
+	for (u32 i = 0; i < frames; ++i) {
+		out[i * 2] += src[i * 2] * deck->gain;
+		out[i * 2 + 1] += src[i * 2 + 1] * deck->gain;
+
+		if (deck->gain != deck->gain_target) {
+			deck->gain += deck->gain_step;
+			if ((deck->gain_step > 0 && deck->gain > deck->gain_target)
+					|| (deck->gain_step < 0 && deck->gain < deck->gain_target))
+				deck->gain = deck->gain_target;
+		}
+	}
+}
+
+static void deck_decode(u32 index, f32 *out) {
+	static f32 scratch[MUSIC_BLOCK_FRAMES * 2];
+	Music_Deck *deck = &state.decks[index];
+	u32 done = 0;
+
+	while (done < MUSIC_BLOCK_FRAMES && deck->is_active) {
+		u32 wanted = MUSIC_BLOCK_FRAMES - done;
+		u32 n = deck_pull(deck, scratch, wanted);
+
+		mix_ramped(deck, scratch, out + done * 2, n);
+		done += n;
+		deck->frames_left = deck->frames_left > n ? deck->frames_left - n : 0;
+
+		if (n == wanted)
+			break;
+
+		// Out of samples. A deck that is fading out just ends, the current
+		// one moves on to the next track in place so there is no gap.
+		u32 track = next_track(deck->track);
+		deck_close(deck);
+
+		if (index == state.current && track < state.track_count)
+			deck_open(deck, track);
+	}
+
+	if (deck->is_active && deck->gain == 0 && deck->gain_target == 0)
+		deck_close(deck);
+}
+
+static void crossfade_check(void) {
+	Music_Deck *current = &state.decks[state.current];
+	Music_Deck *other = &state.decks[(state.current + 1) % MUSIC_DECK_COUNT];
+
+	if (state.fade_frames == 0 || !current->is_active || other->is_active || current->frames_left > state.fade_frames)
+		return;
+
+	u32 track = next_track(current->track);
+	if (track < state.track_count && track != current->track)
+		start_track(track, current->frames_left);
+}
+
+// Returns false when nothing is playing.
+static bool decode_block(void) {
+	bool is_active = false;
+	for (u32 i = 0; i < MUSIC_DECK_COUNT; ++i) {
+		is_active |= state.decks[i].is_active;
+	}
+
+	if (!is_active) {
+		SDL_AtomicSet(&state.is_playing, 0);
+		return false;
+	}
+
+	i32 tail = SDL_AtomicGet(&state.tail);
+	Music_Block *block = &state.ring[(u32)tail % MUSIC_RING_BLOCKS];
+
+	memset(block->samples, 0, sizeof(block->samples));
+	crossfade_check();
+
+	for (u32 i = 0; i < MUSIC_DECK_COUNT; ++i) {
+		deck_decode(i, block->samples);
+	}
+
+	block->generation = SDL_AtomicGet(&state.generation);
+	SDL_AtomicSet(&state.tail, tail + 1);
+	SDL_AtomicSet(&state.is_playing, 1);
+
+	return true;
+}
+
+static int decode_thread(void *data) {
+	SDL_LockMutex(state.mutex);
+
+	while (!state.is_quitting) {
+		if (state.has_command) {
+			Music_Command command = state.command;
+			state.has_command = false;
+
+			SDL_UnlockMutex(state.mutex);
+			command_apply(&command);
+			SDL_LockMutex(state.mutex);
+			continue;
+		}
+
+		// The mixer doesn't signal when it frees a block, poll while playing.
+		u32 queued = SDL_AtomicGet(&state.tail) - SDL_AtomicGet(&state.head);
+		if (queued == MUSIC_RING_BLOCKS) {
+			SDL_CondWaitTimeout(state.cond, state.mutex, MUSIC_WAIT_MS);
+			continue;
+		}
+
+		SDL_UnlockMutex(state.mutex);
+		bool is_playing = decode_block();
+		SDL_LockMutex(state.mutex);
+
+		if (!is_playing && !state.has_command && !state.is_quitting)
+			SDL_CondWait(state.cond, state.mutex);
+	}
+
+	SDL_UnlockMutex(state.mutex);
+
+	return 0;
+}
+
+static f32 gain_get(void) {
+	i32 bits = SDL_AtomicGet(&state.gain);
+	f32 gain;
+	memcpy(&gain, &bits, sizeof(gain));
+
+	return gain;
+}
+
+// Runs on the mixer's output thread.
+static void music_render(f32 *out, u32 frames, void *user_data) {
+	f32 gain = gain_get();
+
+	while (frames > 0) {
+		i32 head = SDL_AtomicGet(&state.head);
+		if (head == SDL_AtomicGet(&state.tail)) {
+			if (SDL_AtomicGet(&state.is_playing))
+				SDL_AtomicAdd(&state.underruns, 1);
+			return;
+		}
+
+		Music_Block *block = &state.ring[(u32)head % MUSIC_RING_BLOCKS];
+
+		if ((i32)(block->generation - SDL_AtomicGet(&state.generation)) < 0) {
+			state.read_offset = 0;
+			SDL_AtomicSet(&state.head, head + 1);
+			continue;
+		}
+
+		u32 n = MUSIC_BLOCK_FRAMES - state.read_offset;
+		if (n > frames)
+			n = frames;
+
+		const f32 *src = block->samples + state.read_offset * 2;
+		for (u32 i = 0; i < n * 2; ++i) {
+			out[i] += src[i] * gain;
+		}
+
+		out += n * 2;
+		frames -= n;
+		state.read_offset += n;
+
+		if (state.read_offset == MUSIC_BLOCK_FRAMES) {
+			state.read_offset = 0;
+			SDL_AtomicSet(&state.head, head + 1);
+		}
+	}
+}
+
+void music_init(void) {
+	state.sample_rate = mixer_sample_rate();
+	music_gain(1);
+
+	state.mutex = SDL_CreateMutex();
+	state.cond = SDL_CreateCond();
+	if (!state.mutex || !state.cond) {
+		ERROR_EXIT("Could not create music sync objects: %s\n", SDL_GetError());
+	}
+
+	state.thread = SDL_CreateThread(decode_thread, "music", NULL);
+	if (!state.thread) {
+		ERROR_EXIT("Could not create music thread: %s\n", SDL_GetError());
+	}
+
+	mixer_stream_set(music_render, NULL);
+}
+
+void music_shutdown(void) {
+	if (!state.thread) {
+		return;
+	}
+
+	mixer_stream_set(NULL, NULL);
+
+	SDL_LockMutex(state.mutex);
+	state.is_quitting = true;
+	SDL_CondSignal(state.cond);
+	SDL_UnlockMutex(state.mutex);
+
+	SDL_WaitThread(state.thread, NULL);
+	state.thread = NULL;
+
+	for (u32 i = 0; i < MUSIC_DECK_COUNT; ++i) {
+		deck_close(&state.decks[i]);
+	}
+}
+
+// The latest command wins if the decode thread hasn't taken the previous one.
+static void command_post(Music_Command *command) {
+	SDL_LockMutex(state.mutex);
+	state.command = *command;
+	state.has_command = true;
+	SDL_CondSignal(state.cond);
+	SDL_UnlockMutex(state.mutex);
+}
+
+void music_playlist(const char *const *paths, u32 count, bool is_looping, f32 fade) {
+	if (count == 0 || count > MAX_MUSIC_PLAYLIST)
+		ERROR_RETURN(, "Music playlist must have 1 to %d tracks, got %u\n", MAX_MUSIC_PLAYLIST, count);
+
+	Music_Command command = {
+		.count = count,
+		.fade = fade,
+		.is_looping = is_looping,
+		.is_playlist = true,
+	};
+
+	for (u32 i = 0; i < count; ++i) {
+		if (strlen(paths[i]) >= MAX_MUSIC_PATH)
+			ERROR_RETURN(, "Music path too long: %s\n", paths[i]);
+
+		strcpy(command.paths[i], paths[i]);
+	}
+
+	command_post(&command);
+}
+
+void music_play(const char *path, f32 fade) {
+	music_playlist(&path, 1, true, fade);
+}
+
+void music_next(f32 fade) {
+	Music_Command command = { .fade = fade, .is_next = true };
+	command_post(&command);
+}
+
+void music_stop(f32 fade) {
+	Music_Command command = { .fade = fade, .is_stop = true };
+	command_post(&command);
+}
+
+void music_gain(f32 gain) {
+	i32 bits;
+	memcpy(&bits, &gain, sizeof(bits));
+	SDL_AtomicSet(&state.gain, bits);
+}
+
+bool music_is_playing(void) {
+	return SDL_AtomicGet(&state.is_playing) != 0;
+}
+
+u32 music_underruns(void) {
+	return SDL_AtomicGet(&state.underruns);
+}
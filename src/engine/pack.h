@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdbool.h>
+#include "types.h"
+
+// Asset archive layout, all values little-endian:
+//
+//   Pack_Header
+//   Pack_Entry[table_size]   open-addressed hash table keyed by path hash
+//   names                    NUL-terminated paths, referenced by name_offset
+//   blobs                    each aligned to PACK_ALIGNMENT and followed by a 0 byte
+//
+// Paths are stored without a leading "./". Texture entries hold RGBA8 pixels
+// already flipped for OpenGL; raw entries hold the file as it was on disk.
+
+#define PACK_MAGIC 0x4b434150 // "PACK"
+#define PACK_VERSION 2
+#define PACK_ALIGNMENT 64
+
+typedef enum pack_entry_type {
+	PACK_ENTRY_EMPTY,
+	PACK_ENTRY_RAW,
+	PACK_ENTRY_TEXTURE,
+} Pack_Entry_Type;
+
+typedef struct pack_header {
+	u32 magic;
+	u32 version;
+	u32 entry_count;
+	u32 table_size;
+	u64 names_offset;
+	u64 names_size;
+} Pack_Header;
+
+typedef struct pack_entry {
+	u64 path_hash;
+	u64 offset;
+	u64 size;
+	u32 name_offset;
+	u32 type;
+	u32 width;
+	u32 height;
+	// hash_bytes of the stored data, so caches built from an entry can check
+	// it without reading it.
+	u64 data_hash;
+} Pack_Entry;
+
+typedef struct pack_view {
+	const u8 *data;
+	usize len;
+	u64 hash;
+	u32 width;
+	u32 height;
+	bool is_texture;
+	bool is_valid;
+} Pack_View;
+
+// Maps the archive read-only. Lookups fall through to loose files while no
+// archive is mounted, so a missing pack is not an error for callers.
+bool pack_mount(const char *path);
+void pack_unmount(void);
+bool pack_is_mounted(void);
+// Returns a view into the mapped archive. Valid until pack_unmount.
+Pack_View pack_find(const char *path);
+const char *pack_path_normalize(const char *path);
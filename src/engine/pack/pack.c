@@ -0,0 +1,131 @@
+#include <string.h>
+
+#include "../util.h"
+#include "../io.h"
+#include "../hash.h"
+#include "../pack.h"
+
+typedef struct pack_state {
+	File file;
+	u8 *data;
+	usize len;
+	const Pack_Header *header;
+	const Pack_Entry *table;
+	const char *names;
+} Pack_State;
+
+static Pack_State state;
+
+const char *pack_path_normalize(const char *path) {
+	while (path[0] == '.' && path[1] == '/') {
+		path += 2;
+	}
+
+	return path;
+}
+
+bool pack_mount(const char *path) {
+	if (state.data) {
+		pack_unmount();
+	}
+
+	if (!io_file_exists(path)) {
+		return false;
+	}
+
+	// Lookups jump around the archive, so don't bother with read-ahead.
+	state.file = io_file_map(path, IO_MAP_RANDOM);
+	if (!state.file.is_valid) {
+		return false;
+	}
+
+	state.data = (u8*)state.file.data;
+	state.len = state.file.len;
+
+	const Pack_Header *header = (const Pack_Header*)state.data;
+	usize table_end = sizeof(Pack_Header);
+
+	if (state.len >= sizeof(Pack_Header)) {
+		table_end += (usize)header->table_size * sizeof(Pack_Entry);
+	}
+
+	if (state.len < sizeof(Pack_Header)
+			|| header->magic != PACK_MAGIC
+			|| header->version != PACK_VERSION
+			|| (header->table_size & (header->table_size - 1)) != 0
+			|| table_end > state.len
+			|| header->names_offset > state.len
+			|| header->names_size > state.len - header->names_offset
+			|| (header->names_size > 0 && state.data[header->names_offset + header->names_size - 1] != 0)) {
+		pack_unmount();
+		ERROR_RETURN(false, "Invalid pack file: %s\n", path);
+	}
+
+	const Pack_Entry *table = (const Pack_Entry*)(state.data + sizeof(Pack_Header));
+
+	// With the names block NUL-terminated, any name_offset inside it bounds
+	// the strcmp in pack_find.
+	for (u32 i = 0; i < header->table_size; ++i) {
+		const Pack_Entry *entry = &table[i];
+		if (entry->type == PACK_ENTRY_EMPTY) {
+			continue;
+		}
+
+		if (entry->name_offset >= header->names_size
+				|| entry->offset > state.len
+				|| entry->size > state.len - entry->offset) {
+			pack_unmount();
+			ERROR_RETURN(false, "Invalid pack entry %u in: %s\n", i, path);
+		}
+	}
+
+	state.header = header;
+	state.table = table;
+	state.names = (const char*)(state.data + header->names_offset);
+
+	return true;
+}
+
+void pack_unmount(void) {
+	io_file_unmap(&state.file);
+	state = (Pack_State){0};
+}
+
+bool pack_is_mounted(void) {
+	return state.header != NULL;
+}
+
+Pack_View pack_find(const char *path) {
+	Pack_View view = { .is_valid = false };
+
+	if (!state.header || state.header->table_size == 0) {
+		return view;
+	}
+
+	path = pack_path_normalize(path);
+	u64 hash = hash_string(path);
+	u32 mask = state.header->table_size - 1;
+
+	for (u32 i = 0; i < state.header->table_size; ++i) {
+		const Pack_Entry *entry = &state.table[(hash + i) & mask];
+
+		if (entry->type == PACK_ENTRY_EMPTY) {
+			return view;
+		}
+
+		if (entry->path_hash != hash || strcmp(state.names + entry->name_offset, path) != 0) {
+			continue;
+		}
+
+		view.data = state.data + entry->offset;
+		view.len = entry->size;
+		view.width = entry->width;
+		view.height = entry->height;
+		view.hash = entry->data_hash;
+		view.is_texture = entry->type == PACK_ENTRY_TEXTURE;
+		view.is_valid = true;
+		return view;
+	}
+
+	return view;
+}
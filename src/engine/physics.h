@@ -42,7 +42,24 @@ struct hit {
 	bool is_hit;
 };
 
+#define PHYSICS_DEFAULT_GRAVITY -79
+#define PHYSICS_DEFAULT_TERMINAL_VELOCITY -7000
+#define PHYSICS_DEFAULT_ITERATIONS 4
+#define PHYSICS_MAX_ITERATIONS 64
+
+typedef struct physics_tunables {
+	f32 gravity;
+	f32 terminal_velocity;
+	u32 iterations;
+} Physics_Tunables;
+
 void physics_init(void);
+// Reads [physics] gravity, terminal_velocity and iterations. Safe to call
+// between physics_update calls.
+void physics_apply_config(void);
+Physics_Tunables physics_get_tunables(void);
+// Clamps iterations to 1..PHYSICS_MAX_ITERATIONS.
+void physics_set_tunables(Physics_Tunables tunables);
 void physics_update(void);
 usize physics_body_create(vec2 position, vec2 size, vec2 velocity, u8 collision_layer, u8 collision_mask, bool is_kinematic, On_Hit on_hit, On_Hit_Static on_hit_static, usize entity_id);
 usize physics_trigger_create(vec2 position, vec2 size, u8 collision_layer, u8 collision_mask, On_Hit on_hit);
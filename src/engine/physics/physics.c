@@ -2,12 +2,13 @@
 #include "../global.h"
 #include "../array_list.h"
 #include "../util.h"
+#include "../config.h"
 #include "../physics.h"
 #include "physics_internal.h"
 
 static Physics_State_Internal state;
 
-static u32 iterations = 4;
+static u32 iterations;
 static f32 tick_rate;
 
 void aabb_min_max(vec2 min, vec2 max, AABB aabb) {
@@ -110,9 +111,37 @@ void physics_init(void) {
 	state.body_list = array_list_create(sizeof(Body), 0);
 	state.static_body_list = array_list_create(sizeof(Static_Body), 0);
 
-	state.gravity = -79;
-	state.terminal_velocity = -7000;
+	physics_apply_config();
+}
+
+void physics_apply_config(void) {
+	physics_set_tunables((Physics_Tunables){
+		.gravity = config_get_float("physics", "gravity", PHYSICS_DEFAULT_GRAVITY),
+		.terminal_velocity = config_get_float("physics", "terminal_velocity", PHYSICS_DEFAULT_TERMINAL_VELOCITY),
+		.iterations = config_get_int("physics", "iterations", PHYSICS_DEFAULT_ITERATIONS),
+	});
+}
+
+Physics_Tunables physics_get_tunables(void) {
+	return (Physics_Tunables){
+		.gravity = state.gravity,
+		.terminal_velocity = state.terminal_velocity,
+		.iterations = iterations,
+	};
+}
+
+void physics_set_tunables(Physics_Tunables tunables) {
+	state.gravity = tunables.gravity;
+	state.terminal_velocity = tunables.terminal_velocity;
+
+	i32 new_iterations = (i32)tunables.iterations;
+	if (new_iterations < 1 || new_iterations > PHYSICS_MAX_ITERATIONS) {
+		fprintf(stderr, "Physics iterations must be between 1 and %d, got %d.\n", PHYSICS_MAX_ITERATIONS, new_iterations);
+		new_iterations = new_iterations < 1 ? 1 : PHYSICS_MAX_ITERATIONS;
+	}
 
+	// Always changed together, so a step never divides by a stale count.
+	iterations = new_iterations;
 	tick_rate = 1.f / iterations;
 }
 
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "types.h"
+
+// Frame profiler. Zones are timed with SDL_GetPerformanceCounter and recorded
+// into a per-thread ring, so instrumented code never takes a lock. The main
+// thread folds every ring into per-zone stats in profile_frame_end, and the
+// raw events can be written as a Chrome trace (chrome://tracing, Perfetto).
+//
+// Zone names must be string literals or otherwise outlive the profiler.
+// Build with -DPROFILE_DISABLE to compile the macros out.
+
+#define MAX_PROFILE_ZONES 64
+// Room for a full job pool next to the engine's other threads.
+#define MAX_PROFILE_THREADS 128
+#define MAX_PROFILE_DEPTH 32
+// Events kept per thread, must be a power of two.
+#define PROFILE_RING_SIZE 65536
+
+typedef struct profile_zone_stats {
+	const char *name;
+	// Milliseconds spent in the zone during the last completed frame, summed
+	// over all threads and calls.
+	f32 last_ms;
+	// Exponential moving average of last_ms.
+	f32 average_ms;
+	f32 max_ms;
+	u32 calls;
+} Profile_Zone_Stats;
+
+void profile_begin(const char *name);
+void profile_end(void);
+// Names the calling thread in exported traces.
+void profile_thread_name(const char *name);
+// Aggregates the events recorded since the previous call.
+void profile_frame_end(void);
+const Profile_Zone_Stats *profile_zones(usize *count);
+bool profile_trace_write(const char *path);
+
+static inline void profile_scope_end(int *unused) {
+	profile_end();
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#ifdef PROFILE_DISABLE
+#define PROFILE_BEGIN(name)
+#define PROFILE_END()
+#define PROFILE_SCOPE(name)
+#else
+#define PROFILE_BEGIN(name) profile_begin(name)
+#define PROFILE_END() profile_end()
+// Times from here to the end of the enclosing block.
+#define PROFILE_SCOPE(name) \
+	__attribute__((cleanup(profile_scope_end))) int PROFILE_CONCAT(profile_scope_, __LINE__) = (profile_begin(name), 0)
+#endif
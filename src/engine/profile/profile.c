@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "../util.h"
+#include "../io.h"
+#include "../profile.h"
+
+#define PROFILE_AVERAGE_WEIGHT 0.05f
+
+typedef struct profile_event {
+	const char *name;
+	u64 start;
+	u64 end;
+	u32 depth;
+} Profile_Event;
+
+// Written only by its own thread. head counts every event ever recorded and
+// is published after the event, so readers never see a half-written entry
+// unless the writer has lapped them.
+typedef struct profile_thread {
+	Profile_Event *events;
+	SDL_atomic_t head;
+	u32 written;
+	u32 aggregated;
+	const char *stack_name[MAX_PROFILE_DEPTH];
+	u64 stack_start[MAX_PROFILE_DEPTH];
+	u32 depth;
+	u32 id;
+	char name[32];
+} Profile_Thread;
+
+typedef struct profile_state {
+	Profile_Thread *threads[MAX_PROFILE_THREADS];
+	SDL_atomic_t thread_count;
+	SDL_SpinLock register_lock;
+	u64 epoch;
+	Profile_Zone_Stats zones[MAX_PROFILE_ZONES];
+	usize zone_count;
+} Profile_State;
+
+static Profile_State state;
+
+static _Thread_local Profile_Thread *current;
+static _Thread_local bool is_unavailable;
+
+static Profile_Thread *thread_register(void) {
+	if (is_unavailable)
+		return NULL;
+
+	is_unavailable = true;
+
+	Profile_Thread *thread = calloc(1, sizeof(Profile_Thread));
+	Profile_Event *events = malloc(sizeof(Profile_Event) * PROFILE_RING_SIZE);
+	if (!thread || !events) {
+		free(thread);
+		free(events);
+		ERROR_RETURN(NULL, "Not enough free memory for profiler thread buffer\n");
+	}
+	thread->events = events;
+
+	SDL_AtomicLock(&state.register_lock);
+
+	i32 index = SDL_AtomicGet(&state.thread_count);
+	if (index == MAX_PROFILE_THREADS) {
+		SDL_AtomicUnlock(&state.register_lock);
+		free(events);
+		free(thread);
+		ERROR_RETURN(NULL, "Too many profiled threads, max is %d\n", MAX_PROFILE_THREADS);
+	}
+
+	if (index == 0)
+		state.epoch = SDL_GetPerformanceCounter();
+
+	thread->id = index;
+	snprintf(thread->name, sizeof(thread->name), "thread %d", index);
+	state.threads[index] = thread;
+	SDL_AtomicSet(&state.thread_count, index + 1);
+
+	SDL_AtomicUnlock(&state.register_lock);
+
+	is_unavailable = false;
+	current = thread;
+
+	return thread;
+}
+
+void profile_begin(const char *name) {
+	Profile_Thread *thread = current ? current : thread_register();
+	if (!thread)
+		return;
+
+	if (thread->depth < MAX_PROFILE_DEPTH) {
+		thread->stack_name[thread->depth] = name;
+		thread->stack_start[thread->depth] = SDL_GetPerformanceCounter();
+	}
+	++thread->depth;
+}
+
+void profile_end(void) {
+	Profile_Thread *thread = current;
+	if (!thread || thread->depth == 0)
+		return;
+
+	--thread->depth;
+	if (thread->depth >= MAX_PROFILE_DEPTH)
+		return;
+
+	thread->events[thread->written & (PROFILE_RING_SIZE - 1)] = (Profile_Event){
+		.name = thread->stack_name[thread->depth],
+		.start = thread->stack_start[thread->depth],
+		.end = SDL_GetPerformanceCounter(),
+		.depth = thread->depth,
+	};
+	SDL_AtomicSet(&thread->head, ++thread->written);
+}
+
+void profile_thread_name(const char *name) {
+	Profile_Thread *thread = current ? current : thread_register();
+	if (!thread)
+		return;
+
+	snprintf(thread->name, sizeof(thread->name), "%s", name);
+}
+
+static usize zone_index(const char *name) {
+	for (usize i = 0; i < state.zone_count; ++i) {
+		if (state.zones[i].name == name || strcmp(state.zones[i].name, name) == 0)
+			return i;
+	}
+
+	if (state.zone_count == MAX_PROFILE_ZONES)
+		return MAX_PROFILE_ZONES;
+
+	state.zones[state.zone_count] = (Profile_Zone_Stats){ .name = name };
+
+	return state.zone_count++;
+}
+
+void profile_frame_end(void) {
+	u64 ticks[MAX_PROFILE_ZONES] = {0};
+	u32 calls[MAX_PROFILE_ZONES] = {0};
+
+	i32 thread_count = SDL_AtomicGet(&state.thread_count);
+
+	for (i32 i = 0; i < thread_count; ++i) {
+		Profile_Thread *thread = state.threads[i];
+		u32 head = SDL_AtomicGet(&thread->head);
+
+		if (head - thread->aggregated > PROFILE_RING_SIZE)
+			thread->aggregated = head - PROFILE_RING_SIZE;
+
+		for (; thread->aggregated != head; ++thread->aggregated) {
+			Profile_Event *event = &thread->events[thread->aggregated & (PROFILE_RING_SIZE - 1)];
+			usize index = zone_index(event->name);
+			if (index == MAX_PROFILE_ZONES)
+				continue;
+
+			ticks[index] += event->end - event->start;
+			++calls[index];
+		}
+	}
+
+	f64 to_ms = 1000.0 / SDL_GetPerformanceFrequency();
+
+	for (usize i = 0; i < state.zone_count; ++i) {
+		Profile_Zone_Stats *zone = &state.zones[i];
+		zone->last_ms = ticks[i] * to_ms;
+		zone->calls = calls[i];
+		zone->average_ms += (zone->last_ms - zone->average_ms) * PROFILE_AVERAGE_WEIGHT;
+		if (zone->last_ms > zone->max_ms)
+			zone->max_ms = zone->last_ms;
+	}
+}
+
+const Profile_Zone_Stats *profile_zones(usize *count) {
+	*count = state.zone_count;
+	return state.zones;
+}
+
+typedef struct trace_buffer {
+	char *data;
+	usize len;
+	usize capacity;
+	bool is_error;
+} Trace_Buffer;
+
+static void trace_append(Trace_Buffer *buffer, const char *format, ...) {
+	if (buffer->is_error)
+		return;
+
+	while (true) {
+		va_list args;
+		va_start(args, format);
+		i32 n = vsnprintf(buffer->data + buffer->len, buffer->capacity - buffer->len, format, args);
+		va_end(args);
+
+		if (n < 0) {
+			buffer->is_error = true;
+			return;
+		}
+
+		if (buffer->len + n < buffer->capacity) {
+			buffer->len += n;
+			return;
+		}
+
+		usize capacity = buffer->capacity * 2 + n;
+		char *data = realloc(buffer->data, capacity);
+		if (!data) {
+			buffer->is_error = true;
+			return;
+		}
+		buffer->data = data;
+		buffer->capacity = capacity;
+	}
+}
+
+// Zone names are expected to be identifiers, but keep the JSON valid anyway.
+static void trace_append_name(Trace_Buffer *buffer, const char *name) {
+	trace_append(buffer, "\"");
+	for (const char *c = name; *c; ++c) {
+		if (*c == '"' || *c == '\\')
+			trace_append(buffer, "\\%c", *c);
+		else if ((u8)*c >= 0x20)
+			trace_append(buffer, "%c", *c);
+	}
+	trace_append(buffer, "\"");
+}
+
+bool profile_trace_write(const char *path) {
+	Trace_Buffer buffer = { .data = malloc(4096), .capacity = 4096 };
+	if (!buffer.data)
+		ERROR_RETURN(false, "Not enough free memory to write trace\n");
+
+	f64 to_us = 1000000.0 / SDL_GetPerformanceFrequency();
+	bool is_first = true;
+
+	trace_append(&buffer, "{\"traceEvents\":[\n");
+
+	i32 thread_count = SDL_AtomicGet(&state.thread_count);
+
+	for (i32 i = 0; i < thread_count; ++i) {
+		Profile_Thread *thread = state.threads[i];
+
+		trace_append(&buffer, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":",
+				is_first ? "" : ",\n", thread->id);
+		trace_append_name(&buffer, thread->name);
+		trace_append(&buffer, "}}");
+		is_first = false;
+
+		u32 head = SDL_AtomicGet(&thread->head);
+		u32 first = head > PROFILE_RING_SIZE ? head - PROFILE_RING_SIZE : 0;
+
+		for (u32 j = first; j != head; ++j) {
+			Profile_Event event = thread->events[j & (PROFILE_RING_SIZE - 1)];
+
+			// Overwritten by the owning thread while we were reading.
+			if (SDL_AtomicGet(&thread->head) - j > PROFILE_RING_SIZE)
+				continue;
+
+			trace_append(&buffer, ",\n{\"name\":");
+			trace_append_name(&buffer, event.name);
+			trace_append(&buffer, ",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+					thread->id, (event.start - state.epoch) * to_us, (event.end - event.start) * to_us);
+		}
+	}
+
+	trace_append(&buffer, "\n]}\n");
+
+	bool is_written = !buffer.is_error && io_file_write(buffer.data, buffer.len, path) == 0;
+	free(buffer.data);
+
+	if (!is_written)
+		ERROR_RETURN(false, "Could not write trace: %s\n", path);
+
+	return true;
+}
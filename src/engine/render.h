@@ -20,12 +20,27 @@ typedef struct sprite_sheet {
 	f32 cell_width;
 	f32 cell_height;
 	u32 texture_id;
+	bool is_loaded;
 } Sprite_Sheet;
 
 #define MAX_BATCH_QUADS 10000
 #define MAX_BATCH_VERTICES 40000
 #define MAX_BATCH_ELEMENTS 60000
 
+#define SHADER_DEFAULT_VERT "./shaders/default.vert"
+#define SHADER_DEFAULT_FRAG "./shaders/default.frag"
+#define SHADER_BATCH_VERT "./shaders/batch_quad.vert"
+#define SHADER_BATCH_FRAG "./shaders/batch_quad.frag"
+
+// Bytes of texture data uploaded per frame while sprite sheets are loading.
+#define TEXTURE_UPLOAD_BUDGET (4 * 1024 * 1024)
+
+#define RENDER_DEFAULT_WINDOW_WIDTH 1920
+#define RENDER_DEFAULT_WINDOW_HEIGHT 1080
+#define RENDER_DEFAULT_SCALE 3
+
+// Window size and scale come from [render] window_width, window_height and
+// scale. The render resolution is the window size divided by scale.
 SDL_Window *render_init(void);
 void render_begin(void);
 void render_end(SDL_Window *window, u32 texture_ids[8]);
@@ -34,6 +49,21 @@ void render_quad_line(vec2 pos, vec2 size, vec4 color);
 void render_line_segment(vec2 start, vec2 end, vec4 color);
 void render_aabb(f32 *aabb, vec4 color);
 f32 render_get_scale();
+// Size of the render area in world units, tracks config reloads.
+void render_get_size(vec2 size);
+// Re-reads [render] config, resizes the window and updates the projection.
+void render_apply_config(void);
+// Keeps the current programs if the new sources fail to compile.
+void render_shaders_reload(void);
 
 void render_sprite_sheet_init(Sprite_Sheet *sprite_sheet, const char *path, f32 cell_width, f32 cell_height);
+// Queues the image for decoding on a worker thread. is_loaded is set once
+// render_textures_upload has sent it to the GPU.
+void render_sprite_sheet_load(Sprite_Sheet *sprite_sheet, const char *path, f32 cell_width, f32 cell_height);
+// Decodes the image again off-thread and re-uploads it into the existing
+// texture, so texture ids held elsewhere stay valid.
+void render_sprite_sheet_reload(Sprite_Sheet *sprite_sheet, const char *path);
+// Uploads decoded textures until byte_budget is spent (at least one per call).
+// Returns the number of loads still pending.
+usize render_textures_upload(usize byte_budget);
 void render_sprite_sheet_frame(Sprite_Sheet *sprite_sheet, f32 row, f32 column, vec2 position, bool is_flipped, vec4 color, u32 texture_slots[8]);
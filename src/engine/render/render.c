@@ -8,13 +8,17 @@
 #include "../render.h"
 #include "../array_list.h"
 #include "../util.h"
+#include "../config.h"
+#include "../profile.h"
 #include "render_internal.h"
 
-static f32 window_width = 1920;
-static f32 window_height = 1080;
-static f32 render_width = 640;
-static f32 render_height = 360;
-static f32 scale = 3;
+static f32 window_width;
+static f32 window_height;
+static f32 render_width;
+static f32 render_height;
+static f32 scale;
+
+static SDL_Window *window;
 
 static u32 vao_quad;
 static u32 vbo_quad;
@@ -29,8 +33,29 @@ static u32 ebo_batch;
 static u32 shader_batch;
 static Array_List *list_batch;
 
+static void read_config(void) {
+	i32 width = config_get_int("render", "window_width", RENDER_DEFAULT_WINDOW_WIDTH);
+	i32 height = config_get_int("render", "window_height", RENDER_DEFAULT_WINDOW_HEIGHT);
+	f32 new_scale = config_get_float("render", "scale", RENDER_DEFAULT_SCALE);
+
+	if (width < 1 || height < 1 || new_scale <= 0) {
+		fprintf(stderr, "Invalid render config %dx%d scale %g, using defaults.\n", width, height, new_scale);
+		width = RENDER_DEFAULT_WINDOW_WIDTH;
+		height = RENDER_DEFAULT_WINDOW_HEIGHT;
+		new_scale = RENDER_DEFAULT_SCALE;
+	}
+
+	window_width = width;
+	window_height = height;
+	scale = new_scale;
+	render_width = window_width / scale;
+	render_height = window_height / scale;
+}
+
 SDL_Window *render_init(void) {
-	SDL_Window *window = render_init_window(window_width, window_height);
+	read_config();
+
+	window = render_init_window(window_width, window_height);
 
 	render_init_quad(&vao_quad, &vbo_quad, &ebo_quad);
 	render_init_batch_quads(&vao_batch, &vbo_batch, &ebo_batch);
@@ -45,6 +70,8 @@ SDL_Window *render_init(void) {
 
 	stbi_set_flip_vertically_on_load(1);
 
+	render_loader_init();
+
 	return window;
 }
 
@@ -136,9 +163,13 @@ static void append_quad(vec2 position, vec2 size, vec4 texture_coordinates, vec4
 }
 
 void render_end(SDL_Window *window, u32 batch_texture_ids[8]) {
+	PROFILE_BEGIN("gl_submit");
 	render_batch(list_batch->items, list_batch->len, batch_texture_ids);
+	PROFILE_END();
 
+	PROFILE_BEGIN("swap");
 	SDL_GL_SwapWindow(window);
+	PROFILE_END();
 }
 
 void render_quad(vec2 pos, vec2 size, vec4 color) {
@@ -209,28 +240,52 @@ f32 render_get_scale() {
 	return scale;
 }
 
+void render_get_size(vec2 size) {
+	size[0] = render_width;
+	size[1] = render_height;
+}
+
+void render_apply_config(void) {
+	read_config();
+
+	SDL_SetWindowSize(window, window_width, window_height);
+	glViewport(0, 0, window_width, window_height);
+	render_init_shader_uniforms(shader_default, shader_batch, render_width, render_height);
+}
+
+void render_shaders_reload(void) {
+	u32 default_program = render_shader_load(SHADER_DEFAULT_VERT, SHADER_DEFAULT_FRAG);
+	u32 batch_program = render_shader_load(SHADER_BATCH_VERT, SHADER_BATCH_FRAG);
+
+	if (!default_program || !batch_program) {
+		glDeleteProgram(default_program);
+		glDeleteProgram(batch_program);
+		ERROR_RETURN(, "Shader reload failed, keeping previous shaders\n");
+	}
+
+	glDeleteProgram(shader_default);
+	glDeleteProgram(shader_batch);
+	shader_default = default_program;
+	shader_batch = batch_program;
+
+	render_init_shader_uniforms(shader_default, shader_batch, render_width, render_height);
+}
+
 void render_sprite_sheet_init(Sprite_Sheet *sprite_sheet, const char *path, f32 cell_width, f32 cell_height) {
-	glGenTextures(1, &sprite_sheet->texture_id);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, sprite_sheet->texture_id);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-	int width, height, channel_count;
-	u8 *image_data = stbi_load(path, &width, &height, &channel_count, 0);
-	if (!image_data) {
+	sprite_sheet->texture_id = 0;
+
+	Image image = render_image_load(path);
+	if (!image.data) {
 		ERROR_EXIT("Failed to load image: %s\n", path);
 	}
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data);
-	stbi_image_free(image_data);
+	render_texture_create(&sprite_sheet->texture_id, &image);
 
-	sprite_sheet->width = (f32)width;
-	sprite_sheet->height = (f32)height;
+	sprite_sheet->width = (f32)image.width;
+	sprite_sheet->height = (f32)image.height;
+	render_image_free(&image);
 	sprite_sheet->cell_width = cell_width;
 	sprite_sheet->cell_height = cell_height;
+	sprite_sheet->is_loaded = true;
 }
 
 static void calculate_sprite_texture_coordinates(vec4 result, f32 row, f32 column, f32 texture_width, f32 texture_height, f32 cell_width, f32 cell_height) {
@@ -245,6 +300,11 @@ static void calculate_sprite_texture_coordinates(vec4 result, f32 row, f32 colum
 }
 
 void render_sprite_sheet_frame(Sprite_Sheet *sprite_sheet, f32 row, f32 column, vec2 position, bool is_flipped, vec4 color, u32 texture_slots[8]) {
+	// Still decoding, draw nothing until the texture is uploaded.
+	if (!sprite_sheet->is_loaded) {
+		return;
+	}
+
 	vec4 uvs;
 	calculate_sprite_texture_coordinates(uvs, row, column, sprite_sheet->width, sprite_sheet->height, sprite_sheet->cell_width, sprite_sheet->cell_height);
 
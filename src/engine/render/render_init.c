@@ -43,23 +43,27 @@ SDL_Window *render_init_window(u32 width, u32 height) {
 }
 
 void render_init_shaders(u32 *shader_default, u32 *shader_batch, f32 render_width, f32 render_height) {
-	mat4x4 projection;
-	*shader_default = render_shader_create("./shaders/default.vert", "./shaders/default.frag");
-	*shader_batch = render_shader_create("./shaders/batch_quad.vert", "./shaders/batch_quad.frag");
+	*shader_default = render_shader_create(SHADER_DEFAULT_VERT, SHADER_DEFAULT_FRAG);
+	*shader_batch = render_shader_create(SHADER_BATCH_VERT, SHADER_BATCH_FRAG);
+
+	render_init_shader_uniforms(*shader_default, *shader_batch, render_width, render_height);
+}
 
+void render_init_shader_uniforms(u32 shader_default, u32 shader_batch, f32 render_width, f32 render_height) {
+	mat4x4 projection;
 	mat4x4_ortho(projection, 0, render_width, 0, render_height, -2, 2);
 
-	glUseProgram(*shader_default);
+	glUseProgram(shader_default);
 	glUniformMatrix4fv(
-		glGetUniformLocation(*shader_default, "projection"),
+		glGetUniformLocation(shader_default, "projection"),
 		1,
 		GL_FALSE,
 		&projection[0][0]
 	);
 
-	glUseProgram(*shader_batch);
+	glUseProgram(shader_batch);
 	glUniformMatrix4fv(
-		glGetUniformLocation(*shader_batch, "projection"),
+		glGetUniformLocation(shader_batch, "projection"),
 		1,
 		GL_FALSE,
 		&projection[0][0]
@@ -68,7 +72,7 @@ void render_init_shaders(u32 *shader_default, u32 *shader_batch, f32 render_widt
     for (u32 i = 0; i < 8; ++i) {
         char name[] = "texture_slot_N";
         sprintf(name, "texture_slot_%u", i);
-        glUniform1i(glGetUniformLocation(*shader_batch, name), i);
+        glUniform1i(glGetUniformLocation(shader_batch, name), i);
     }
 }
 
@@ -3,13 +3,33 @@
 #include <SDL2/SDL.h>
 
 #include "../types.h"
+#include "../io.h"
 #include "../render.h"
 
+// RGBA8 pixels with mip_count levels stored back to back, largest first.
+// Images backed by a cache file keep the mapping alive until freed.
+typedef struct image {
+	u8 *data;
+	i32 width;
+	i32 height;
+	u32 mip_count;
+	File mapping;
+	bool is_owned;
+} Image;
+
 SDL_Window *render_init_window(u32 width, u32 height);
 void render_init_quad(u32 *vao, u32 *vbo, u32 *ebo);
 void render_init_color_texture(u32 *texture);
 void render_init_shaders(u32 *shader_default, u32 *shader_batch, f32 render_width, f32 render_height);
+void render_init_shader_uniforms(u32 shader_default, u32 shader_batch, f32 render_width, f32 render_height);
 void render_init_batch_quads(u32 *vao, u32 *vbo, u32 *ebo);
 void render_init_line(u32 *vao, u32 *vbo);
 u32 render_shader_create(const char *path_vert, const char *path_frag);
+u32 render_shader_load(const char *path_vert, const char *path_frag);
 
+void render_loader_init(void);
+void render_texture_create(u32 *texture_id, Image *image);
+Image render_image_load(const char *path);
+void render_image_free(Image *image);
+bool render_texture_cache_load(const char *path, Image *image);
+void render_texture_cache_store(const char *path, Image *image, u64 source_hash);
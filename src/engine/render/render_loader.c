@@ -0,0 +1,241 @@
+#include <glad/glad.h>
+#include <SDL2/SDL.h>
+#include <stb_image.h>
+
+#include "../util.h"
+#include "../io.h"
+#include "../hash.h"
+#include "../pack.h"
+#include "../profile.h"
+#include "../job.h"
+#include "../render.h"
+#include "render_internal.h"
+
+// Sprite sheets are decoded by jobs on the shared pool and uploaded to the
+// GPU on the render thread, a few per frame, by render_textures_upload.
+
+#define MAX_TEXTURE_LOADS 64
+
+typedef enum texture_load_state {
+	TEXTURE_LOAD_FREE,
+	TEXTURE_LOAD_QUEUED,
+	TEXTURE_LOAD_DECODING,
+	TEXTURE_LOAD_DECODED,
+	TEXTURE_LOAD_FAILED,
+} Texture_Load_State;
+
+typedef struct texture_load {
+	Sprite_Sheet *sprite_sheet;
+	char path[256];
+	Image image;
+	Texture_Load_State state;
+	bool is_reload;
+} Texture_Load;
+
+static Texture_Load loads[MAX_TEXTURE_LOADS];
+static usize pending_count;
+static SDL_mutex *mutex;
+
+static void decode_job(void *data) {
+	Texture_Load *load = data;
+
+	SDL_LockMutex(mutex);
+	load->state = TEXTURE_LOAD_DECODING;
+	SDL_UnlockMutex(mutex);
+
+	PROFILE_BEGIN("texture_decode");
+	Image image = render_image_load(load->path);
+	PROFILE_END();
+
+	SDL_LockMutex(mutex);
+	load->image = image;
+	load->state = image.data ? TEXTURE_LOAD_DECODED : TEXTURE_LOAD_FAILED;
+	SDL_UnlockMutex(mutex);
+}
+
+void render_loader_init(void) {
+	mutex = SDL_CreateMutex();
+	if (!mutex) {
+		ERROR_EXIT("Could not create texture loader lock: %s\n", SDL_GetError());
+	}
+}
+
+// Pre-decoded pack entries and cached textures are used in place. Anything
+// else is decoded to RGBA so the upload format always matches the data, and
+// loose files are written to the texture cache for next time.
+Image render_image_load(const char *path) {
+	Image image = { .mip_count = 1 };
+	i32 channel_count;
+	Pack_View view = pack_find(path);
+
+	if (view.is_valid && view.is_texture) {
+		image.data = (u8*)view.data;
+		image.width = view.width;
+		image.height = view.height;
+	} else if (view.is_valid) {
+		image.data = stbi_load_from_memory(view.data, (i32)view.len, &image.width, &image.height, &channel_count, 4);
+		image.is_owned = true;
+	} else if (!render_texture_cache_load(path, &image)) {
+		File source = io_file_map(path, IO_MAP_SEQUENTIAL);
+		if (!source.is_valid) {
+			return image;
+		}
+
+		image.data = stbi_load_from_memory((u8*)source.data, (i32)source.len, &image.width, &image.height, &channel_count, 4);
+		image.is_owned = true;
+
+		if (image.data) {
+			render_texture_cache_store(path, &image, hash_bytes(source.data, source.len));
+		}
+
+		io_file_unmap(&source);
+	}
+
+	return image;
+}
+
+void render_image_free(Image *image) {
+	if (image->mapping.is_valid) {
+		io_file_unmap(&image->mapping);
+	} else if (image->is_owned) {
+		stbi_image_free(image->data);
+	}
+
+	image->data = NULL;
+}
+
+// Re-uploads into *texture_id when it already names a texture.
+void render_texture_create(u32 *texture_id, Image *image) {
+	if (*texture_id == 0) {
+		glGenTextures(1, texture_id);
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, *texture_id);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image->mip_count - 1);
+
+	u8 *level_data = image->data;
+	i32 width = image->width;
+	i32 height = image->height;
+
+	for (u32 level = 0; level < image->mip_count; ++level) {
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, level_data);
+
+		level_data += (usize)width * height * 4;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+}
+
+static void queue_load(Sprite_Sheet *sprite_sheet, const char *path, bool is_reload) {
+	if (strlen(path) >= sizeof(loads[0].path)) {
+		ERROR_EXIT("Sprite sheet path too long: %s\n", path);
+	}
+
+	SDL_LockMutex(mutex);
+
+	Texture_Load *load = NULL;
+	for (usize i = 0; i < MAX_TEXTURE_LOADS; ++i) {
+		if (loads[i].state == TEXTURE_LOAD_FREE) {
+			load = &loads[i];
+			break;
+		}
+	}
+
+	if (!load) {
+		SDL_UnlockMutex(mutex);
+		ERROR_EXIT("Too many pending texture loads, max is %d\n", MAX_TEXTURE_LOADS);
+	}
+
+	*load = (Texture_Load){
+		.sprite_sheet = sprite_sheet,
+		.state = TEXTURE_LOAD_QUEUED,
+		.is_reload = is_reload,
+	};
+	strcpy(load->path, path);
+	++pending_count;
+
+	SDL_UnlockMutex(mutex);
+
+	job_run(decode_job, load, NULL);
+}
+
+void render_sprite_sheet_load(Sprite_Sheet *sprite_sheet, const char *path, f32 cell_width, f32 cell_height) {
+	*sprite_sheet = (Sprite_Sheet){
+		.cell_width = cell_width,
+		.cell_height = cell_height,
+	};
+
+	queue_load(sprite_sheet, path, false);
+}
+
+void render_sprite_sheet_reload(Sprite_Sheet *sprite_sheet, const char *path) {
+	queue_load(sprite_sheet, path, true);
+}
+
+usize render_textures_upload(usize byte_budget) {
+	if (pending_count == 0) {
+		return 0;
+	}
+
+	// Without workers nobody else will decode.
+	if (job_thread_count() <= 1) {
+		job_run_one();
+	}
+
+	usize bytes_uploaded = 0;
+
+	for (usize i = 0; i < MAX_TEXTURE_LOADS; ++i) {
+		Texture_Load *load = &loads[i];
+
+		SDL_LockMutex(mutex);
+		Texture_Load_State state = load->state;
+		SDL_UnlockMutex(mutex);
+
+		// A broken file saved mid-edit shouldn't take the game down.
+		if (state == TEXTURE_LOAD_FAILED && load->is_reload) {
+			fprintf(stderr, "Failed to reload image: %s\n", load->path);
+			SDL_LockMutex(mutex);
+			load->state = TEXTURE_LOAD_FREE;
+			--pending_count;
+			SDL_UnlockMutex(mutex);
+			continue;
+		}
+
+		if (state == TEXTURE_LOAD_FAILED) {
+			ERROR_EXIT("Failed to load image: %s\n", load->path);
+		}
+
+		if (state != TEXTURE_LOAD_DECODED) {
+			continue;
+		}
+
+		// Always upload at least one texture per call so large images can't stall forever.
+		usize size = (usize)load->image.width * load->image.height * 4;
+		if (bytes_uploaded > 0 && bytes_uploaded + size > byte_budget) {
+			break;
+		}
+
+		Sprite_Sheet *sprite_sheet = load->sprite_sheet;
+		render_texture_create(&sprite_sheet->texture_id, &load->image);
+
+		sprite_sheet->width = (f32)load->image.width;
+		sprite_sheet->height = (f32)load->image.height;
+		render_image_free(&load->image);
+		sprite_sheet->is_loaded = true;
+
+		bytes_uploaded += size;
+
+		SDL_LockMutex(mutex);
+		load->state = TEXTURE_LOAD_FREE;
+		--pending_count;
+		SDL_UnlockMutex(mutex);
+	}
+
+	return pending_count;
+}
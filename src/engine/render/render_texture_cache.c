@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "../util.h"
+#include "../io.h"
+#include "../hash.h"
+#include "render_internal.h"
+
+// Decoded sprite sheets are cached as raw RGBA8, already flipped for OpenGL,
+// so later runs map the cache file and hand it straight to glTexImage2D.
+//
+// An entry is reused when the source's size and mtime match. If only the mtime
+// changed (checkout, copy) the source contents are hashed and compared before
+// falling back to a decode. A match records the new mtime in the entry.
+
+#define TEXTURE_CACHE_DIR ".cache"
+#define TEXTURE_CACHE_TEXTURE_DIR TEXTURE_CACHE_DIR "/textures"
+#define TEXTURE_CACHE_MAGIC 0x58455443 // "CTEX"
+#define TEXTURE_CACHE_VERSION 1
+
+// Followed by mip_count levels of RGBA8, largest first.
+typedef struct texture_cache_header {
+	u32 magic;
+	u32 version;
+	u64 path_hash;
+	u64 source_size;
+	i64 source_modified;
+	u64 source_hash;
+	u32 width;
+	u32 height;
+	u32 mip_count;
+	u32 padding;
+} Texture_Cache_Header;
+
+static void cache_path(char *buffer, usize size, const char *path) {
+	snprintf(buffer, size, TEXTURE_CACHE_TEXTURE_DIR "/%016llx.tex", (unsigned long long)hash_string(path));
+}
+
+static usize mip_chain_size(u32 width, u32 height, u32 mip_count) {
+	usize size = 0;
+
+	for (u32 i = 0; i < mip_count; ++i) {
+		size += (usize)width * height * 4;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+
+	return size;
+}
+
+static bool header_is_valid(File *file, const char *path) {
+	if (file->len < sizeof(Texture_Cache_Header))
+		return false;
+
+	Texture_Cache_Header *header = (Texture_Cache_Header*)file->data;
+
+	return header->magic == TEXTURE_CACHE_MAGIC
+		&& header->version == TEXTURE_CACHE_VERSION
+		&& header->path_hash == hash_string(path)
+		&& header->mip_count > 0
+		&& file->len >= sizeof(Texture_Cache_Header) + mip_chain_size(header->width, header->height, header->mip_count);
+}
+
+bool render_texture_cache_load(const char *path, Image *image) {
+	File_Info info;
+	if (!io_file_info(path, &info))
+		return false;
+
+	char buffer[64];
+	cache_path(buffer, sizeof(buffer), path);
+	if (!io_file_exists(buffer))
+		return false;
+
+	File file = io_file_map(buffer, IO_MAP_SEQUENTIAL);
+	if (!file.is_valid)
+		return false;
+
+	if (!header_is_valid(&file, path)) {
+		io_file_unmap(&file);
+		return false;
+	}
+
+	Texture_Cache_Header *header = (Texture_Cache_Header*)file.data;
+
+	if (header->source_size != info.size) {
+		io_file_unmap(&file);
+		return false;
+	}
+
+	if (header->source_modified != info.modified) {
+		File source = io_file_map(path, IO_MAP_SEQUENTIAL);
+		bool is_same = source.is_valid && hash_bytes(source.data, source.len) == header->source_hash;
+		io_file_unmap(&source);
+
+		if (!is_same) {
+			io_file_unmap(&file);
+			return false;
+		}
+
+		// Only touched, so later runs can skip the hash again.
+		io_file_patch(buffer, offsetof(Texture_Cache_Header, source_modified), &info.modified, sizeof(info.modified));
+	}
+
+	*image = (Image){
+		.data = (u8*)file.data + sizeof(Texture_Cache_Header),
+		.width = header->width,
+		.height = header->height,
+		.mip_count = header->mip_count,
+		.mapping = file,
+	};
+
+	return true;
+}
+
+void render_texture_cache_store(const char *path, Image *image, u64 source_hash) {
+	File_Info info;
+	if (!io_file_info(path, &info))
+		return;
+
+	if (!io_dir_create(TEXTURE_CACHE_DIR) || !io_dir_create(TEXTURE_CACHE_TEXTURE_DIR))
+		return;
+
+	usize data_size = mip_chain_size(image->width, image->height, image->mip_count);
+	usize size = sizeof(Texture_Cache_Header) + data_size;
+	u8 *buffer = malloc(size);
+	if (!buffer)
+		ERROR_RETURN(, "Not enough memory to cache texture: %s\n", path);
+
+	*(Texture_Cache_Header*)buffer = (Texture_Cache_Header){
+		.magic = TEXTURE_CACHE_MAGIC,
+		.version = TEXTURE_CACHE_VERSION,
+		.path_hash = hash_string(path),
+		.source_size = info.size,
+		.source_modified = info.modified,
+		.source_hash = source_hash,
+		.width = image->width,
+		.height = image->height,
+		.mip_count = image->mip_count,
+	};
+	memcpy(buffer + sizeof(Texture_Cache_Header), image->data, data_size);
+
+	char cache_file[64];
+	cache_path(cache_file, sizeof(cache_file), path);
+	io_file_write(buffer, size, cache_file);
+
+	free(buffer);
+}
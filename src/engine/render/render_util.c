@@ -3,53 +3,85 @@
 
 #include "../util.h"
 #include "../io.h"
+#include "../pack.h"
 #include "render_internal.h"
 
-u32 render_shader_create(const char *path_vert, const char *path_frag) {
+// Shader sources come from the mounted pack when present, otherwise from disk.
+static File shader_source_read(const char *path, bool *is_owned) {
+	Pack_View view = pack_find(path);
+	*is_owned = !view.is_valid;
+
+	if (view.is_valid) {
+		return (File){ .data = (char*)view.data, .len = view.len, .is_valid = true };
+	}
+
+	return io_file_map(path, IO_MAP_SEQUENTIAL);
+}
+
+static u32 shader_compile(GLenum type, const char *path) {
 	int success;
 	char log[512];
+	bool is_owned;
 
-	File file_vertex = io_file_read(path_vert);
-	if (!file_vertex.is_valid) {
-		ERROR_EXIT("Error reading shader: %s\n", path_vert);
+	File file = shader_source_read(path, &is_owned);
+	if (!file.is_valid) {
+		ERROR_RETURN(0, "Error reading shader: %s\n", path);
 	}
 
-	u32 shader_vertex = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(shader_vertex, 1, (const char *const *)&file_vertex, NULL);
-	glCompileShader(shader_vertex);
-	glGetShaderiv(shader_vertex, GL_COMPILE_STATUS, &success);
+	u32 shader = glCreateShader(type);
+	i32 len = (i32)file.len;
+	glShaderSource(shader, 1, (const char *const *)&file.data, &len);
+	glCompileShader(shader);
+
+	if (is_owned)
+		io_file_unmap(&file);
+
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
 	if (!success) {
-		glGetShaderInfoLog(shader_vertex, 512, NULL, log);
-		ERROR_EXIT("Error compiling vertex shader. %s\n", log);
+		glGetShaderInfoLog(shader, 512, NULL, log);
+		glDeleteShader(shader);
+		ERROR_RETURN(0, "Error compiling shader %s. %s\n", path, log);
 	}
 
-	File file_fragment = io_file_read(path_frag);
-	if (!file_fragment.is_valid) {
-		ERROR_EXIT("Error reading shader: %s\n", path_frag);
-	}
+	return shader;
+}
 
-	u32 shader_fragment = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(shader_fragment, 1, (const char *const *)&file_fragment, NULL);
-	glCompileShader(shader_fragment);
-	glGetShaderiv(shader_fragment, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(shader_fragment, 512, NULL, log);
-		ERROR_EXIT("Error compiling fragment shader. %s\n", log);
+// Returns 0 on failure so callers can keep a previous program.
+u32 render_shader_load(const char *path_vert, const char *path_frag) {
+	int success;
+	char log[512];
+
+	u32 shader_vertex = shader_compile(GL_VERTEX_SHADER, path_vert);
+	u32 shader_fragment = shader_compile(GL_FRAGMENT_SHADER, path_frag);
+
+	if (!shader_vertex || !shader_fragment) {
+		glDeleteShader(shader_vertex);
+		glDeleteShader(shader_fragment);
+		return 0;
 	}
 
 	u32 shader = glCreateProgram();
 	glAttachShader(shader, shader_vertex);
 	glAttachShader(shader, shader_fragment);
 	glLinkProgram(shader);
+	glDeleteShader(shader_vertex);
+	glDeleteShader(shader_fragment);
+
 	glGetProgramiv(shader, GL_LINK_STATUS, &success);
 	if (!success) {
 		glGetProgramInfoLog(shader, 512, NULL, log);
-		ERROR_EXIT("Error linking shader. %s\n", log);
+		glDeleteProgram(shader);
+		ERROR_RETURN(0, "Error linking shader. %s\n", log);
 	}
 
-	free(file_vertex.data);
-	free(file_fragment.data);
-
 	return shader;
 }
 
+u32 render_shader_create(const char *path_vert, const char *path_frag) {
+	u32 shader = render_shader_load(path_vert, path_frag);
+	if (!shader) {
+		ERROR_EXIT("Could not create shader from %s and %s\n", path_vert, path_frag);
+	}
+
+	return shader;
+}
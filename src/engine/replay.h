@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "types.h"
+
+// Records everything that feeds the simulation (frame delta, the state of
+// every input action and the RNG seed) to a compact log, and plays it back
+// bit for bit.
+//
+// File: Replay_Header, then one record per frame. A record is a varint of
+// (zigzag(delta_ns - previous delta_ns) << 1 | actions_changed), followed by
+// varints of the down and pressed masks and of presses - 1 for every pressed
+// action when they changed. Actions are logged by index, so playback needs
+// the [controls] the replay was recorded with.
+
+#define REPLAY_MAGIC 0x594c5052 // "RPLY"
+#define REPLAY_VERSION 4
+#define REPLAY_MAX_ACTIONS 64
+// The log is rewritten in the background this often while recording, so a
+// crash loses at most this many frames.
+#define REPLAY_FLUSH_FRAMES 600
+
+typedef struct replay_header {
+	u32 magic;
+	u32 version;
+	u32 seed;
+	u32 frame_rate;
+	u64 frame_count;
+	// Physics tunables at record time, applied again on playback.
+	f32 gravity;
+	f32 terminal_velocity;
+	u32 iterations;
+} Replay_Header;
+
+// Bit n of down is set while action n is held, bit n of pressed if it went
+// down presses[n] times during the frame.
+typedef struct replay_actions {
+	u64 down;
+	u64 pressed;
+	u32 presses[REPLAY_MAX_ACTIONS];
+} Replay_Actions;
+
+bool replay_record_start(const char *path, u32 seed);
+// Loads the log, applies its physics tunables and returns its seed, which
+// the caller must use.
+bool replay_play_start(const char *path, u32 *seed);
+// Writes out the log if recording.
+void replay_stop(void);
+
+bool replay_is_recording(void);
+bool replay_is_playing(void);
+// Set once playback has consumed every frame.
+bool replay_is_finished(void);
+
+// Call right after time_update. Records the frame delta, or replaces it with
+// the logged one when playing.
+void replay_frame_begin(void);
+// Called by input_update with the sampled action state. Records it, or
+// replaces it with the logged one when playing.
+void replay_actions(Replay_Actions *actions);
@@ -0,0 +1,264 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../util.h"
+#include "../io.h"
+#include "../global.h"
+#include "../physics.h"
+#include "../replay.h"
+
+typedef enum replay_mode {
+	REPLAY_MODE_NONE,
+	REPLAY_MODE_RECORD,
+	REPLAY_MODE_PLAY,
+} Replay_Mode;
+
+typedef struct replay_state {
+	Replay_Mode mode;
+	char path[256];
+	u8 *data;
+	usize len;
+	usize capacity;
+	usize cursor;
+	u64 frame_count;
+	u64 delta_ns;
+	u64 frame_delta_ns;
+	Replay_Actions actions;
+	bool is_finished;
+} Replay_State;
+
+static Replay_State state;
+
+static bool reserve(usize size) {
+	if (state.len + size <= state.capacity)
+		return true;
+
+	usize capacity = state.capacity ? state.capacity * 2 : 4096;
+	while (capacity < state.len + size)
+		capacity *= 2;
+
+	u8 *data = realloc(state.data, capacity);
+	if (!data)
+		ERROR_RETURN(false, "Not enough free memory to record replay\n");
+
+	state.data = data;
+	state.capacity = capacity;
+
+	return true;
+}
+
+static void write_varint(u64 value) {
+	if (!reserve(10))
+		return;
+
+	while (value >= 0x80) {
+		state.data[state.len++] = (u8)value | 0x80;
+		value >>= 7;
+	}
+	state.data[state.len++] = (u8)value;
+}
+
+static bool read_varint(u64 *value) {
+	*value = 0;
+
+	for (u32 shift = 0; shift < 64; shift += 7) {
+		if (state.cursor == state.len)
+			return false;
+
+		u8 byte = state.data[state.cursor++];
+		*value |= (u64)(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+
+	return false;
+}
+
+static u64 zigzag_encode(i64 value) {
+	return ((u64)value << 1) ^ (u64)(value >> 63);
+}
+
+static i64 zigzag_decode(u64 value) {
+	return (i64)(value >> 1) ^ -(i64)(value & 1);
+}
+
+static void header_update(void) {
+	Replay_Header *header = (Replay_Header*)state.data;
+	header->magic = REPLAY_MAGIC;
+	header->version = REPLAY_VERSION;
+	header->frame_rate = global.time.frame_delay_ns ? 1000000000ULL / global.time.frame_delay_ns : 0;
+	header->frame_count = state.frame_count;
+}
+
+bool replay_record_start(const char *path, u32 seed) {
+	if (strlen(path) >= sizeof(state.path))
+		ERROR_RETURN(false, "Replay path too long: %s\n", path);
+
+	state = (Replay_State){ .mode = REPLAY_MODE_RECORD };
+	strcpy(state.path, path);
+
+	if (!reserve(sizeof(Replay_Header)))
+		return false;
+
+	Physics_Tunables tunables = physics_get_tunables();
+	state.len = sizeof(Replay_Header);
+	*(Replay_Header*)state.data = (Replay_Header){
+		.seed = seed,
+		.gravity = tunables.gravity,
+		.terminal_velocity = tunables.terminal_velocity,
+		.iterations = tunables.iterations,
+	};
+	header_update();
+
+	return true;
+}
+
+bool replay_play_start(const char *path, u32 *seed) {
+	File file = io_file_read(path);
+	if (!file.is_valid)
+		ERROR_RETURN(false, "Could not read replay: %s\n", path);
+
+	Replay_Header *header = (Replay_Header*)file.data;
+	if (file.len < sizeof(Replay_Header) || header->magic != REPLAY_MAGIC || header->version != REPLAY_VERSION) {
+		free(file.data);
+		ERROR_RETURN(false, "Invalid replay file: %s\n", path);
+	}
+
+	state = (Replay_State){
+		.mode = REPLAY_MODE_PLAY,
+		.data = (u8*)file.data,
+		.len = file.len,
+		.capacity = file.len,
+		.cursor = sizeof(Replay_Header),
+	};
+	*seed = header->seed;
+	physics_set_tunables((Physics_Tunables){
+		.gravity = header->gravity,
+		.terminal_velocity = header->terminal_velocity,
+		.iterations = header->iterations,
+	});
+
+	printf("Replaying %s: %llu frames at %u fps, seed %u\n",
+			path, (unsigned long long)header->frame_count, header->frame_rate, header->seed);
+
+	return true;
+}
+
+void replay_stop(void) {
+	if (state.mode == REPLAY_MODE_RECORD) {
+		// A background flush finishing later would overwrite the full log.
+		io_flush();
+		header_update();
+		if (io_file_write(state.data, state.len, state.path) != 0)
+			fprintf(stderr, "Could not write replay: %s\n", state.path);
+	}
+
+	free(state.data);
+	state = (Replay_State){0};
+}
+
+static bool actions_equal(const Replay_Actions *a, const Replay_Actions *b) {
+	if (a->down != b->down || a->pressed != b->pressed)
+		return false;
+
+	for (u32 i = 0; i < REPLAY_MAX_ACTIONS; ++i) {
+		if ((a->pressed >> i & 1) && a->presses[i] != b->presses[i])
+			return false;
+	}
+
+	return true;
+}
+
+static void write_actions(const Replay_Actions *actions) {
+	write_varint(actions->down);
+	write_varint(actions->pressed);
+
+	for (u32 i = 0; i < REPLAY_MAX_ACTIONS; ++i) {
+		if (actions->pressed >> i & 1)
+			write_varint(actions->presses[i] - 1);
+	}
+}
+
+static bool read_actions(Replay_Actions *actions) {
+	*actions = (Replay_Actions){0};
+
+	if (!read_varint(&actions->down) || !read_varint(&actions->pressed))
+		return false;
+
+	for (u32 i = 0; i < REPLAY_MAX_ACTIONS; ++i) {
+		u64 presses;
+		if (!(actions->pressed >> i & 1))
+			continue;
+		if (!read_varint(&presses))
+			return false;
+		actions->presses[i] = (u32)presses + 1;
+	}
+
+	return true;
+}
+
+bool replay_is_recording(void) {
+	return state.mode == REPLAY_MODE_RECORD;
+}
+
+bool replay_is_playing(void) {
+	return state.mode == REPLAY_MODE_PLAY;
+}
+
+bool replay_is_finished(void) {
+	return state.is_finished;
+}
+
+void replay_frame_begin(void) {
+	if (state.mode == REPLAY_MODE_RECORD) {
+		state.frame_delta_ns = global.time.delta_ns;
+		return;
+	}
+
+	if (state.mode != REPLAY_MODE_PLAY || state.is_finished)
+		return;
+
+	u64 record;
+	if (!read_varint(&record)) {
+		state.is_finished = true;
+		return;
+	}
+
+	state.delta_ns += zigzag_decode(record >> 1);
+
+	if ((record & 1) && !read_actions(&state.actions)) {
+		state.is_finished = true;
+		return;
+	}
+
+	// The same integer gives the same float, so the simulation sees exactly
+	// the deltas it saw while recording.
+	global.time.delta_ns = state.delta_ns;
+	global.time.delta = global.time.delta_ns / 1e9;
+}
+
+void replay_actions(Replay_Actions *actions) {
+	if (state.mode == REPLAY_MODE_PLAY) {
+		*actions = state.actions;
+		return;
+	}
+
+	if (state.mode != REPLAY_MODE_RECORD)
+		return;
+
+	bool is_changed = !actions_equal(actions, &state.actions) || state.frame_count == 0;
+	i64 delta_change = (i64)(state.frame_delta_ns - state.delta_ns);
+
+	write_varint(zigzag_encode(delta_change) << 1 | is_changed);
+	if (is_changed)
+		write_actions(actions);
+
+	state.delta_ns = state.frame_delta_ns;
+	state.actions = *actions;
+	++state.frame_count;
+
+	if (state.frame_count % REPLAY_FLUSH_FRAMES == 0) {
+		header_update();
+		io_file_write_async(state.data, state.len, state.path);
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "types.h"
+
+// Explicit-state random number generators. Nothing is global or locked, so
+// each system or thread owns its Rng and results depend only on its seed.
+//
+// Rng is xoshiro256** for general use. Rng_Lanes runs four xoshiro128+
+// generators side by side (SSE2 when available) for filling large buffers.
+
+typedef struct rng {
+	u64 s[4];
+} Rng;
+
+// s[word][lane].
+typedef struct rng_lanes {
+	u32 s[4][4];
+} Rng_Lanes;
+
+void rng_seed(Rng *rng, u64 seed);
+// A stream named after the system that owns it. Different names give
+// unrelated sequences from the same session seed.
+void rng_stream(Rng *rng, u64 seed, const char *name);
+
+u64 rng_u64(Rng *rng);
+u32 rng_u32(Rng *rng);
+// Uniform in [0, bound) without modulo bias. bound must be non-zero.
+u32 rng_range(Rng *rng, u32 bound);
+// Uniform in [0, 1).
+f32 rng_f32(Rng *rng);
+f32 rng_range_f32(Rng *rng, f32 min, f32 max);
+bool rng_chance(Rng *rng, f32 probability);
+
+void rng_lanes_seed(Rng_Lanes *lanes, u64 seed);
+void rng_fill_u32(Rng_Lanes *lanes, u32 *out, usize count);
+// Uniform in [0, 1).
+void rng_fill_f32(Rng_Lanes *lanes, f32 *out, usize count);
@@ -0,0 +1,180 @@
+#include "../hash.h"
+#include "../rng.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Used to expand a single seed into generator state, as recommended by the
+// xoshiro authors.
+static u64 splitmix64(u64 *x) {
+	u64 z = (*x += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+	return z ^ (z >> 31);
+}
+
+static inline u64 rotl64(u64 x, u32 k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+static inline u32 rotl32(u32 x, u32 k) {
+	return (x << k) | (x >> (32 - k));
+}
+
+void rng_seed(Rng *rng, u64 seed) {
+	for (u32 i = 0; i < 4; ++i) {
+		rng->s[i] = splitmix64(&seed);
+	}
+}
+
+void rng_stream(Rng *rng, u64 seed, const char *name) {
+	rng_seed(rng, seed ^ hash_string(name));
+}
+
+u64 rng_u64(Rng *rng) {
+	u64 *s = rng->s;
+	u64 result = rotl64(s[1] * 5, 7) * 9;
+	u64 t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl64(s[3], 45);
+
+	return result;
+}
+
+u32 rng_u32(Rng *rng) {
+	return rng_u64(rng) >> 32;
+}
+
+// Lemire's multiply-shift with rejection.
+u32 rng_range(Rng *rng, u32 bound) {
+	u64 m = (u64)rng_u32(rng) * bound;
+	u32 low = (u32)m;
+
+	if (low < bound) {
+		u32 threshold = -bound % bound;
+		while (low < threshold) {
+			m = (u64)rng_u32(rng) * bound;
+			low = (u32)m;
+		}
+	}
+
+	return m >> 32;
+}
+
+f32 rng_f32(Rng *rng) {
+	return (rng_u64(rng) >> 40) * 0x1.0p-24f;
+}
+
+f32 rng_range_f32(Rng *rng, f32 min, f32 max) {
+	return min + (max - min) * rng_f32(rng);
+}
+
+bool rng_chance(Rng *rng, f32 probability) {
+	return rng_f32(rng) < probability;
+}
+
+void rng_lanes_seed(Rng_Lanes *lanes, u64 seed) {
+	for (u32 lane = 0; lane < 4; ++lane) {
+		u64 a = splitmix64(&seed);
+		u64 b = splitmix64(&seed);
+		lanes->s[0][lane] = (u32)a;
+		lanes->s[1][lane] = (u32)(a >> 32);
+		lanes->s[2][lane] = (u32)b;
+		lanes->s[3][lane] = (u32)(b >> 32) | 1;
+	}
+}
+
+// Writes blocks * 4 xoshiro128+ outputs, interleaved by lane. The state is
+// kept in registers for the whole run.
+#ifdef __SSE2__
+
+static inline __m128i rotl_x4(__m128i x, i32 k) {
+	return _mm_or_si128(_mm_slli_epi32(x, k), _mm_srli_epi32(x, 32 - k));
+}
+
+static void lanes_generate(Rng_Lanes *lanes, u32 *out, usize blocks) {
+	__m128i s0 = _mm_loadu_si128((__m128i*)lanes->s[0]);
+	__m128i s1 = _mm_loadu_si128((__m128i*)lanes->s[1]);
+	__m128i s2 = _mm_loadu_si128((__m128i*)lanes->s[2]);
+	__m128i s3 = _mm_loadu_si128((__m128i*)lanes->s[3]);
+
+	for (usize i = 0; i < blocks; ++i) {
+		_mm_storeu_si128((__m128i*)(out + i * 4), _mm_add_epi32(s0, s3));
+
+		__m128i t = _mm_slli_epi32(s1, 9);
+		s2 = _mm_xor_si128(s2, s0);
+		s3 = _mm_xor_si128(s3, s1);
+		s1 = _mm_xor_si128(s1, s2);
+		s0 = _mm_xor_si128(s0, s3);
+		s2 = _mm_xor_si128(s2, t);
+		s3 = rotl_x4(s3, 11);
+	}
+
+	_mm_storeu_si128((__m128i*)lanes->s[0], s0);
+	_mm_storeu_si128((__m128i*)lanes->s[1], s1);
+	_mm_storeu_si128((__m128i*)lanes->s[2], s2);
+	_mm_storeu_si128((__m128i*)lanes->s[3], s3);
+}
+
+#else
+
+static void lanes_generate(Rng_Lanes *lanes, u32 *out, usize blocks) {
+	u32 (*s)[4] = lanes->s;
+
+	for (usize i = 0; i < blocks; ++i) {
+		for (u32 lane = 0; lane < 4; ++lane) {
+			out[i * 4 + lane] = s[0][lane] + s[3][lane];
+
+			u32 t = s[1][lane] << 9;
+			s[2][lane] ^= s[0][lane];
+			s[3][lane] ^= s[1][lane];
+			s[1][lane] ^= s[2][lane];
+			s[0][lane] ^= s[3][lane];
+			s[2][lane] ^= t;
+			s[3][lane] = rotl32(s[3][lane], 11);
+		}
+	}
+}
+
+#endif
+
+void rng_fill_u32(Rng_Lanes *lanes, u32 *out, usize count) {
+	lanes_generate(lanes, out, count / 4);
+
+	usize i = count & ~(usize)3;
+	if (i < count) {
+		u32 tail[4];
+		lanes_generate(lanes, tail, 1);
+		for (u32 j = 0; i < count; ++i, ++j) {
+			out[i] = tail[j];
+		}
+	}
+}
+
+// The low bits of xoshiro128+ are weak, floats use the top 24.
+void rng_fill_f32(Rng_Lanes *lanes, f32 *out, usize count) {
+	u32 *bits = (u32*)out;
+	rng_fill_u32(lanes, bits, count);
+
+	usize i = 0;
+
+#ifdef __SSE2__
+	__m128 scale = _mm_set1_ps(0x1.0p-24f);
+
+	for (; i + 4 <= count; i += 4) {
+		__m128i top = _mm_srli_epi32(_mm_loadu_si128((__m128i*)(bits + i)), 8);
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(top), scale));
+	}
+#endif
+
+	for (; i < count; ++i) {
+		out[i] = (bits[i] >> 8) * 0x1.0p-24f;
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "types.h"
+#include "ecs.h"
+
+// Runs a frame's systems as a job graph. Each system declares the components
+// and engine resources it reads and writes. Two systems conflict when either
+// writes something the other touches. Conflicting systems run in the order
+// they were added; everything else may run concurrently on the job pool.
+//
+// Systems that make structural ECS changes (create, destroy, add, remove)
+// must declare SCHEDULE_ALL_COMPONENTS as written.
+
+#define SCHEDULE_MAX_SYSTEMS 64
+#define SCHEDULE_ALL_COMPONENTS (~(Ecs_Mask)0)
+#define SCHEDULE_RESOURCE(resource) (1ULL << (resource))
+
+typedef enum schedule_resource {
+	SCHEDULE_RESOURCE_INPUT,
+	SCHEDULE_RESOURCE_PHYSICS,
+	SCHEDULE_RESOURCE_ANIMATION,
+	// Sound playback and the mixer.
+	SCHEDULE_RESOURCE_AUDIO,
+	// Sprite batches and GL state.
+	SCHEDULE_RESOURCE_RENDER,
+	// First bit free for game-defined resources.
+	SCHEDULE_RESOURCE_USER,
+} Schedule_Resource;
+
+typedef void (*Schedule_Function)(void *data);
+
+typedef struct schedule_access {
+	Ecs_Mask components;
+	// SCHEDULE_RESOURCE bits.
+	u64 resources;
+} Schedule_Access;
+
+typedef struct schedule_system {
+	// Used as the profiler zone, must outlive the schedule.
+	const char *name;
+	Schedule_Function function;
+	void *data;
+	Schedule_Access read;
+	Schedule_Access write;
+	// For systems that call SDL event or GL functions.
+	bool is_main_thread;
+} Schedule_System;
+
+void schedule_init(void);
+// Returns the system's index in the schedule.
+u32 schedule_add(Schedule_System system);
+void schedule_clear(void);
+// Runs every system once and returns when all have finished. Must be called
+// from the main thread. With [jobs] parallel_systems = false, runs them one
+// after another in order.
+void schedule_run(void);
@@ -0,0 +1,169 @@
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "../util.h"
+#include "../config.h"
+#include "../profile.h"
+#include "../job.h"
+#include "../schedule.h"
+
+typedef struct schedule_node {
+	Schedule_System system;
+	// Later systems that conflict with this one.
+	u32 dependents[SCHEDULE_MAX_SYSTEMS];
+	u32 dependent_count;
+	u32 dependency_count;
+	// Dependencies left to finish in the current run.
+	SDL_atomic_t waiting;
+} Schedule_Node;
+
+typedef struct schedule_state {
+	Schedule_Node nodes[SCHEDULE_MAX_SYSTEMS];
+	u32 count;
+	bool is_parallel;
+	SDL_atomic_t remaining;
+	// Main thread systems whose dependencies are done. Guarded by mutex.
+	u32 main_ready[SCHEDULE_MAX_SYSTEMS];
+	u32 main_ready_count;
+	SDL_mutex *mutex;
+	// Signalled when a system finishes or a main thread system is ready.
+	SDL_cond *cond;
+} Schedule_State;
+
+static Schedule_State state;
+
+static bool is_conflict(const Schedule_System *a, const Schedule_System *b) {
+	Ecs_Mask a_components = a->read.components | a->write.components;
+	Ecs_Mask b_components = b->read.components | b->write.components;
+	u64 a_resources = a->read.resources | a->write.resources;
+	u64 b_resources = b->read.resources | b->write.resources;
+
+	return (a->write.components & b_components) || (b->write.components & a_components)
+		|| (a->write.resources & b_resources) || (b->write.resources & a_resources);
+}
+
+static void node_execute(Schedule_Node *node) {
+	PROFILE_BEGIN(node->system.name);
+	node->system.function(node->system.data);
+	PROFILE_END();
+}
+
+static void node_submit(u32 index);
+
+static void node_job(void *data) {
+	Schedule_Node *node = data;
+	node_execute(node);
+
+	for (u32 i = 0; i < node->dependent_count; ++i) {
+		u32 dependent = node->dependents[i];
+		if (SDL_AtomicAdd(&state.nodes[dependent].waiting, -1) == 1)
+			node_submit(dependent);
+	}
+
+	SDL_LockMutex(state.mutex);
+	SDL_AtomicAdd(&state.remaining, -1);
+	SDL_CondSignal(state.cond);
+	SDL_UnlockMutex(state.mutex);
+}
+
+static void node_submit(u32 index) {
+	Schedule_Node *node = &state.nodes[index];
+
+	if (!node->system.is_main_thread) {
+		job_run(node_job, node, NULL);
+		return;
+	}
+
+	SDL_LockMutex(state.mutex);
+	state.main_ready[state.main_ready_count++] = index;
+	SDL_CondSignal(state.cond);
+	SDL_UnlockMutex(state.mutex);
+}
+
+void schedule_init(void) {
+	state.mutex = SDL_CreateMutex();
+	state.cond = SDL_CreateCond();
+	if (!state.mutex || !state.cond)
+		ERROR_EXIT("Could not create schedule sync objects: %s\n", SDL_GetError());
+
+	state.is_parallel = config_get_bool("jobs", "parallel_systems", true);
+}
+
+u32 schedule_add(Schedule_System system) {
+	if (state.count == SCHEDULE_MAX_SYSTEMS)
+		ERROR_EXIT("Too many systems, max is %d\n", SCHEDULE_MAX_SYSTEMS);
+
+	u32 index = state.count++;
+	Schedule_Node *node = &state.nodes[index];
+	*node = (Schedule_Node){ .system = system };
+
+	// Conflicts are transitive through the chain of earlier systems, but
+	// linking every one keeps the rule obvious and the graph is tiny.
+	for (u32 i = 0; i < index; ++i) {
+		Schedule_Node *earlier = &state.nodes[i];
+		if (is_conflict(&earlier->system, &system)) {
+			earlier->dependents[earlier->dependent_count++] = index;
+			++node->dependency_count;
+		}
+	}
+
+	return index;
+}
+
+void schedule_clear(void) {
+	state.count = 0;
+}
+
+void schedule_run(void) {
+	if (!state.is_parallel || job_thread_count() <= 1) {
+		for (u32 i = 0; i < state.count; ++i) {
+			node_execute(&state.nodes[i]);
+		}
+		return;
+	}
+
+	SDL_AtomicSet(&state.remaining, state.count);
+	state.main_ready_count = 0;
+
+	for (u32 i = 0; i < state.count; ++i) {
+		SDL_AtomicSet(&state.nodes[i].waiting, state.nodes[i].dependency_count);
+	}
+
+	for (u32 i = 0; i < state.count; ++i) {
+		if (state.nodes[i].dependency_count == 0)
+			node_submit(i);
+	}
+
+	// Main thread systems run here as they become ready; in between, the main
+	// thread helps with pool jobs and sleeps only when there are none.
+	while (true) {
+		SDL_LockMutex(state.mutex);
+
+		u32 index = (u32)-1;
+		if (state.main_ready_count > 0) {
+			index = state.main_ready[0];
+			--state.main_ready_count;
+			memmove(state.main_ready, state.main_ready + 1, sizeof(u32) * state.main_ready_count);
+		}
+
+		bool is_done = SDL_AtomicGet(&state.remaining) == 0;
+
+		SDL_UnlockMutex(state.mutex);
+
+		if (is_done)
+			break;
+
+		if (index != (u32)-1) {
+			node_job(&state.nodes[index]);
+			continue;
+		}
+
+		if (job_run_one())
+			continue;
+
+		SDL_LockMutex(state.mutex);
+		if (state.main_ready_count == 0 && SDL_AtomicGet(&state.remaining) > 0)
+			SDL_CondWaitTimeout(state.cond, state.mutex, 1);
+		SDL_UnlockMutex(state.mutex);
+	}
+}
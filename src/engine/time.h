@@ -2,19 +2,36 @@
 
 #include "types.h"
 
+#define TIME_DEFAULT_FRAME_RATE 60
+#define TIME_MAX_FRAME_RATE 1000
+// SDL_Delay can oversleep by a millisecond or two, so the last stretch before
+// a frame deadline is spun instead.
+#define TIME_SPIN_NS 2000000ULL
+
+// Times are kept as integer nanoseconds on a monotonic clock. The float fields
+// are derived from them each frame, so they never accumulate error.
 typedef struct time_state {
 	f32 delta;
-	f32 now;
-	f32 last;
+	// Seconds since time_init.
+	f64 now;
+
+	u64 now_ns;
+	u64 last_ns;
+	u64 delta_ns;
 
-	f32 frame_last;
-	f32 frame_delay;
-	f32 frame_time;
+	u64 frame_last_ns;
+	u64 frame_delay_ns;
+	u64 frame_time_ns;
+	u64 frame_deadline_ns;
 
 	u32 frame_rate;
 	u32 frame_count;
 } Time_State;
 
 void time_init(u32 frame_rate);
+// Calls time_init with [time] frame_rate.
+void time_apply_config(void);
+// Nanoseconds since the first time_init.
+u64 time_now_ns(void);
 void time_update(void);
 void time_update_late(void);
@@ -1,30 +1,84 @@
 #include <SDL2/SDL.h>
 #include "../time.h"
+#include "../config.h"
+#include "../profile.h"
 #include "../global.h"
 
+static u64 clock_start;
+static u64 clock_frequency;
+
+u64 time_now_ns(void) {
+	u64 ticks = SDL_GetPerformanceCounter() - clock_start;
+
+	// Split to avoid overflowing when the counter runs at nanosecond rate.
+	return ticks / clock_frequency * 1000000000ULL + ticks % clock_frequency * 1000000000ULL / clock_frequency;
+}
+
 void time_init(u32 frame_rate) {
+	if (!clock_frequency) {
+		clock_frequency = SDL_GetPerformanceFrequency();
+		clock_start = SDL_GetPerformanceCounter();
+		global.time.last_ns = time_now_ns();
+	}
+
 	global.time.frame_rate = frame_rate;
-	global.time.frame_delay = 1000.f / frame_rate;
+	global.time.frame_delay_ns = 1000000000ULL / frame_rate;
+}
+
+void time_apply_config(void) {
+	i32 frame_rate = config_get_int("time", "frame_rate", TIME_DEFAULT_FRAME_RATE);
+	if (frame_rate < 1 || frame_rate > TIME_MAX_FRAME_RATE) {
+		fprintf(stderr, "Frame rate must be between 1 and %d, got %d.\n", TIME_MAX_FRAME_RATE, frame_rate);
+		frame_rate = frame_rate < 1 ? 1 : TIME_MAX_FRAME_RATE;
+	}
+
+	time_init(frame_rate);
 }
 
 void time_update(void) {
-	global.time.now = (f32)SDL_GetTicks();
-	global.time.delta = (global.time.now - global.time.last) / 1000.f;
-	global.time.last = global.time.now;
+	global.time.now_ns = time_now_ns();
+	global.time.delta_ns = global.time.now_ns - global.time.last_ns;
+	global.time.last_ns = global.time.now_ns;
+
+	global.time.now = global.time.now_ns / 1e9;
+	global.time.delta = global.time.delta_ns / 1e9;
 	++global.time.frame_count;
 
-	if (global.time.now - global.time.frame_last >= 1000.f) {
+	if (global.time.now_ns - global.time.frame_last_ns >= 1000000000ULL) {
 		global.time.frame_rate = global.time.frame_count;
 		global.time.frame_count = 0;
-		global.time.frame_last = global.time.now;
+		global.time.frame_last_ns = global.time.now_ns;
 	}
 }
 
-void time_update_late(void) {
-	global.time.frame_time = (f32)SDL_GetTicks() - global.time.now;
+static void wait_until(u64 deadline) {
+	u64 now = time_now_ns();
+	if (now + TIME_SPIN_NS < deadline) {
+		SDL_Delay((deadline - now - TIME_SPIN_NS) / 1000000);
+	}
 
-	if (global.time.frame_delay > global.time.frame_time) {
-		SDL_Delay(global.time.frame_delay - global.time.frame_time);
+	while (time_now_ns() < deadline) {
 	}
 }
 
+// Frames are paced against a fixed schedule of deadlines rather than "delay
+// minus work", so sleep error doesn't carry over into the next frame.
+void time_update_late(void) {
+	u64 now = time_now_ns();
+	global.time.frame_time_ns = now - global.time.now_ns;
+
+	u64 deadline = global.time.frame_deadline_ns + global.time.frame_delay_ns;
+
+	// More than a frame behind (a hitch, or the frame rate changed): start a
+	// new schedule instead of rushing to catch up.
+	if (deadline + global.time.frame_delay_ns < now || deadline > now + global.time.frame_delay_ns) {
+		deadline = global.time.now_ns + global.time.frame_delay_ns;
+	}
+
+	global.time.frame_deadline_ns = deadline;
+
+	if (deadline > now) {
+		PROFILE_SCOPE("frame_wait");
+		wait_until(deadline);
+	}
+}
@@ -1,6 +1,7 @@
 #include "engine/array_list.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include <glad/glad.h>
 #define SDL_MAIN_HANDLED
@@ -17,10 +18,21 @@
 #include "engine/render.h"
 #include "engine/animation.h"
 #include "engine/audio.h"
+#include "engine/pack.h"
+#include "engine/hot_reload.h"
+#include "engine/profile.h"
+#include "engine/frame_stats.h"
+#include "engine/replay.h"
+#include "engine/rng.h"
+#include "engine/job.h"
+#include "engine/schedule.h"
 
 void reset(void);
 
-static Mix_Music *MUSIC_STAGE_1;
+static Rng rng_spawn;
+static Rng rng_fire;
+
+static Audio_Music MUSIC_STAGE_1;
 static Mix_Chunk *SOUND_JUMP;
 static Mix_Chunk *SOUND_SHOOT;
 static Mix_Chunk *SOUND_BULLET_HIT_WALL;
@@ -72,12 +84,12 @@ typedef struct weapon {
 
 static Weapon weapons[WEAPON_TYPE_COUNT] = {0};
 
-static f32 render_width;
-static f32 render_height;
 static u32 texture_slots[8] = {0};
 
 static Weapon_Type weapon_type = WEAPON_TYPE_PISTOL;
 static bool should_quit = false;
+// Set from physics callbacks, the level is reset at the sync point.
+static bool should_reset = false;
 static bool player_is_grounded = false;
 static usize anim_player_walk_id;
 static usize anim_player_idle_id;
@@ -88,7 +100,7 @@ static usize anim_enemy_large_enraged_id;
 static usize anim_fire_id;
 static usize anim_projectile_small_id;
 
-static usize player_id;
+static Ecs_Entity player_id;
 
 static f32 ground_timer = 0;
 static f32 shoot_timer = 0;
@@ -101,58 +113,50 @@ static u8 projectile_mask = COLLISION_LAYER_ENEMY | COLLISION_LAYER_TERRAIN;
 
 void projectile_on_hit(Body *self, Body *other, Hit hit) {
 	if (other->collision_layer == COLLISION_LAYER_ENEMY) {
-        Entity *projectile = entity_get(self->entity_id);
-        Entity *enemy = entity_get(other->entity_id);
-        if (projectile->animation_id == anim_projectile_small_id) {
+        Entity_Sprite *projectile = entity_sprite(self->entity_id);
+        if (projectile && projectile->animation_id == anim_projectile_small_id) {
             if (entity_damage(other->entity_id, 1)) {
-                audio_sound_play(SOUND_ENEMY_DEATH);
+                audio_sound_play_at(SOUND_ENEMY_DEATH, other->aabb.position);
             }
         }
-        audio_sound_play(SOUND_HURT);
+        audio_sound_play_at(SOUND_HURT, other->aabb.position);
 	}
 }
 
 void projectile_on_hit_static(Body *self, Static_Body *other, Hit hit) {
-        Entity *projectile = entity_get(self->entity_id);
-        if (projectile->animation_id == anim_projectile_small_id) {
-            audio_sound_play(SOUND_SHOOT);
+        Entity_Sprite *projectile = entity_sprite(self->entity_id);
+        if (projectile && projectile->animation_id == anim_projectile_small_id) {
+            audio_sound_play_at(SOUND_SHOOT, self->aabb.position);
         }
         entity_destroy(self->entity_id);
 }
 
 static void spawn_projectile(Projectile_Type projectile_type) {
     Weapon weapon = weapons[weapon_type];
-    Entity *player = entity_get(player_id);
-    Body *body = physics_body_get(player->body_id);
-    Animation *animation = animation_get(player->animation_id);
-    bool is_flipped = animation->is_flipped;
+    f32 *position = entity_position(player_id);
+    bool is_flipped = entity_animation(player_id)->is_flipped;
     vec2 velocity = {is_flipped ? -weapon.projectile_speed : weapon.projectile_speed, 0};
 
-    entity_create(body->aabb.position, weapon.sprite_size, weapon.sprite_offset, velocity, COLLISION_LAYER_PROJECTILE, projectile_mask, true, weapon.projectile_animation_id, projectile_on_hit, projectile_on_hit_static);
+    entity_create(position, weapon.sprite_size, weapon.sprite_offset, velocity, COLLISION_LAYER_PROJECTILE, projectile_mask, true, weapon.projectile_animation_id, projectile_on_hit, projectile_on_hit_static);
     audio_sound_play(weapon.sfx);
 }
 
-static void input_handle(Body *body_player) {
+static void input_handle(f32 *velocity_player, Animation_State *anim_player) {
 	if (global.input.escape) {
 		should_quit = true;
 	}
 
-    Animation *walk_anim = animation_get(anim_player_walk_id);
-    Animation *idle_anim = animation_get(anim_player_idle_id);
-
 	f32 velx = 0;
-	f32 vely = body_player->velocity[1];
+	f32 vely = velocity_player[1];
 
 	if (global.input.right) {
 		velx += SPEED_PLAYER;
-        walk_anim->is_flipped = false;
-        idle_anim->is_flipped = false;
+        anim_player->is_flipped = false;
 	}
 
 	if (global.input.left) {
 		velx -= SPEED_PLAYER;
-        walk_anim->is_flipped = true;
-        idle_anim->is_flipped = true;
+        anim_player->is_flipped = true;
 	}
 
 	if (global.input.up && player_is_grounded) {
@@ -161,8 +165,8 @@ static void input_handle(Body *body_player) {
 		audio_sound_play(SOUND_JUMP);
 	}
 
-	body_player->velocity[0] = velx;
-	body_player->velocity[1] = vely;
+	velocity_player[0] = velx;
+	velocity_player[1] = vely;
 
     if (global.input.shoot && shoot_timer <= 0) {
         Weapon weapon = weapons[weapon_type];
@@ -183,10 +187,10 @@ void player_on_hit_static(Body *self, Static_Body *other, Hit hit) {
 }
 
 void enemy_small_on_hit_static(Body *self, Static_Body *other, Hit hit) {
-    Entity *entity = entity_get(self->entity_id);
+    bool is_enraged = entity_is_enraged(self->entity_id);
 
 	if (hit.normal[0] > 0) {
-        if (entity->is_enraged) {
+        if (is_enraged) {
             self->velocity[0] = SPEED_ENEMY_SMALL * 1.5f;
         } else {
             self->velocity[0] = SPEED_ENEMY_SMALL;
@@ -194,7 +198,7 @@ void enemy_small_on_hit_static(Body *self, Static_Body *other, Hit hit) {
 	}
 
 	if (hit.normal[0] < 0) {
-        if (entity->is_enraged) {
+        if (is_enraged) {
             self->velocity[0] = -SPEED_ENEMY_SMALL * 1.5f;
         } else {
             self->velocity[0] = -SPEED_ENEMY_SMALL;
@@ -203,10 +207,10 @@ void enemy_small_on_hit_static(Body *self, Static_Body *other, Hit hit) {
 }
 
 void enemy_large_on_hit_static(Body *self, Static_Body *other, Hit hit) {
-    Entity *entity = entity_get(self->entity_id);
+    bool is_enraged = entity_is_enraged(self->entity_id);
 
 	if (hit.normal[0] > 0) {
-        if (entity->is_enraged) {
+        if (is_enraged) {
             self->velocity[0] = SPEED_ENEMY_LARGE * 1.5f;
         } else {
             self->velocity[0] = SPEED_ENEMY_LARGE;
@@ -214,7 +218,7 @@ void enemy_large_on_hit_static(Body *self, Static_Body *other, Hit hit) {
 	}
 
 	if (hit.normal[0] < 0) {
-        if (entity->is_enraged) {
+        if (is_enraged) {
             self->velocity[0] = -SPEED_ENEMY_LARGE * 1.5f;
         } else {
             self->velocity[0] = -SPEED_ENEMY_LARGE;
@@ -223,8 +227,10 @@ void enemy_large_on_hit_static(Body *self, Static_Body *other, Hit hit) {
 }
 
 void spawn_enemy(bool is_small, bool is_enraged, bool is_flipped) {
-    f32 spawn_x = is_flipped ? render_width : 0;
-    vec2 position = {spawn_x, (render_height - 64)};
+    vec2 render_size;
+    render_get_size(render_size);
+    f32 spawn_x = is_flipped ? render_size[0] : 0;
+    vec2 position = {spawn_x, (render_size[1] - 64)};
     f32 speed = SPEED_ENEMY_LARGE;
     vec2 size = {20, 20};
     vec2 sprite_offset = {0, 10};
@@ -247,27 +253,29 @@ void spawn_enemy(bool is_small, bool is_enraged, bool is_flipped) {
     }
 
     vec2 velocity = {is_flipped ? -speed : speed, 0};
-    usize id = entity_create(position, size, sprite_offset, velocity, COLLISION_LAYER_ENEMY, enemy_mask, false, animation_id, NULL, on_hit_static);
-    Entity *entity = entity_get(id);
-    entity->is_enraged = is_enraged;
+    Ecs_Entity id = entity_create(position, size, sprite_offset, velocity, COLLISION_LAYER_ENEMY, enemy_mask, false, animation_id, NULL, on_hit_static);
+    entity_set_enraged(id, is_enraged);
 }
 
 void fire_on_hit(Body *self, Body *other, Hit hit) {
 	if (other->collision_layer == COLLISION_LAYER_ENEMY) {
         if (other->is_active) {
-            Entity *enemy = entity_get(other->entity_id);
+            Entity_Sprite *enemy = entity_sprite(other->entity_id);
             bool is_small = enemy->animation_id == anim_enemy_small_id || enemy->animation_id == anim_enemy_small_enraged_id;
-            bool is_flipped = rand() % 100 >= 50;
+            bool is_flipped = rng_range(&rng_fire, 100) >= 50;
             spawn_enemy(is_small, true, is_flipped);
             entity_destroy(other->entity_id);
         }
 	} else if (other->collision_layer == COLLISION_LAYER_PLAYER) {
-        reset();
+        should_reset = true;
     }
 }
 
 void reset(void) {
-    audio_music_play(MUSIC_STAGE_1);
+    vec2 render_size;
+    render_get_size(render_size);
+
+    audio_music_play(&MUSIC_STAGE_1);
 
     physics_reset();
     entity_reset();
@@ -276,51 +284,222 @@ void reset(void) {
     spawn_timer = 0;
     shoot_timer = 0;
 
-	player_id = entity_create((vec2){100, 200}, (vec2){24, 24}, (vec2){0, 0}, (vec2){0, 0}, COLLISION_LAYER_PLAYER, player_mask, false, (usize)-1, player_on_hit, player_on_hit_static);
+	player_id = entity_create((vec2){100, 200}, (vec2){24, 24}, (vec2){0, 0}, (vec2){0, 0}, COLLISION_LAYER_PLAYER, player_mask, false, anim_player_idle_id, player_on_hit, player_on_hit_static);
 
     // Init level.
 	{
-		physics_static_body_create((vec2){render_width * 0.5, render_height - 16}, (vec2){render_width, 32}, COLLISION_LAYER_TERRAIN);
-		physics_static_body_create((vec2){render_width * 0.25 - 16, 16}, (vec2){render_width * 0.5 - 32, 48}, COLLISION_LAYER_TERRAIN);
-		physics_static_body_create((vec2){render_width * 0.75 + 16, 16}, (vec2){render_width * 0.5 - 32, 48}, COLLISION_LAYER_TERRAIN);
-		physics_static_body_create((vec2){16, render_height * 0.5 - 3 * 32}, (vec2){32, render_height}, COLLISION_LAYER_TERRAIN);
-		physics_static_body_create((vec2){render_width - 16, render_height * 0.5 - 3 * 32}, (vec2){32, render_height}, COLLISION_LAYER_TERRAIN);
-		physics_static_body_create((vec2){32 + 64, render_height - 32 * 3 - 16}, (vec2){128, 32}, COLLISION_LAYER_TERRAIN);
-		physics_static_body_create((vec2){render_width - 32 - 64, render_height - 32 * 3 - 16}, (vec2){128, 32}, COLLISION_LAYER_TERRAIN);
-		physics_static_body_create((vec2){render_width * 0.5, render_height - 32 * 3 - 16}, (vec2){192, 32}, COLLISION_LAYER_TERRAIN);
-		physics_static_body_create((vec2){render_width * 0.5, 32 * 3 + 24}, (vec2){448, 32}, COLLISION_LAYER_TERRAIN);
-		physics_static_body_create((vec2){16, render_height - 64}, (vec2){32, 64}, COLLISION_LAYER_ENEMY_PASSTHROUGH);
-		physics_static_body_create((vec2){render_width - 16, render_height - 64}, (vec2){32, 64}, COLLISION_LAYER_ENEMY_PASSTHROUGH);
+		physics_static_body_create((vec2){render_size[0] * 0.5, render_size[1] - 16}, (vec2){render_size[0], 32}, COLLISION_LAYER_TERRAIN);
+		physics_static_body_create((vec2){render_size[0] * 0.25 - 16, 16}, (vec2){render_size[0] * 0.5 - 32, 48}, COLLISION_LAYER_TERRAIN);
+		physics_static_body_create((vec2){render_size[0] * 0.75 + 16, 16}, (vec2){render_size[0] * 0.5 - 32, 48}, COLLISION_LAYER_TERRAIN);
+		physics_static_body_create((vec2){16, render_size[1] * 0.5 - 3 * 32}, (vec2){32, render_size[1]}, COLLISION_LAYER_TERRAIN);
+		physics_static_body_create((vec2){render_size[0] - 16, render_size[1] * 0.5 - 3 * 32}, (vec2){32, render_size[1]}, COLLISION_LAYER_TERRAIN);
+		physics_static_body_create((vec2){32 + 64, render_size[1] - 32 * 3 - 16}, (vec2){128, 32}, COLLISION_LAYER_TERRAIN);
+		physics_static_body_create((vec2){render_size[0] - 32 - 64, render_size[1] - 32 * 3 - 16}, (vec2){128, 32}, COLLISION_LAYER_TERRAIN);
+		physics_static_body_create((vec2){render_size[0] * 0.5, render_size[1] - 32 * 3 - 16}, (vec2){192, 32}, COLLISION_LAYER_TERRAIN);
+		physics_static_body_create((vec2){render_size[0] * 0.5, 32 * 3 + 24}, (vec2){448, 32}, COLLISION_LAYER_TERRAIN);
+		physics_static_body_create((vec2){16, render_size[1] - 64}, (vec2){32, 64}, COLLISION_LAYER_ENEMY_PASSTHROUGH);
+		physics_static_body_create((vec2){render_size[0] - 16, render_size[1] - 64}, (vec2){32, 64}, COLLISION_LAYER_ENEMY_PASSTHROUGH);
         
-        physics_trigger_create((vec2){render_width * 0.5, -4}, (vec2){64, 8}, 0, fire_mask, fire_on_hit);
+        physics_trigger_create((vec2){render_size[0] * 0.5, -4}, (vec2){64, 8}, 0, fire_mask, fire_on_hit);
+	}
+
+    entity_create((vec2){render_size[0] * 0.5, 0}, (vec2){32, 64}, (vec2){0, 0}, (vec2){0, 0}, 0, 0, true, anim_fire_id, NULL, NULL);
+    entity_create((vec2){render_size[0] * 0.5 + 16, -16}, (vec2){32, 64}, (vec2){0, 0}, (vec2){0, 0}, 0, 0, true, anim_fire_id, NULL, NULL);
+    entity_create((vec2){render_size[0] * 0.5 - 16, -16}, (vec2){32, 64}, (vec2){0, 0}, (vec2){0, 0}, 0, 0, true, anim_fire_id, NULL, NULL);
+
+    entity_flush();
+}
+
+static void system_physics(void *data) {
+	entity_physics_update();
+}
+
+static void system_animation(void *data) {
+	entity_animation_update(global.time.delta);
+}
+
+static void system_audio(void *data) {
+	audio_update();
+}
+
+static void system_spawn(void *data) {
+	if (spawn_timer <= 0) {
+		spawn_timer = (f32)(rng_range(&rng_spawn, 200) + 200) / 100.f;
+
+		spawn_timer *= 0.2;
+
+		bool is_flipped = rng_range(&rng_spawn, 100) >= 50;
+		bool is_small = rng_range(&rng_spawn, 100) > 18;
+
+		spawn_enemy(is_small, false, is_flipped);
+	}
+}
+
+// The frame's sync point: entities created, destroyed or changed by the
+// systems before it become visible to the ones after.
+static void system_sync(void *data) {
+	if (should_reset) {
+		should_reset = false;
+		reset();
 	}
 
-    entity_create((vec2){render_width * 0.5, 0}, (vec2){32, 64}, (vec2){0, 0}, (vec2){0, 0}, 0, 0, true, anim_fire_id, NULL, NULL);
-    entity_create((vec2){render_width * 0.5 + 16, -16}, (vec2){32, 64}, (vec2){0, 0}, (vec2){0, 0}, 0, 0, true, anim_fire_id, NULL, NULL);
-    entity_create((vec2){render_width * 0.5 - 16, -16}, (vec2){32, 64}, (vec2){0, 0}, (vec2){0, 0}, 0, 0, true, anim_fire_id, NULL, NULL);
+	entity_flush();
+}
+
+static void system_texture_upload(void *data) {
+	render_textures_upload(TEXTURE_UPLOAD_BUDGET);
+}
+
+static void system_render_build(void *data) {
+	Sprite_Sheet *sprite_sheet_map = data;
+	vec2 render_size;
+	render_get_size(render_size);
+
+	render_begin();
+
+	// Render terrain/map.
+	render_sprite_sheet_frame(sprite_sheet_map, 0, 0, (vec2){render_size[0] / 2.0, render_size[1] / 2.0}, false, (vec4){1, 1, 1, 0.2}, texture_slots);
+
+	// Debug render bounding boxes.
+	{
+		Ecs_Query query = ecs_query(ECS_MASK(entity_components.position) | ECS_MASK(entity_components.half_size), 0);
+		while (ecs_query_next(&query)) {
+			vec2 *positions = ecs_query_column(&query, entity_components.position);
+			vec2 *half_sizes = ecs_query_column(&query, entity_components.half_size);
+
+			for (u32 i = 0; i < query.count; ++i) {
+				AABB aabb;
+				vec2_dup(aabb.position, positions[i]);
+				vec2_dup(aabb.half_size, half_sizes[i]);
+				render_aabb((f32*)&aabb, TURQUOISE);
+			}
+		}
+
+		for (usize i = 0; i < physics_static_body_count(); ++i) {
+			render_aabb((f32*)physics_static_body_get(i), WHITE);
+		}
+	}
+
+	// Render animated entities...
+	Ecs_Query query = ecs_query(ECS_MASK(entity_components.position) | ECS_MASK(entity_components.sprite) | ECS_MASK(entity_components.animation), 0);
+	while (ecs_query_next(&query)) {
+		vec2 *positions = ecs_query_column(&query, entity_components.position);
+		Entity_Sprite *sprites = ecs_query_column(&query, entity_components.sprite);
+		Animation_State *anims = ecs_query_column(&query, entity_components.animation);
+
+		for (u32 i = 0; i < query.count; ++i) {
+			vec2 pos;
+
+			vec2_add(pos, positions[i], sprites[i].sprite_offset);
+			animation_render(sprites[i].animation_id, &anims[i], pos, WHITE, texture_slots);
+		}
+	}
+}
+
+// Physics callbacks play sounds and record entity changes, which the sync
+// system applies once physics and spawning are done. Recording is per thread,
+// but physics and spawning stay in order so replays see the same entity
+// order. Animation ticking reads the velocities physics leaves, so it runs
+// between the two. The audio update and texture uploads overlap them.
+static void systems_add(Sprite_Sheet *sprite_sheet_map) {
+	Ecs_Mask animated = ECS_MASK(entity_components.sprite) | ECS_MASK(entity_components.velocity);
+	Ecs_Mask drawn = ECS_MASK(entity_components.position) | ECS_MASK(entity_components.half_size) | ECS_MASK(entity_components.sprite) | ECS_MASK(entity_components.animation);
+
+	schedule_add((Schedule_System){
+		.name = "physics",
+		.function = system_physics,
+		.write = { SCHEDULE_ALL_COMPONENTS, SCHEDULE_RESOURCE(SCHEDULE_RESOURCE_PHYSICS) | SCHEDULE_RESOURCE(SCHEDULE_RESOURCE_AUDIO) },
+	});
+	schedule_add((Schedule_System){
+		.name = "animation",
+		.function = system_animation,
+		.read = { animated, SCHEDULE_RESOURCE(SCHEDULE_RESOURCE_ANIMATION) },
+		.write = { ECS_MASK(entity_components.animation), 0 },
+	});
+	schedule_add((Schedule_System){
+		.name = "audio",
+		.function = system_audio,
+		.write = { 0, SCHEDULE_RESOURCE(SCHEDULE_RESOURCE_AUDIO) },
+	});
+	schedule_add((Schedule_System){
+		.name = "spawn",
+		.function = system_spawn,
+		.write = { SCHEDULE_ALL_COMPONENTS, SCHEDULE_RESOURCE(SCHEDULE_RESOURCE_PHYSICS) },
+	});
+	schedule_add((Schedule_System){
+		.name = "sync",
+		.function = system_sync,
+		.write = { SCHEDULE_ALL_COMPONENTS, SCHEDULE_RESOURCE(SCHEDULE_RESOURCE_PHYSICS) | SCHEDULE_RESOURCE(SCHEDULE_RESOURCE_AUDIO) },
+	});
+	schedule_add((Schedule_System){
+		.name = "texture_upload",
+		.function = system_texture_upload,
+		.write = { 0, SCHEDULE_RESOURCE(SCHEDULE_RESOURCE_RENDER) },
+		.is_main_thread = true,
+	});
+	schedule_add((Schedule_System){
+		.name = "render_build",
+		.function = system_render_build,
+		.data = sprite_sheet_map,
+		.read = { drawn, SCHEDULE_RESOURCE(SCHEDULE_RESOURCE_PHYSICS) | SCHEDULE_RESOURCE(SCHEDULE_RESOURCE_ANIMATION) },
+		.write = { 0, SCHEDULE_RESOURCE(SCHEDULE_RESOURCE_RENDER) },
+		.is_main_thread = true,
+	});
 }
 
 int main(int argc, char *argv[]) {
-	time_init(60);
-	SDL_Window *window = render_init();
+	const char *trace_path = NULL;
+	const char *stats_path = NULL;
+	const char *record_path = NULL;
+	const char *replay_path = NULL;
+
+	for (i32 i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+			trace_path = argv[++i];
+		} else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+			stats_path = argv[++i];
+		} else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			record_path = argv[++i];
+		} else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+			replay_path = argv[++i];
+		}
+	}
+
+	profile_thread_name("main");
+
+	// Optional, assets are loaded from loose files when there is no pack.
+	pack_mount("assets.pack");
+
 	config_init();
+	time_apply_config();
+	frame_stats_init();
+	job_init(config_get_int("jobs", "worker_count", -1));
+	SDL_Window *window = render_init();
 	physics_init();
 	entity_init();
+	schedule_init();
 	animation_init();
 	audio_init();
-
-	audio_sound_load(&SOUND_JUMP, "assets/jump.wav");
-	audio_sound_load(&SOUND_SHOOT, "assets/shoot.wav");
-	audio_sound_load(&SOUND_BULLET_HIT_WALL, "assets/bullet_hit_wall.wav");
-	audio_sound_load(&SOUND_HURT, "assets/hurt.wav");
-	audio_sound_load(&SOUND_ENEMY_DEATH, "assets/enemy_death.wav");
-	audio_sound_load(&SOUND_PLAYER_DEATH, "assets/player_death.wav");
+	input_init();
+	hot_reload_init();
+
+	Audio_Bank_Sound sounds[] = {
+		{ &SOUND_JUMP, "assets/jump.wav" },
+		{ &SOUND_SHOOT, "assets/shoot.wav" },
+		{ &SOUND_BULLET_HIT_WALL, "assets/bullet_hit_wall.wav" },
+		{ &SOUND_HURT, "assets/hurt.wav" },
+		{ &SOUND_ENEMY_DEATH, "assets/enemy_death.wav" },
+		{ &SOUND_PLAYER_DEATH, "assets/player_death.wav" },
+	};
+	audio_bank_load(sounds, sizeof(sounds) / sizeof(sounds[0]));
 	audio_music_load(&MUSIC_STAGE_1, "assets/breezys_mega_quest_2_stage_1.mp3");
 
-	i32 window_width, window_height;
-	SDL_GetWindowSize(window, &window_width, &window_height);
-	render_width = window_width / render_get_scale();
-	render_height = window_height / render_get_scale();
+	audio_sound_limits(SOUND_SHOOT, (Audio_Sound_Limits){ .priority = AUDIO_PRIORITY_NORMAL, .max_instances = 4, .cooldown = 0.03 });
+	audio_sound_limits(SOUND_BULLET_HIT_WALL, (Audio_Sound_Limits){ .priority = AUDIO_PRIORITY_LOW, .max_instances = 4, .cooldown = 0.02 });
+	audio_sound_limits(SOUND_ENEMY_DEATH, (Audio_Sound_Limits){ .priority = AUDIO_PRIORITY_NORMAL, .max_instances = 4 });
+	audio_sound_limits(SOUND_HURT, (Audio_Sound_Limits){ .priority = AUDIO_PRIORITY_NORMAL, .max_instances = 2, .cooldown = 0.05 });
+	audio_sound_limits(SOUND_JUMP, (Audio_Sound_Limits){ .priority = AUDIO_PRIORITY_NORMAL, .max_instances = 1 });
+	audio_sound_limits(SOUND_PLAYER_DEATH, (Audio_Sound_Limits){ .priority = AUDIO_PRIORITY_HIGH, .max_instances = 1 });
 
 	Sprite_Sheet sprite_sheet_player;
 	Sprite_Sheet sprite_sheet_map;
@@ -328,12 +507,27 @@ int main(int argc, char *argv[]) {
 	Sprite_Sheet sprite_sheet_enemy_large;
 	Sprite_Sheet sprite_sheet_props;
     Sprite_Sheet sprite_sheet_fire;
-	render_sprite_sheet_init(&sprite_sheet_player, "assets/player.png", 24, 24);
-    render_sprite_sheet_init(&sprite_sheet_map, "assets/map.png", 640, 360);
-    render_sprite_sheet_init(&sprite_sheet_enemy_small, "assets/enemy_small.png", 24, 24);
-    render_sprite_sheet_init(&sprite_sheet_enemy_large, "assets/enemy_large.png", 40, 40);
-    render_sprite_sheet_init(&sprite_sheet_props, "assets/props_16x16.png", 16, 16);
-    render_sprite_sheet_init(&sprite_sheet_fire, "assets/fire.png", 32, 64);
+	render_sprite_sheet_load(&sprite_sheet_player, "assets/player.png", 24, 24);
+    render_sprite_sheet_load(&sprite_sheet_map, "assets/map.png", 640, 360);
+    render_sprite_sheet_load(&sprite_sheet_enemy_small, "assets/enemy_small.png", 24, 24);
+    render_sprite_sheet_load(&sprite_sheet_enemy_large, "assets/enemy_large.png", 40, 40);
+    render_sprite_sheet_load(&sprite_sheet_props, "assets/props_16x16.png", 16, 16);
+    render_sprite_sheet_load(&sprite_sheet_fire, "assets/fire.png", 32, 64);
+
+    hot_reload_watch_sprite_sheet(&sprite_sheet_player, "assets/player.png");
+    hot_reload_watch_sprite_sheet(&sprite_sheet_map, "assets/map.png");
+    hot_reload_watch_sprite_sheet(&sprite_sheet_enemy_small, "assets/enemy_small.png");
+    hot_reload_watch_sprite_sheet(&sprite_sheet_enemy_large, "assets/enemy_large.png");
+    hot_reload_watch_sprite_sheet(&sprite_sheet_props, "assets/props_16x16.png");
+    hot_reload_watch_sprite_sheet(&sprite_sheet_fire, "assets/fire.png");
+    hot_reload_watch_sound(SOUND_JUMP, "assets/jump.wav");
+    hot_reload_watch_sound(SOUND_SHOOT, "assets/shoot.wav");
+    hot_reload_watch_sound(SOUND_BULLET_HIT_WALL, "assets/bullet_hit_wall.wav");
+    hot_reload_watch_sound(SOUND_HURT, "assets/hurt.wav");
+    hot_reload_watch_sound(SOUND_ENEMY_DEATH, "assets/enemy_death.wav");
+    hot_reload_watch_sound(SOUND_PLAYER_DEATH, "assets/player_death.wav");
+    hot_reload_watch_shaders();
+    hot_reload_watch_config();
 
 	usize adef_player_walk_id = animation_definition_create(&sprite_sheet_player, 0.1, 0, (u8[]){1, 2, 3, 4, 5, 6, 7}, 7);
 	usize adef_player_idle_id = animation_definition_create(&sprite_sheet_player, 0, 0, (u8[]){0}, 1);
@@ -367,10 +561,35 @@ int main(int argc, char *argv[]) {
             .sfx = SOUND_SHOOT
     };
 
+	// Everything random in a session derives from this seed, so a replay only
+	// needs to store it.
+	u32 seed = (u32)SDL_GetPerformanceCounter();
+	if (replay_path) {
+		if (!replay_play_start(replay_path, &seed)) {
+			ERROR_EXIT("Could not start replay: %s\n", replay_path);
+		}
+	} else if (record_path) {
+		replay_record_start(record_path, seed);
+	}
+	rng_stream(&rng_spawn, seed, "spawn");
+	rng_stream(&rng_fire, seed, "fire");
+
     reset();
+	systems_add(&sprite_sheet_map);
 
 	while (!should_quit) {
 		time_update();
+		profile_frame_end();
+		frame_stats_record();
+
+		replay_frame_begin();
+		if (replay_is_finished()) {
+			break;
+		}
+
+		hot_reload_update();
+
+		PROFILE_BEGIN("input");
 
 		SDL_Event event;
 
@@ -388,84 +607,36 @@ int main(int argc, char *argv[]) {
         spawn_timer -= global.time.delta;
         ground_timer -= global.time.delta;
 
-		Entity *player = entity_get(player_id);
-		Body *body_player = physics_body_get(player->body_id);
+		f32 *velocity_player = entity_velocity(player_id);
+		audio_listener_set(entity_position(player_id));
 
-		if (body_player->velocity[0] != 0) {
-            player->animation_id = anim_player_walk_id;
+		if (velocity_player[0] != 0) {
+            entity_set_animation(player_id, anim_player_walk_id);
 		} else {
-            player->animation_id = anim_player_idle_id;
+            entity_set_animation(player_id, anim_player_idle_id);
 		}
 
 		input_update();
-		input_handle(body_player);
-		physics_update();
-
-		animation_update(global.time.delta);
-
-		// Spawn enemies.
-		{
-			if (spawn_timer <= 0) {
-				spawn_timer = (f32)((rand() % 200) + 200) / 100.f;
-
-				spawn_timer *= 0.2;
-
-				bool is_flipped = rand() % 100 >= 50;
-				bool is_small = rand() % 100 > 18;
-
-				f32 spawn_x = is_flipped ? 540 : 100;
-                spawn_enemy(is_small, false, is_flipped);
-			}
-		}
-
-		render_begin();
-
-        // Render terrain/map.
-        render_sprite_sheet_frame(&sprite_sheet_map, 0, 0, (vec2){render_width / 2.0, render_height / 2.0}, false, (vec4){1, 1, 1, 0.2}, texture_slots);
-
-        // Debug render bounding boxes.
-        {
-            for (usize i = 0; i < entity_count(); ++i) {
-                Entity *entity = entity_get(i);
-                Body *body = physics_body_get(entity->body_id);
-
-                if (body->is_active) {
-                    render_aabb((f32*)body, TURQUOISE);
-                } else {
-                    render_aabb((f32*)body, RED);
-                }
-            }
-
-            for (usize i = 0; i < physics_static_body_count(); ++i) {
-                render_aabb((f32*)physics_static_body_get(i), WHITE);
-            }
-        }
+		input_handle(velocity_player, entity_animation(player_id));
+		PROFILE_END();
 
-		// Render animated entities...
-		for (usize i = 0; i < entity_count(); ++i) {
-			Entity *entity = entity_get(i);
-			if (!entity->is_active || entity->animation_id == (usize)-1) {
-				continue;
-			}
-
-			Body *body = physics_body_get(entity->body_id);
-			Animation *anim = animation_get(entity->animation_id);
+		schedule_run();
 
-			if (body->velocity[0] < 0) {
-				anim->is_flipped = true;
-			} else if (body->velocity[0] > 0) {
-				anim->is_flipped = false;
-			}
+		render_end(window, texture_slots);
 
-            vec2 pos;
+		time_update_late();
+	}
 
-            vec2_add(pos, body->aabb.position, entity->sprite_offset);
-            animation_render(anim, pos, WHITE, texture_slots);
-		}
+	replay_stop();
+	job_shutdown();
+	audio_shutdown();
 
-		render_end(window, texture_slots);
+	if (trace_path) {
+		profile_trace_write(trace_path);
+	}
 
-		time_update_late();
+	if (stats_path) {
+		frame_stats_write_csv(stats_path);
 	}
 
 	return 0;
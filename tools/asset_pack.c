@@ -0,0 +1,189 @@
+// Builds an asset archive readable by pack_mount.
+//
+// usage: asset_pack.out [-t] output.pack files...
+//   -t  store PNG images as pre-decoded, flipped RGBA8 textures.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "../src/engine/types.h"
+#include "../src/engine/util.h"
+#include "../src/engine/io.h"
+#include "../src/engine/hash.h"
+#include "../src/engine/pack.h"
+
+typedef struct source {
+	const char *path;
+	u8 *data;
+	usize size;
+	u32 type;
+	u32 width;
+	u32 height;
+	u32 name_offset;
+	u64 offset;
+} Source;
+
+static const u8 zeroes[PACK_ALIGNMENT] = {0};
+
+static bool is_png(const char *path) {
+	usize len = strlen(path);
+	return len > 4 && strcmp(path + len - 4, ".png") == 0;
+}
+
+static u64 align_up(u64 value) {
+	return (value + PACK_ALIGNMENT - 1) & ~(u64)(PACK_ALIGNMENT - 1);
+}
+
+static void source_load(Source *source, bool decode_textures) {
+	if (decode_textures && is_png(source->path)) {
+		int width, height, channel_count;
+		u8 *pixels = stbi_load(source->path, &width, &height, &channel_count, 4);
+		if (!pixels) {
+			ERROR_EXIT("Failed to decode image: %s\n", source->path);
+		}
+
+		source->data = pixels;
+		source->size = (usize)width * height * 4;
+		source->type = PACK_ENTRY_TEXTURE;
+		source->width = width;
+		source->height = height;
+		return;
+	}
+
+	File file = io_file_map(source->path, IO_MAP_SEQUENTIAL);
+	if (!file.is_valid) {
+		ERROR_EXIT("Failed to read: %s\n", source->path);
+	}
+
+	source->data = (u8*)file.data;
+	source->size = file.len;
+	source->type = PACK_ENTRY_RAW;
+}
+
+int main(int argc, char *argv[]) {
+	bool decode_textures = false;
+	int first = 1;
+
+	if (first < argc && strcmp(argv[first], "-t") == 0) {
+		decode_textures = true;
+		++first;
+	}
+
+	if (argc - first < 2) {
+		ERROR_EXIT("usage: %s [-t] output.pack files...\n", argv[0]);
+	}
+
+	const char *output_path = argv[first++];
+	u32 count = argc - first;
+	Source *sources = calloc(count, sizeof(Source));
+
+	u32 table_size = 1;
+	while (table_size < count * 2) {
+		table_size <<= 1;
+	}
+
+	Pack_Entry *table = calloc(table_size, sizeof(Pack_Entry));
+	if (!sources || !table) {
+		ERROR_EXIT("Out of memory\n");
+	}
+
+	stbi_set_flip_vertically_on_load(1);
+
+	// Names follow the table, blobs follow the names.
+	u64 names_offset = sizeof(Pack_Header) + (u64)table_size * sizeof(Pack_Entry);
+	u64 names_size = 0;
+
+	for (u32 i = 0; i < count; ++i) {
+		Source *source = &sources[i];
+		source->path = pack_path_normalize(argv[first + i]);
+		source->name_offset = names_size;
+		names_size += strlen(source->path) + 1;
+		source_load(source, decode_textures);
+	}
+
+	u64 offset = align_up(names_offset + names_size);
+
+	for (u32 i = 0; i < count; ++i) {
+		Source *source = &sources[i];
+		source->offset = offset;
+		offset = align_up(offset + source->size + 1);
+
+		u64 hash = hash_string(source->path);
+		u32 mask = table_size - 1;
+		u32 slot = hash & mask;
+
+		while (table[slot].type != PACK_ENTRY_EMPTY) {
+			if (table[slot].path_hash == hash && strcmp(sources[table[slot].name_offset].path, source->path) == 0) {
+				ERROR_EXIT("Duplicate path: %s\n", source->path);
+			}
+			slot = (slot + 1) & mask;
+		}
+
+		// name_offset temporarily holds the source index for the duplicate check.
+		table[slot] = (Pack_Entry){
+			.path_hash = hash,
+			.offset = source->offset,
+			.size = source->size,
+			.name_offset = i,
+			.type = source->type,
+			.width = source->width,
+			.height = source->height,
+			.data_hash = hash_bytes(source->data, source->size),
+		};
+	}
+
+	for (u32 i = 0; i < table_size; ++i) {
+		if (table[i].type != PACK_ENTRY_EMPTY) {
+			table[i].name_offset = sources[table[i].name_offset].name_offset;
+		}
+	}
+
+	FILE *fp = fopen(output_path, "wb");
+	if (!fp) {
+		ERROR_EXIT("Cannot write file: %s\n", output_path);
+	}
+
+	Pack_Header header = {
+		.magic = PACK_MAGIC,
+		.version = PACK_VERSION,
+		.entry_count = count,
+		.table_size = table_size,
+		.names_offset = names_offset,
+		.names_size = names_size,
+	};
+
+	fwrite(&header, sizeof(header), 1, fp);
+	fwrite(table, sizeof(Pack_Entry), table_size, fp);
+
+	for (u32 i = 0; i < count; ++i) {
+		fwrite(sources[i].path, strlen(sources[i].path) + 1, 1, fp);
+	}
+
+	u64 written = names_offset + names_size;
+
+	for (u32 i = 0; i < count; ++i) {
+		Source *source = &sources[i];
+		fwrite(zeroes, source->offset - written, 1, fp);
+		fwrite(source->data, source->size, 1, fp);
+		// Trailing NUL so text assets can be used as C strings in place.
+		fwrite(zeroes, 1, 1, fp);
+		written = source->offset + source->size + 1;
+
+		printf("%-48s %10zu bytes%s\n", source->path, source->size, source->type == PACK_ENTRY_TEXTURE ? " (rgba)" : "");
+	}
+
+	if (ferror(fp)) {
+		ERROR_EXIT("Write error: %s\n", output_path);
+	}
+
+	fclose(fp);
+
+	printf("Wrote %u entries to %s\n", count, output_path);
+
+	return 0;
+}
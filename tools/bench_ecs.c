@@ -0,0 +1,180 @@
+// Measures ECS query throughput over tens of thousands of entities.
+//
+// usage: bench_ecs.out [entity_count]
+//   Creates entity_count entities (default BENCH_ENTITIES) laid out like the
+//   game's: all have a body id, position, half size and velocity, most a
+//   sprite and animation state, some a tag, so they spread over a few
+//   archetypes. Reports ns per entity for moving positions by the velocity
+//   column, for the same move going through the body id into a Body array as
+//   when components only held ids, and for flipping and stepping animation
+//   states. Body ids are shuffled like after a few rounds of spawning and
+//   dying. Results are best of BENCH_RUNS runs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+
+#include "../src/engine/types.h"
+#include "../src/engine/util.h"
+#include "../src/engine/ecs.h"
+#include "../src/engine/rng.h"
+#include "../src/engine/physics.h"
+#include "../src/engine/animation.h"
+
+#define BENCH_RUNS 20
+#define BENCH_ENTITIES 50000
+#define BENCH_FRAME_COUNT 8
+#define BENCH_FRAME_DURATION 0.1f
+#define BENCH_DELTA (1.f / 60.f)
+
+typedef struct bench_sprite {
+	usize animation_id;
+	vec2 sprite_offset;
+} Bench_Sprite;
+
+static Ecs_Component body;
+static Ecs_Component position;
+static Ecs_Component half_size;
+static Ecs_Component velocity;
+static Ecs_Component sprite;
+static Ecs_Component animation;
+static Ecs_Component tag;
+
+static Body *bodies;
+
+static f64 seconds_since(u64 start) {
+	return (f64)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+}
+
+static void move_columns(void) {
+	Ecs_Query query = ecs_query(ECS_MASK(position) | ECS_MASK(velocity), 0);
+	while (ecs_query_next(&query)) {
+		vec2 *positions = ecs_query_column(&query, position);
+		vec2 *velocities = ecs_query_column(&query, velocity);
+
+		for (u32 i = 0; i < query.count; ++i) {
+			positions[i][0] += velocities[i][0] * BENCH_DELTA;
+			positions[i][1] += velocities[i][1] * BENCH_DELTA;
+		}
+	}
+}
+
+static void move_bodies(void) {
+	Ecs_Query query = ecs_query(ECS_MASK(body), 0);
+	while (ecs_query_next(&query)) {
+		usize *body_ids = ecs_query_column(&query, body);
+
+		for (u32 i = 0; i < query.count; ++i) {
+			Body *b = &bodies[body_ids[i]];
+			b->aabb.position[0] += b->velocity[0] * BENCH_DELTA;
+			b->aabb.position[1] += b->velocity[1] * BENCH_DELTA;
+		}
+	}
+}
+
+// Same work as entity_animation_update, with one looping animation.
+static void step_animations(void) {
+	Ecs_Query query = ecs_query(ECS_MASK(animation) | ECS_MASK(velocity), 0);
+	while (ecs_query_next(&query)) {
+		Animation_State *states = ecs_query_column(&query, animation);
+		vec2 *velocities = ecs_query_column(&query, velocity);
+
+		for (u32 i = 0; i < query.count; ++i) {
+			Animation_State *state = &states[i];
+
+			if (velocities[i][0] < 0) {
+				state->is_flipped = true;
+			} else if (velocities[i][0] > 0) {
+				state->is_flipped = false;
+			}
+
+			state->frame_time -= BENCH_DELTA;
+			if (state->frame_time <= 0) {
+				state->frame_index = (state->frame_index + 1) % BENCH_FRAME_COUNT;
+				state->frame_time = BENCH_FRAME_DURATION;
+			}
+		}
+	}
+}
+
+static f64 bench(void (*update)(void), u32 count) {
+	f64 best = 1e30;
+
+	for (u32 run = 0; run < BENCH_RUNS; ++run) {
+		u64 start = SDL_GetPerformanceCounter();
+		update();
+
+		f64 seconds = seconds_since(start);
+		if (seconds < best)
+			best = seconds;
+	}
+
+	return best * 1e9 / count;
+}
+
+int main(int argc, char *argv[]) {
+	u32 count = argc > 1 ? (u32)atoi(argv[1]) : BENCH_ENTITIES;
+	if (count == 0)
+		count = BENCH_ENTITIES;
+
+	ecs_init();
+	body = ecs_component_register(sizeof(usize));
+	position = ecs_component_register(sizeof(vec2));
+	half_size = ecs_component_register(sizeof(vec2));
+	velocity = ecs_component_register(sizeof(vec2));
+	sprite = ecs_component_register(sizeof(Bench_Sprite));
+	animation = ecs_component_register(sizeof(Animation_State));
+	tag = ecs_component_register(0);
+
+	bodies = malloc(sizeof(Body) * count);
+	usize *body_ids = malloc(sizeof(usize) * count);
+	if (!bodies || !body_ids)
+		ERROR_EXIT("Not enough memory for bench data\n");
+
+	Rng rng;
+	rng_stream(&rng, 1, "bench_ecs");
+
+	for (u32 i = 0; i < count; ++i) {
+		body_ids[i] = i;
+	}
+	for (u32 i = count - 1; i > 0; --i) {
+		u32 j = rng_range(&rng, i + 1);
+		usize swap = body_ids[i];
+		body_ids[i] = body_ids[j];
+		body_ids[j] = swap;
+	}
+
+	Ecs_Mask base = ECS_MASK(body) | ECS_MASK(position) | ECS_MASK(half_size) | ECS_MASK(velocity);
+
+	for (u32 i = 0; i < count; ++i) {
+		Ecs_Mask mask = base;
+		if (rng_chance(&rng, 0.9f))
+			mask |= ECS_MASK(sprite) | ECS_MASK(animation);
+		if (rng_chance(&rng, 0.3f))
+			mask |= ECS_MASK(tag);
+
+		Ecs_Entity entity = ecs_entity_create(mask);
+		f32 *p = ecs_get(entity, position);
+		f32 *v = ecs_get(entity, velocity);
+		p[0] = rng_range_f32(&rng, 0, 640);
+		p[1] = rng_range_f32(&rng, 0, 360);
+		v[0] = rng_range_f32(&rng, -100, 100);
+		v[1] = rng_range_f32(&rng, -100, 100);
+
+		*(usize*)ecs_get(entity, body) = body_ids[i];
+		bodies[body_ids[i]] = (Body){
+			.aabb = { .position = { p[0], p[1] }, .half_size = { 8, 8 } },
+			.velocity = { v[0], v[1] },
+			.is_active = true,
+		};
+	}
+
+	printf("%u entities, best of %d runs\n", count, BENCH_RUNS);
+	printf("columns ns/entity  body id ns/entity  animation ns/entity\n");
+	printf("%17.2f  %17.2f  %19.2f\n", bench(move_columns, count), bench(move_bodies, count), bench(step_animations, count));
+
+	free(body_ids);
+	free(bodies);
+
+	return 0;
+}
@@ -0,0 +1,137 @@
+// Compares read throughput of io_file_read, io_file_map and io_stream.
+//
+// usage: bench_io.out [path]
+//   Without a path a temporary file of BENCH_TMP_SIZE bytes is written and
+//   removed afterwards. Every method checksums the bytes it reads so nothing is
+//   optimised away. Results are best of BENCH_RUNS runs, with a warm page cache.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "../src/engine/types.h"
+#include "../src/engine/util.h"
+#include "../src/engine/io.h"
+
+#define BENCH_RUNS 5
+#define BENCH_TMP_PATH "bench_io.tmp"
+#define BENCH_TMP_SIZE (128 * 1024 * 1024)
+#define STREAM_CHUNK_SIZE (1024 * 1024)
+#define STREAM_READ_AHEAD 4
+
+typedef u64 (*Bench_Fn)(const char *path, usize *peak_bytes);
+
+static u64 checksum(const u8 *data, usize len) {
+	u64 sum = 0;
+	for (usize i = 0; i < len; ++i) {
+		sum += data[i];
+	}
+
+	return sum;
+}
+
+static u64 bench_read(const char *path, usize *peak_bytes) {
+	File file = io_file_read(path);
+	if (!file.is_valid)
+		ERROR_EXIT("io_file_read failed: %s\n", path);
+
+	u64 sum = checksum((u8*)file.data, file.len);
+	*peak_bytes = file.len;
+	free(file.data);
+
+	return sum;
+}
+
+static u64 bench_map(const char *path, usize *peak_bytes) {
+	File file = io_file_map(path, IO_MAP_SEQUENTIAL);
+	if (!file.is_valid)
+		ERROR_EXIT("io_file_map failed: %s\n", path);
+
+	u64 sum = checksum((u8*)file.data, file.len);
+	*peak_bytes = file.is_mapped ? 0 : file.len;
+	io_file_unmap(&file);
+
+	return sum;
+}
+
+static u64 bench_stream(const char *path, usize *peak_bytes) {
+	static u8 buffer[STREAM_CHUNK_SIZE];
+
+	IO_Stream *stream = io_stream_open(path, STREAM_CHUNK_SIZE, STREAM_READ_AHEAD);
+	if (!stream)
+		ERROR_EXIT("io_stream_open failed: %s\n", path);
+
+	u64 sum = 0;
+	usize n;
+	while ((n = io_stream_read(stream, buffer, sizeof(buffer))) > 0) {
+		sum += checksum(buffer, n);
+	}
+
+	io_stream_close(stream);
+	*peak_bytes = STREAM_CHUNK_SIZE * (STREAM_READ_AHEAD + 1);
+
+	return sum;
+}
+
+static void run(const char *name, Bench_Fn fn, const char *path, usize size, u64 expected) {
+	f64 best = 1e30;
+	usize peak_bytes = 0;
+
+	for (u32 i = 0; i < BENCH_RUNS; ++i) {
+		u64 start = SDL_GetPerformanceCounter();
+		u64 sum = fn(path, &peak_bytes);
+		f64 seconds = (f64)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+		if (sum != expected)
+			ERROR_EXIT("%s: checksum mismatch\n", name);
+
+		if (seconds < best)
+			best = seconds;
+	}
+
+	printf("%-14s %10.1f MiB/s %10.2f ms %10.1f MiB buffered\n",
+			name, size / best / (1024.0 * 1024.0), best * 1000.0, peak_bytes / (1024.0 * 1024.0));
+}
+
+static void write_temp_file(usize size) {
+	FILE *fp = fopen(BENCH_TMP_PATH, "wb");
+	if (!fp)
+		ERROR_EXIT("Cannot write %s\n", BENCH_TMP_PATH);
+
+	u8 *block = malloc(STREAM_CHUNK_SIZE);
+	for (usize i = 0; i < STREAM_CHUNK_SIZE; ++i) {
+		block[i] = (u8)(i * 31 + 7);
+	}
+
+	for (usize written = 0; written < size; written += STREAM_CHUNK_SIZE) {
+		fwrite(block, 1, STREAM_CHUNK_SIZE, fp);
+	}
+
+	free(block);
+	fclose(fp);
+}
+
+int main(int argc, char *argv[]) {
+	const char *path = argc > 1 ? argv[1] : BENCH_TMP_PATH;
+
+	if (argc < 2)
+		write_temp_file(BENCH_TMP_SIZE);
+
+	File_Info info;
+	if (!io_file_info(path, &info))
+		ERROR_EXIT("Cannot stat %s\n", path);
+
+	usize peak_bytes;
+	u64 expected = bench_read(path, &peak_bytes);
+
+	printf("%s: %.1f MiB, best of %d runs\n", path, info.size / (1024.0 * 1024.0), BENCH_RUNS);
+	run("io_file_read", bench_read, path, info.size, expected);
+	run("io_file_map", bench_map, path, info.size, expected);
+	run("io_stream", bench_stream, path, info.size, expected);
+
+	if (argc < 2)
+		remove(BENCH_TMP_PATH);
+
+	return 0;
+}
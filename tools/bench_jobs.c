@@ -0,0 +1,134 @@
+// Measures job system overhead and scaling.
+//
+// usage: bench_jobs.out [max_threads]
+//   For 1, 2, 4, ... up to max_threads pool threads (default JOB_MAX_THREADS),
+//   reports the cost of spawning empty jobs from one thread, of spawning them
+//   through a batch 1 job_run_range (every thread splits and steals), and the
+//   speedup of a compute-bound job_parallel_for over the 1 thread run. Results
+//   are best of BENCH_RUNS runs. Counts above the machine's cores are
+//   oversubscribed and show scheduling cost rather than speedup.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+
+#include "../src/engine/types.h"
+#include "../src/engine/util.h"
+#include "../src/engine/job.h"
+
+#define BENCH_RUNS 5
+#define BENCH_SPAWN_JOBS (1 << 20)
+// Stays under JOB_QUEUE_SIZE so no job falls back to running inline.
+#define BENCH_SPAWN_BATCH 4000
+#define BENCH_FOR_COUNT (1 << 22)
+#define BENCH_FOR_BATCH 1024
+
+static f32 *values;
+
+static void empty_job(void *data) {
+}
+
+static void empty_range(void *data, u32 start, u32 end) {
+}
+
+static void compute_range(void *data, u32 start, u32 end) {
+	for (u32 i = start; i < end; ++i) {
+		f32 x = (f32)i;
+		for (u32 k = 0; k < 8; ++k) {
+			x = sqrtf(x * 1.0001f + 1.f);
+		}
+		values[i] = x;
+	}
+}
+
+static f64 seconds_since(u64 start) {
+	return (f64)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+}
+
+static f64 bench_spawn(void) {
+	f64 best = 1e30;
+
+	for (u32 run = 0; run < BENCH_RUNS; ++run) {
+		Job_Counter counter = {0};
+		u64 start = SDL_GetPerformanceCounter();
+
+		for (u32 i = 0; i < BENCH_SPAWN_JOBS; i += BENCH_SPAWN_BATCH) {
+			for (u32 j = 0; j < BENCH_SPAWN_BATCH; ++j) {
+				job_run(empty_job, NULL, &counter);
+			}
+			job_wait(&counter);
+		}
+
+		f64 seconds = seconds_since(start);
+		if (seconds < best)
+			best = seconds;
+	}
+
+	u32 jobs = (BENCH_SPAWN_JOBS + BENCH_SPAWN_BATCH - 1) / BENCH_SPAWN_BATCH * BENCH_SPAWN_BATCH;
+
+	return best * 1e9 / jobs;
+}
+
+static f64 bench_split(void) {
+	f64 best = 1e30;
+
+	for (u32 run = 0; run < BENCH_RUNS; ++run) {
+		u64 start = SDL_GetPerformanceCounter();
+		job_parallel_for(empty_range, NULL, BENCH_SPAWN_JOBS, 1);
+
+		f64 seconds = seconds_since(start);
+		if (seconds < best)
+			best = seconds;
+	}
+
+	return best * 1e9 / BENCH_SPAWN_JOBS;
+}
+
+static f64 bench_for(void) {
+	f64 best = 1e30;
+
+	for (u32 run = 0; run < BENCH_RUNS; ++run) {
+		u64 start = SDL_GetPerformanceCounter();
+		job_parallel_for(compute_range, NULL, BENCH_FOR_COUNT, BENCH_FOR_BATCH);
+
+		f64 seconds = seconds_since(start);
+		if (seconds < best)
+			best = seconds;
+	}
+
+	return best;
+}
+
+int main(int argc, char *argv[]) {
+	u32 max_threads = argc > 1 ? (u32)atoi(argv[1]) : JOB_MAX_THREADS;
+	if (max_threads == 0 || max_threads > JOB_MAX_THREADS)
+		max_threads = JOB_MAX_THREADS;
+
+	values = malloc(sizeof(f32) * BENCH_FOR_COUNT);
+	if (!values)
+		ERROR_EXIT("Not enough memory for bench data\n");
+
+	printf("%d cores, best of %d runs\n", SDL_GetCPUCount(), BENCH_RUNS);
+	printf("threads  spawn ns/job  split ns/job  parallel_for ms  speedup\n");
+
+	f64 single = 0;
+
+	for (u32 threads = 1; threads <= max_threads; threads *= 2) {
+		job_init((i32)threads - 1);
+
+		f64 spawn = bench_spawn();
+		f64 split = bench_split();
+		f64 seconds = bench_for();
+		if (threads == 1)
+			single = seconds;
+
+		printf("%7u  %12.1f  %12.1f  %15.2f  %7.2f\n", job_thread_count(), spawn, split, seconds * 1000.0, single / seconds);
+
+		job_shutdown();
+	}
+
+	free(values);
+
+	return 0;
+}
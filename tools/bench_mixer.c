@@ -0,0 +1,117 @@
+// Measures software mixer throughput with the null output.
+//
+// usage: bench_mixer.out [seconds]
+//   Mixes synthetic voices for the given seconds of audio (default
+//   BENCH_SECONDS) per case. Direct voices are stereo at the mixer rate and take
+//   the copy path, resampled voices are mono at 44.1 kHz. Results are best of
+//   BENCH_RUNS runs. Voice-ms per ms is milliseconds of single voice audio
+//   mixed per millisecond of CPU, roughly how many voices one core can keep up
+//   with in real time. Build with -DMIXER_NO_SIMD to compare the scalar path.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+
+#include "../src/engine/types.h"
+#include "../src/engine/util.h"
+#include "../src/engine/mixer.h"
+
+#define BENCH_RUNS 5
+#define BENCH_SECONDS 10
+#define BENCH_RESAMPLED_RATE 44100
+// Shorter than a second so voices loop during a run.
+#define BENCH_SOUND_FRAMES 30000
+
+static f32 *synth(u32 frames, u32 channels, u32 rate) {
+	f32 *samples = malloc(sizeof(f32) * frames * channels);
+	if (!samples)
+		ERROR_EXIT("Not enough memory for bench sound\n");
+
+	for (u32 i = 0; i < frames; ++i) {
+		for (u32 c = 0; c < channels; ++c) {
+			samples[i * channels + c] = 0.5f * sinf(i * (440.f + c * 110.f) * 2 * (f32)M_PI / rate);
+		}
+	}
+
+	return samples;
+}
+
+static void run(const char *name, const Mixer_Sound *sound, u32 voice_count, u32 seconds) {
+	u32 rate = mixer_sample_rate();
+	u32 blocks = seconds * rate / MIXER_DEFAULT_BLOCK_FRAMES;
+	static f32 out[MIXER_DEFAULT_BLOCK_FRAMES * 2];
+	f64 best = 1e30;
+
+	for (u32 run = 0; run < BENCH_RUNS; ++run) {
+		for (u32 i = 0; i < voice_count; ++i) {
+			Mixer_Voice_Params params = {
+				.gain = 1.f / voice_count,
+				.pan = (f32)i / voice_count * 2 - 1,
+				.pitch = 1,
+				.is_looping = true,
+			};
+			mixer_voice_play(i, sound, params);
+		}
+
+		u64 start = SDL_GetPerformanceCounter();
+		for (u32 i = 0; i < blocks; ++i) {
+			mixer_render(out, MIXER_DEFAULT_BLOCK_FRAMES);
+		}
+		f64 seconds_taken = (f64)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+		if (seconds_taken < best)
+			best = seconds_taken;
+
+		for (u32 i = 0; i < voice_count; ++i) {
+			mixer_voice_stop(i);
+		}
+	}
+
+	f64 voice_frames = (f64)blocks * MIXER_DEFAULT_BLOCK_FRAMES * voice_count;
+	f64 audio_ms = (f64)blocks * MIXER_DEFAULT_BLOCK_FRAMES / rate * 1000.0;
+
+	printf("%-10s %4u voices %8.2f ns/voice-frame %10.1f voice-ms per ms\n",
+			name, voice_count, best * 1e9 / voice_frames, audio_ms * voice_count / (best * 1000.0));
+}
+
+int main(int argc, char *argv[]) {
+	u32 seconds = argc > 1 ? (u32)atoi(argv[1]) : BENCH_SECONDS;
+	if (seconds == 0)
+		seconds = BENCH_SECONDS;
+
+	if (!mixer_init(MIXER_OUTPUT_NULL, MIXER_DEFAULT_SAMPLE_RATE, MIXER_DEFAULT_BLOCK_FRAMES, NULL))
+		ERROR_EXIT("Could not start mixer\n");
+
+	u32 rate = mixer_sample_rate();
+	Mixer_Sound direct = {
+		.samples = synth(BENCH_SOUND_FRAMES, 2, rate),
+		.frame_count = BENCH_SOUND_FRAMES,
+		.channels = 2,
+		.sample_rate = rate,
+	};
+	Mixer_Sound resampled = {
+		.samples = synth(BENCH_SOUND_FRAMES, 1, BENCH_RESAMPLED_RATE),
+		.frame_count = BENCH_SOUND_FRAMES,
+		.channels = 1,
+		.sample_rate = BENCH_RESAMPLED_RATE,
+	};
+
+#if defined(__SSE2__) && !defined(MIXER_NO_SIMD)
+	printf("SSE mixer, %u Hz, %d frame blocks, %u s of audio, best of %d runs\n", rate, MIXER_DEFAULT_BLOCK_FRAMES, seconds, BENCH_RUNS);
+#else
+	printf("scalar mixer, %u Hz, %d frame blocks, %u s of audio, best of %d runs\n", rate, MIXER_DEFAULT_BLOCK_FRAMES, seconds, BENCH_RUNS);
+#endif
+
+	u32 voice_counts[] = { 16, 64, MAX_MIXER_VOICES };
+	for (u32 i = 0; i < sizeof(voice_counts) / sizeof(voice_counts[0]); ++i) {
+		run("direct", &direct, voice_counts[i], seconds);
+		run("resampled", &resampled, voice_counts[i], seconds);
+	}
+
+	mixer_shutdown();
+	free((f32*)direct.samples);
+	free((f32*)resampled.samples);
+
+	return 0;
+}